@@ -0,0 +1,345 @@
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "board_features.h"
+#include "constants.h"
+#include "tetris.h"
+#include "perf_counters.h"
+#include "solver.h"
+#include "xoshiro.h"
+#include "test_helpers.h"
+
+/*
+ * Microbenchmarks of the solver's hot path on a fixed set of boards, for every shape.
+ * Benchmarks are named function/board:b/shape:s, e.g. BM_search/board:2/shape:5 is search on the
+ * tall ragged board with a T, and the label spells the board and shape out.
+ * Run with --benchmark_format=json or --benchmark_out=results.json to get numbers that compare
+ * across branches (e.g. with Google Benchmark's tools/compare.py).
+ * With --perf every benchmark also reports hardware counters per iteration of its timed loop, see
+ * src/perf_counters.h. Without a PMU the benchmarks run as usual after printing why.
+ */
+
+enum BenchBoard { emptyBoard, midGameBoard, tallRaggedBoard, holeHeavyBoard, numBenchBoards };
+static const std::array<const char*, numBenchBoards> boardNames = { "empty", "mid-game", "tall ragged", "hole heavy" };
+static const std::array<const char*, 7> shapeNames = { "I", "J", "L", "O", "S", "T", "Z" };
+
+// Fills the bottom height cells of a column, leaving out those set in holes (bit 0 is the bottom cell)
+static void fillColumn(GameGrid& grid, int column, int height, uint32_t holes = 0) {
+    for (int i = 0; i < height; i++) {
+        if (not (holes & (1u << i))) {
+            grid.setCell(Position(column, GRID_HEIGHT - 1 - i), first);
+        }
+    }
+}
+
+// Boards are made from fixed seeds so every run and every branch measures the same positions.
+// Column 0 is never filled to the top of the stack so no row is ever full.
+static GameGrid makeBoard(BenchBoard board) {
+    GameGrid grid;
+    Xoshiro256 rng(board);
+    switch (board) {
+        case midGameBoard: // a stack about 6 high with the odd hole
+            for (int column = 1; column < GRID_WIDTH; column++) {
+                fillColumn(grid, column, 4 + rng.below(4), rng.below(8) == 0 ? 1u << rng.below(3) : 0);
+            }
+            fillColumn(grid, 0, 2);
+            break;
+        case tallRaggedBoard: // 10 to 16 high with big steps between columns
+            for (int column = 1; column < GRID_WIDTH; column++) {
+                fillColumn(grid, column, column % 2 == 0 ? 14 + rng.below(3) : 10 + rng.below(3));
+            }
+            fillColumn(grid, 0, 9);
+            break;
+        case holeHeavyBoard: // 9 rows with about a third of their cells missing
+            for (int column = 1; column < GRID_WIDTH; column++) {
+                uint32_t holes = 0;
+                for (int i = 0; i < 8; i++) {
+                    holes |= rng.below(3) == 0 ? 1u << i : 0;
+                }
+                fillColumn(grid, column, 9, holes);
+            }
+            fillColumn(grid, 0, 7, 0b0100100);
+            break;
+        default:
+            break;
+    }
+    return grid;
+}
+
+static Tetrimino spawnTetrimino(int shape) {
+    Tetrimino tetrimino(static_cast<TetriminoShape>(shape));
+    tetrimino.xDelta = SPAWN_X_DELTA;
+    return tetrimino;
+}
+
+static bool perfCounters = false; // set by --perf
+
+// Hardware counters around a benchmark's timed loop, opened once per thread
+class LoopCounters {
+    private:
+    PerfReading start;
+    bool counting = false;
+
+    static PerfCounterGroup& group() {
+        static thread_local PerfCounterGroup group;
+        static thread_local bool opened = false;
+        static bool warned = false;
+        if (not opened) {
+            opened = true;
+            if (not group.open(PerfCounterGroup::hardwareEvents()) and not warned) {
+                std::cerr << "no hardware counters, " << group.getError() << std::endl;
+                warned = true;
+            }
+        }
+        return group;
+    };
+
+    public:
+    LoopCounters() {
+        if (perfCounters) {
+            this->counting = group().read(this->start);
+        }
+    };
+
+    // Adds the counts per iteration, with IPC when both cycles and instructions were counted
+    void report(benchmark::State& state) {
+        PerfReading end;
+        if (not this->counting or not group().read(end)) {
+            return;
+        }
+        for (int event = 0; event < numPerfEvents; event++) {
+            if (group().isCounting(event)) {
+                double count = static_cast<double>(perfCountBetween(this->start, end, event));
+                state.counters[perfEventName(static_cast<PerfEvent>(event))] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+            }
+        }
+        uint64_t cycles = perfCountBetween(this->start, end, cyclesEvent);
+        if (group().isCounting(cyclesEvent) and group().isCounting(instructionsEvent) and cycles > 0) {
+            state.counters["ipc"] = static_cast<double>(perfCountBetween(this->start, end, instructionsEvent)) / cycles;
+        }
+    };
+};
+
+static void setLabel(benchmark::State& state) {
+    state.SetLabel(std::string(boardNames[state.range(0)]) + " " + shapeNames[state.range(1)]);
+}
+
+static void BM_setNodeNeighbours(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    graph.shape = tetrimino.shape;
+    int rotationCount = tetrimino.getRotationCount();
+    std::vector<NodeIndex> nodes;
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        for (int x = 0; x < GRID_WIDTH; x++) {
+            for (int rotation = 0; rotation < rotationCount; rotation++) {
+                nodes.push_back(nodeIndex(x, y, rotation));
+            }
+        }
+    }
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        for (NodeIndex node : nodes) {
+            setNodeNeighbours(node, &graph, grid);
+        }
+        benchmark::DoNotOptimize(graph.neighbours.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * nodes.size());
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+static void BM_makeGraph(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        makeGraph(graph, tetrimino, grid);
+        benchmark::DoNotOptimize(graph.neighbours.data());
+        benchmark::ClobberMemory();
+    }
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+static void BM_search(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    makeGraph(graph, tetrimino, grid);
+    SearchQueue queue;
+    std::vector<NodeIndex> results;
+    results.reserve(GRAPH_SIZE);
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        search(&graph, tetrimino, grid, queue, results);
+        benchmark::DoNotOptimize(results.data());
+    }
+    state.counters["placements"] = static_cast<double>(results.size());
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+// Every board left by placing the tetrimino, evaluated one after another by the full scan that tests
+// check the solver against
+static void BM_computeEvaluationFactors(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    makeGraph(graph, tetrimino, grid);
+    std::vector<NodeIndex> results = search(&graph, tetrimino, grid);
+    std::vector<GameGrid> boards;
+    for (NodeIndex result : results) {
+        GameGrid board = grid;
+        board.setCells(graph.getTetrimino(result));
+        board.clearFullRows();
+        boards.push_back(board);
+    }
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        for (const GameGrid& board : boards) {
+            EvaluationFactors factors;
+            computeEvaluationFactors(board, factors);
+            benchmark::DoNotOptimize(factors);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * boards.size());
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+// The solver's leaf path: every placement put on a copy of the board, whose features are up to date,
+// and evaluated from the features GameGrid keeps, without a transposition table
+static void BM_getEvaluationFactors(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    grid.getFeatures();
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    makeGraph(graph, tetrimino, grid);
+    std::vector<Tetrimino> placements;
+    for (NodeIndex result : search(&graph, tetrimino, grid)) {
+        placements.push_back(graph.getTetrimino(result));
+    }
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        for (Tetrimino placement : placements) {
+            GameGrid board = grid;
+            board.setCells(placement);
+            board.clearFullRows();
+            EvaluationFactors factors;
+            getEvaluationFactors(board, factors);
+            benchmark::DoNotOptimize(factors);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * placements.size());
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+// The bitboard feature kernels alone, from scratch on the rows of every board left by placing the tetrimino
+static void BM_computeBoardFeatures(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    makeGraph(graph, tetrimino, grid);
+    std::vector<std::array<uint16_t, GRID_HEIGHT>> boards;
+    for (NodeIndex result : search(&graph, tetrimino, grid)) {
+        GameGrid board = grid;
+        board.setCells(graph.getTetrimino(result));
+        board.clearFullRows();
+        std::array<uint16_t, GRID_HEIGHT> rows;
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            rows[y] = board.getRow(y);
+        }
+        boards.push_back(rows);
+    }
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        for (const std::array<uint16_t, GRID_HEIGHT>& rows : boards) {
+            BoardFeatures features = computeBoardFeatures(rows);
+            benchmark::DoNotOptimize(features);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * boards.size());
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+// Moves to every placement found by search
+static void BM_movesToReachSearchResult(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino tetrimino = spawnTetrimino(state.range(1));
+    Graph graph;
+    makeGraph(graph, tetrimino, grid);
+    SearchQueue queue;
+    std::vector<NodeIndex> results;
+    search(&graph, tetrimino, grid, queue, results);
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        for (NodeIndex result : results) {
+            Moves moves = movesToReachSearchResult(&graph, result);
+            benchmark::DoNotOptimize(moves);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * results.size());
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+// Both plies with a reused context, the second tetrimino being the next shape along
+static void BM_solve(benchmark::State& state) {
+    GameGrid grid = makeBoard(static_cast<BenchBoard>(state.range(0)));
+    Tetrimino firstTetrimino = spawnTetrimino(state.range(1));
+    Tetrimino secondTetrimino = spawnTetrimino((state.range(1) + 1) % 7);
+    SolverContext context;
+    LoopCounters loopCounters;
+    for (auto _ : state) {
+        NodeIndex result = solve(context, grid, firstTetrimino, secondTetrimino, weights);
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["leaves"] = context.stats.evaluatedLeaves;
+    state.counters["prunedFirstPlacements"] = context.stats.prunedFirstPlacements;
+    loopCounters.report(state);
+    setLabel(state);
+}
+
+// every board with every shape, I to Z
+static void boardsAndShapes(benchmark::internal::Benchmark* benchmark) {
+    benchmark->ArgNames({ "board", "shape" })->ArgsProduct({ benchmark::CreateDenseRange(0, numBenchBoards - 1, 1), benchmark::CreateDenseRange(I, Z, 1) });
+}
+
+BENCHMARK(BM_setNodeNeighbours)->Apply(boardsAndShapes);
+BENCHMARK(BM_makeGraph)->Apply(boardsAndShapes);
+BENCHMARK(BM_search)->Apply(boardsAndShapes);
+BENCHMARK(BM_getEvaluationFactors)->Apply(boardsAndShapes);
+BENCHMARK(BM_computeBoardFeatures)->Apply(boardsAndShapes);
+BENCHMARK(BM_computeEvaluationFactors)->Apply(boardsAndShapes);
+BENCHMARK(BM_movesToReachSearchResult)->Apply(boardsAndShapes);
+BENCHMARK(BM_solve)->Apply(boardsAndShapes);
+
+// BENCHMARK_MAIN plus --perf
+int main(int argc, char** argv) {
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--perf") == 0) {
+            perfCounters = true;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
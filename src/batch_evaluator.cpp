@@ -0,0 +1,191 @@
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "batch_evaluator.h"
+#include "solver.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+#if defined(__x86_64__) // SSE2 is always there on x86-64
+#define BATCH_EVALUATOR_X86
+#include <immintrin.h>
+#endif
+
+void LeafBatch::push(const EvaluationFactors& factors, uint16_t firstResult) {
+    this->linesCleared.push_back(factors.totalLinesCleared);
+    this->lockHeights.push_back(factors.totalLockHeight);
+    this->wellCells.push_back(factors.totalWellCells);
+    this->columnHoles.push_back(factors.totalColumnHoles);
+    this->columnTransitions.push_back(factors.totalColumnTransistions);
+    this->rowTransitions.push_back(factors.totalRowTransitions);
+    this->firstResults.push_back(firstResult);
+}
+
+void LeafBatch::clear() {
+    this->linesCleared.clear();
+    this->lockHeights.clear();
+    this->wellCells.clear();
+    this->columnHoles.clear();
+    this->columnTransitions.clear();
+    this->rowTransitions.clear();
+    this->firstResults.clear();
+}
+
+void LeafBatch::reserve(std::size_t capacity) {
+    this->linesCleared.reserve(capacity);
+    this->lockHeights.reserve(capacity);
+    this->wellCells.reserve(capacity);
+    this->columnHoles.reserve(capacity);
+    this->columnTransitions.reserve(capacity);
+    this->rowTransitions.reserve(capacity);
+    this->firstResults.reserve(capacity);
+}
+
+// the sum is written out in the same order as computeFitness so every path rounds the same way
+static double leafFitness(const LeafBatch& leaves, int i, const EvaluationWeights& weights) {
+    return (
+        leaves.linesCleared[i] * weights.totalLinesCleared +
+        leaves.lockHeights[i] * weights.totalLockHeight +
+        leaves.wellCells[i] * weights.totalWellCells +
+        leaves.columnHoles[i] * weights.totalColumnHoles +
+        leaves.columnTransitions[i] * weights.totalColumnTransitions +
+        leaves.rowTransitions[i] * weights.totalRowTransitions
+    );
+}
+
+// Scores leaves [start, size) one at a time, continuing from best
+static LeafScore findBestLeafScalar(const LeafBatch& leaves, const EvaluationWeights& weights, int start, LeafScore best) {
+    for (int i = start; i < leaves.size(); i++) {
+        double fitness = leafFitness(leaves, i, weights);
+        if (best.index < 0 or fitness < best.fitness) {
+            best.index = i;
+            best.fitness = fitness;
+        }
+    }
+    return best;
+}
+
+#ifdef BATCH_EVALUATOR_X86
+
+// Each lane keeps the lowest fitness it has seen and the index it was seen at. A lane only replaces
+// its best on a strictly lower fitness, so it holds the earliest of its ties and picking the lowest
+// index among lanes with equal fitness gives the earliest leaf overall.
+static LeafScore reduceLanes(const double* fitnesses, const double* indices, int laneCount) {
+    LeafScore best;
+    for (int lane = 0; lane < laneCount; lane++) {
+        int index = static_cast<int>(indices[lane]);
+        if (index < 0) { // the lane never saw a leaf
+            continue;
+        }
+        if (best.index < 0 or fitnesses[lane] < best.fitness or (fitnesses[lane] == best.fitness and index < best.index)) {
+            best.index = index;
+            best.fitness = fitnesses[lane];
+        }
+    }
+    return best;
+}
+
+static LeafScore findBestLeafSse2(const LeafBatch& leaves, const EvaluationWeights& weights) {
+    const int lanes = 2;
+    int vectorEnd = leaves.size() - leaves.size() % lanes;
+
+    auto load = [](const std::vector<int32_t>& factor, int i) {
+        return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(factor.data() + i)));
+    };
+
+    __m128d bestFitness = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    __m128d bestIndex = _mm_set1_pd(-1.0);
+    __m128d index = _mm_set_pd(1.0, 0.0);
+    const __m128d step = _mm_set1_pd(lanes);
+
+    for (int i = 0; i < vectorEnd; i += lanes) {
+        __m128d fitness = _mm_mul_pd(load(leaves.linesCleared, i), _mm_set1_pd(weights.totalLinesCleared));
+        fitness = _mm_add_pd(fitness, _mm_mul_pd(load(leaves.lockHeights, i), _mm_set1_pd(weights.totalLockHeight)));
+        fitness = _mm_add_pd(fitness, _mm_mul_pd(load(leaves.wellCells, i), _mm_set1_pd(weights.totalWellCells)));
+        fitness = _mm_add_pd(fitness, _mm_mul_pd(load(leaves.columnHoles, i), _mm_set1_pd(weights.totalColumnHoles)));
+        fitness = _mm_add_pd(fitness, _mm_mul_pd(load(leaves.columnTransitions, i), _mm_set1_pd(weights.totalColumnTransitions)));
+        fitness = _mm_add_pd(fitness, _mm_mul_pd(load(leaves.rowTransitions, i), _mm_set1_pd(weights.totalRowTransitions)));
+
+        __m128d better = _mm_cmplt_pd(fitness, bestFitness);
+        bestFitness = _mm_or_pd(_mm_and_pd(better, fitness), _mm_andnot_pd(better, bestFitness));
+        bestIndex = _mm_or_pd(_mm_and_pd(better, index), _mm_andnot_pd(better, bestIndex));
+        index = _mm_add_pd(index, step);
+    }
+
+    alignas(16) double fitnesses[lanes];
+    alignas(16) double indices[lanes];
+    _mm_store_pd(fitnesses, bestFitness);
+    _mm_store_pd(indices, bestIndex);
+    return findBestLeafScalar(leaves, weights, vectorEnd, reduceLanes(fitnesses, indices, lanes));
+}
+
+__attribute__((target("avx2")))
+static inline __m256d loadAvx2(const std::vector<int32_t>& factor, int i) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(factor.data() + i)));
+}
+
+// only the AVX subset is needed for doubles but AVX2 is what gets checked for at runtime
+__attribute__((target("avx2")))
+static LeafScore findBestLeafAvx2(const LeafBatch& leaves, const EvaluationWeights& weights) {
+    const int lanes = 4;
+    int vectorEnd = leaves.size() - leaves.size() % lanes;
+
+    __m256d bestFitness = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    __m256d bestIndex = _mm256_set1_pd(-1.0);
+    __m256d index = _mm256_set_pd(3.0, 2.0, 1.0, 0.0);
+    const __m256d step = _mm256_set1_pd(lanes);
+
+    for (int i = 0; i < vectorEnd; i += lanes) {
+        __m256d fitness = _mm256_mul_pd(loadAvx2(leaves.linesCleared, i), _mm256_set1_pd(weights.totalLinesCleared));
+        fitness = _mm256_add_pd(fitness, _mm256_mul_pd(loadAvx2(leaves.lockHeights, i), _mm256_set1_pd(weights.totalLockHeight)));
+        fitness = _mm256_add_pd(fitness, _mm256_mul_pd(loadAvx2(leaves.wellCells, i), _mm256_set1_pd(weights.totalWellCells)));
+        fitness = _mm256_add_pd(fitness, _mm256_mul_pd(loadAvx2(leaves.columnHoles, i), _mm256_set1_pd(weights.totalColumnHoles)));
+        fitness = _mm256_add_pd(fitness, _mm256_mul_pd(loadAvx2(leaves.columnTransitions, i), _mm256_set1_pd(weights.totalColumnTransitions)));
+        fitness = _mm256_add_pd(fitness, _mm256_mul_pd(loadAvx2(leaves.rowTransitions, i), _mm256_set1_pd(weights.totalRowTransitions)));
+
+        __m256d better = _mm256_cmp_pd(fitness, bestFitness, _CMP_LT_OQ);
+        bestFitness = _mm256_blendv_pd(bestFitness, fitness, better);
+        bestIndex = _mm256_blendv_pd(bestIndex, index, better);
+        index = _mm256_add_pd(index, step);
+    }
+
+    alignas(32) double fitnesses[lanes];
+    alignas(32) double indices[lanes];
+    _mm256_store_pd(fitnesses, bestFitness);
+    _mm256_store_pd(indices, bestIndex);
+    return findBestLeafScalar(leaves, weights, vectorEnd, reduceLanes(fitnesses, indices, lanes));
+}
+
+#endif
+
+BatchInstructionSet bestSupportedInstructionSet() {
+#ifdef BATCH_EVALUATOR_X86
+    static const BatchInstructionSet best = __builtin_cpu_supports("avx2") ? avx2Instructions : sse2Instructions;
+    return best;
+#else
+    return scalarInstructions;
+#endif
+}
+
+LeafScore findBestLeaf(const LeafBatch& leaves, const EvaluationWeights& weights) {
+    return findBestLeaf(leaves, weights, bestSupportedInstructionSet());
+}
+
+LeafScore findBestLeaf(const LeafBatch& leaves, const EvaluationWeights& weights, BatchInstructionSet instructionSet) {
+    TRACE_SCOPE("evaluate");
+    PERF_PHASE(evaluatePhase);
+    if (instructionSet > bestSupportedInstructionSet()) {
+        instructionSet = bestSupportedInstructionSet();
+    }
+
+    switch (instructionSet) {
+#ifdef BATCH_EVALUATOR_X86
+        case avx2Instructions:
+            return findBestLeafAvx2(leaves, weights);
+        case sse2Instructions:
+            return findBestLeafSse2(leaves, weights);
+#endif
+        default:
+            return findBestLeafScalar(leaves, weights, 0, LeafScore());
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef BATCH_EVALUATOR_H
+#define BATCH_EVALUATOR_H
+
+#include <cstdint>
+#include <vector>
+
+struct EvaluationFactors;
+struct EvaluationWeights;
+
+/*
+ * Leaf boards waiting to be scored, stored as one array per evaluation factor so that several
+ * boards can be scored per instruction. The solvers collect every leaf of a search here and then
+ * score them all at once with findBestLeaf instead of calling computeFitness once per board.
+ * Steady state use makes no heap allocations since clear() keeps the capacity.
+ */
+struct LeafBatch {
+    std::vector<int32_t> linesCleared;
+    std::vector<int32_t> lockHeights;
+    std::vector<int32_t> wellCells;
+    std::vector<int32_t> columnHoles;
+    std::vector<int32_t> columnTransitions;
+    std::vector<int32_t> rowTransitions;
+    std::vector<uint16_t> firstResults; // NodeIndex of the first placement the leaf descends from
+
+    void push(const EvaluationFactors& factors, uint16_t firstResult);
+    void clear();
+    void reserve(std::size_t capacity);
+    int size() const { return static_cast<int>(this->firstResults.size()); };
+};
+
+enum BatchInstructionSet {
+    scalarInstructions,
+    sse2Instructions,   // 2 boards per instruction
+    avx2Instructions    // 4 boards per instruction
+};
+
+struct LeafScore {
+    int index = -1; // -1 when the batch is empty
+    double fitness = -1.0;
+};
+
+/*
+ * Scores every leaf with the same arithmetic as computeFitness, done in the same order so the
+ * results are identical, and returns the lowest. Ties go to the earliest leaf like the strict
+ * comparisons in solve().
+ * The instruction set defaults to the best one the CPU supports. Asking for one that isn't
+ * supported falls back to the next best.
+ */
+LeafScore findBestLeaf(const LeafBatch& leaves, const EvaluationWeights& weights);
+LeafScore findBestLeaf(const LeafBatch& leaves, const EvaluationWeights& weights, BatchInstructionSet instructionSet);
+BatchInstructionSet bestSupportedInstructionSet();
+
+#endif
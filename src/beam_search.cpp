@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "beam_search.h"
+#include "solver.h"
+#include "solver_stats.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include "tetris.h"
+
+BeamSearchSolver::BeamSearchSolver(BeamSettings settings, TranspositionTable* transpositionTable) : settings(settings) {
+    this->context.transpositionTable = transpositionTable;
+}
+
+NodeIndex BeamSearchSolver::solve(GameGrid& grid, const std::vector<Tetrimino>& tetriminos, EvaluationWeights weights) {
+    SOLVER_STATS_TIME_SOLVE();
+    TRACE_SCOPE("solve");
+    PERF_PHASE(solvePhase);
+    Tetrimino firstTetrimino = tetriminos.at(0);
+    int depth = std::clamp(this->settings.depth, 1, static_cast<int>(tetriminos.size()));
+    std::size_t beamWidth = static_cast<std::size_t>(std::max(this->settings.beamWidth, 1));
+
+    // the first placement needs a path to reach it so it comes from a graph search
+    makeGraph(this->context.firstGraph, firstTetrimino, grid);
+    search(&this->context.firstGraph, firstTetrimino, grid, this->context.queue, this->context.firstResults);
+
+    this->beam.clear();
+    this->beam.push_back({ .grid = grid, .linesCleared = 0, .firstResult = -1 });
+    int totalLockHeight = 0;
+
+    for (int ply = 0; ply < depth; ply++) {
+        Tetrimino tetrimino = tetriminos[ply];
+        totalLockHeight += tetrimino.getHeight();
+        this->candidates.clear();
+
+        for (int parent = 0; parent < static_cast<int>(this->beam.size()); parent++) {
+            GameGrid& parentGrid = this->beam[parent].grid;
+
+            if (ply > 0) {
+                findPlacements(tetrimino, parentGrid, this->context.secondBoard, this->context.secondResults);
+            }
+            int placementCount = static_cast<int>(ply == 0 ? this->context.firstResults.size() : this->context.secondResults.size());
+
+            for (int i = 0; i < placementCount; i++) {
+                Tetrimino placement = ply == 0 
+                    ? this->context.firstGraph.getTetrimino(this->context.firstResults[i]) 
+                    : this->context.secondResults[i];
+                if (parentGrid.checkCollision(placement)) {
+                    continue;
+                }
+
+                GameGrid gridCopy = parentGrid;
+                gridCopy.setCells(placement);
+                int linesCleared = this->beam[parent].linesCleared + gridCopy.clearFullRows();
+
+                this->candidates.push_back({
+                    .fitness = computeBoardFitness(this->context, gridCopy, totalLockHeight, linesCleared, weights),
+                    .order = static_cast<int>(this->candidates.size()),
+                    .parent = parent,
+                    .firstResult = ply == 0 ? i : this->beam[parent].firstResult,
+                    .placement = placement,
+                });
+            }
+        }
+
+        if (this->candidates.empty()) { // nothing fits so the best board from the previous ply stands
+            break;
+        }
+
+        std::size_t keep = std::min(beamWidth, this->candidates.size());
+        std::partial_sort(
+            this->candidates.begin(), 
+            this->candidates.begin() + keep, 
+            this->candidates.end(), 
+            [](const BeamCandidate& a, const BeamCandidate& b) {
+                if (a.fitness != b.fitness) {
+                    return a.fitness < b.fitness;
+                }
+                if (a.firstResult != b.firstResult) {
+                    return a.firstResult < b.firstResult;
+                }
+                return a.order < b.order;
+            });
+
+        this->nextBeam.clear();
+        for (std::size_t i = 0; i < keep; i++) {
+            const BeamCandidate& candidate = this->candidates[i];
+            BeamState state = this->beam[candidate.parent];
+            state.grid.setCells(candidate.placement);
+            state.linesCleared += state.grid.clearFullRows();
+            state.grid.getFeatures(); // updated once here rather than in every candidate copied from it
+            state.firstResult = candidate.firstResult;
+            this->nextBeam.push_back(state);
+        }
+        std::swap(this->beam, this->nextBeam);
+    }
+    flushTranspositionCounters(this->context);
+
+    // the beam is sorted best first
+    if (this->beam[0].firstResult < 0) { // every first placement collides
+        return this->context.firstResults.at(0);
+    }
+    return this->context.firstResults[this->beam[0].firstResult];
+}
+
+Moves BeamSearchSolver::solveForMovesToOptimalTetrimino(GameGrid grid, const std::vector<Tetrimino>& tetriminos, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, tetriminos, weights);
+    return movesToReachSearchResult(&this->context.firstGraph, bestResult);
+}
+
+Tetrimino BeamSearchSolver::solveForOptimalTetrimino(GameGrid grid, const std::vector<Tetrimino>& tetriminos, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, tetriminos, weights);
+    return this->context.firstGraph.getTetrimino(bestResult);
+}
@@ -0,0 +1,66 @@
+#ifndef BEAM_SEARCH_H
+#define BEAM_SEARCH_H
+
+#include <vector>
+#include "solver.h"
+#include "tetris.h"
+#include "transposition_table.h"
+
+/*
+ * depth: how many tetriminos to place, starting with the current one. Limited by how many tetriminos 
+ * are passed to solve.
+ * beamWidth: how many boards are kept after each placement
+ */
+struct BeamSettings {
+    int depth = 2;
+    int beamWidth = 32;
+};
+
+/*
+ * Looks further ahead than solve() by placing every tetrimino of the preview queue, but only 
+ * expands the beamWidth best boards after each placement instead of every combination. Time grows
+ * linearly with depth instead of exponentially.
+ * Boards are scored with computeBoardFitness like solve() scores its leaves, with lines cleared 
+ * summed over every placement so far. The first placement leading to the best board at the 
+ * last ply is chosen. Like solve(), ties go to the first placement that search found first.
+ */
+class BeamSearchSolver {
+    private:
+    // A board in the beam, the placement that produced it and the first placement it descends from
+    struct BeamState {
+        GameGrid grid;
+        int linesCleared = 0;
+        int firstResult = 0; // index into context.firstResults
+    };
+
+    // A possible next board, only turned into a BeamState if it makes it into the beam
+    struct BeamCandidate {
+        double fitness;
+        int order; // position in which the candidate was generated, breaks the remaining ties
+        int parent; // index into beam
+        int firstResult;
+        Tetrimino placement;
+    };
+
+    SolverContext context;
+    std::vector<BeamState> beam;
+    std::vector<BeamState> nextBeam;
+    std::vector<BeamCandidate> candidates;
+
+    public:
+    BeamSettings settings; // can be changed between solves
+
+    public:
+    // transpositionTable is not owned and may be shared with other solvers, null to evaluate every board
+    explicit BeamSearchSolver(BeamSettings settings = BeamSettings(), TranspositionTable* transpositionTable = nullptr);
+
+    // tetriminos holds the current tetrimino followed by the preview queue. The returned node refers
+    // to getFirstGraph() and is valid until the next solve
+    NodeIndex solve(GameGrid& grid, const std::vector<Tetrimino>& tetriminos, EvaluationWeights weights);
+    Graph* getFirstGraph() { return &this->context.firstGraph; };
+
+    Moves solveForMovesToOptimalTetrimino(GameGrid grid, const std::vector<Tetrimino>& tetriminos, EvaluationWeights weights);
+    Tetrimino solveForOptimalTetrimino(GameGrid grid, const std::vector<Tetrimino>& tetriminos, EvaluationWeights weights);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef BOARD_FEATURES_H
+#define BOARD_FEATURES_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include "constants.h"
+
+/// The board dependent parts of EvaluationFactors, see computeEvaluationFactors for their definitions
+struct BoardFeatures {
+    int wellCells = 0;
+    int columnHoles = 0;
+    int columnTransitions = 0;
+    int rowTransitions = 0;
+};
+
+/// Kernels computing each feature from occupancy masks instead of reading cells one at a time.
+/// Rows are masks with bit x set when column x is filled, as stored by GameGrid. Columns are the
+/// transpose, bit y set when row y is filled. Like computeEvaluationFactors, the column features
+/// ignore row 0.
+
+const uint32_t COLUMN_MASK = (uint32_t(1) << GRID_HEIGHT) - 1;
+const uint32_t WALL_COLUMN = COLUMN_MASK; // the walls count as filled when looking for wells
+
+// Row transitions counted cell by cell, only used to fill rowTransitionTable
+constexpr int countRowTransitionsByCell(uint16_t row) {
+    if (row == 0) { // empty rows have none
+        return 0;
+    }
+    int transitions = 0;
+    bool solid = true; // the left wall
+    for (int col = 0; col < GRID_WIDTH; col++) {
+        bool filled = row & (1 << col);
+        if (filled != solid) {
+            transitions++;
+            solid = filled;
+        }
+    }
+    return solid ? transitions : transitions + 1; // the right wall
+}
+
+constexpr std::array<uint8_t, 1 << GRID_WIDTH> rowTransitionTable = [] {
+    std::array<uint8_t, 1 << GRID_WIDTH> table{};
+    for (int row = 0; row < (1 << GRID_WIDTH); row++) {
+        table[row] = static_cast<uint8_t>(countRowTransitionsByCell(static_cast<uint16_t>(row)));
+    }
+    return table;
+}();
+
+constexpr int countRowTransitions(uint16_t row) {
+    return rowTransitionTable[row];
+}
+
+// Highest filled row below row 0, GRID_HEIGHT when there is none
+constexpr int columnTop(uint32_t column) {
+    uint32_t belowSpawnRow = column & ~uint32_t(1);
+    return belowSpawnRow == 0 ? GRID_HEIGHT : std::countr_zero(belowSpawnRow);
+}
+
+// Empty cells directly below a filled cell
+constexpr int countColumnHoles(uint32_t column) {
+    uint32_t filledAbove = (column & ~uint32_t(1)) << 1; // bit y set when row y-1 is filled
+    return std::popcount(~column & filledAbove & COLUMN_MASK);
+}
+
+// Changes between filled and empty going down from the top filled cell
+constexpr int countColumnTransitions(uint32_t column) {
+    int top = columnTop(column);
+    uint32_t changes = (column ^ (column << 1)) & COLUMN_MASK & ~uint32_t(3); // bit y compares rows y-1 and y, from row 2 down
+    // the change from empty to the top cell isn't a transition
+    return std::popcount(changes) - (top >= 2 and top < GRID_HEIGHT ? 1 : 0);
+}
+
+// Empty cells above the top of the column with both neighbours filled. left and right are the
+// neighbouring columns, or WALL_COLUMN at the edges
+constexpr int countColumnWellCells(uint32_t column, uint32_t left, uint32_t right) {
+    uint32_t aboveTop = ((uint32_t(1) << columnTop(column)) - 1) & ~uint32_t(1);
+    return std::popcount(aboveTop & left & right);
+}
+
+constexpr std::array<uint32_t, GRID_WIDTH> transposeRows(const std::array<uint16_t, GRID_HEIGHT>& rows) {
+    std::array<uint32_t, GRID_WIDTH> columns{};
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        for (uint16_t row = rows[y]; row != 0; row &= row - 1) {
+            columns[std::countr_zero(row)] |= uint32_t(1) << y;
+        }
+    }
+    return columns;
+}
+
+// Every feature of a board at once, from its row masks
+constexpr BoardFeatures computeBoardFeatures(const std::array<uint16_t, GRID_HEIGHT>& rows) {
+    BoardFeatures features;
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        features.rowTransitions += countRowTransitions(rows[y]);
+    }
+    std::array<uint32_t, GRID_WIDTH> columns = transposeRows(rows);
+    for (int col = 0; col < GRID_WIDTH; col++) {
+        uint32_t left = col == 0 ? WALL_COLUMN : columns[col - 1];
+        uint32_t right = col == GRID_WIDTH - 1 ? WALL_COLUMN : columns[col + 1];
+        features.columnHoles += countColumnHoles(columns[col]);
+        features.columnTransitions += countColumnTransitions(columns[col]);
+        features.wellCells += countColumnWellCells(columns[col], left, right);
+    }
+    return features;
+}
+
+#endif
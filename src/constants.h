@@ -3,6 +3,7 @@
 
 const int GRID_WIDTH = 10; // width in blocks
 const int GRID_HEIGHT = 20;
+const int FULL_ROW_MASK = (1 << GRID_WIDTH) - 1; // GameGrid row bitmask with every column filled
 const int BLOCK_SIZE = 12;
 const int GAP_SIZE = 2;
 const int GRID_FRAME_WIDTH = GRID_WIDTH * (BLOCK_SIZE + GAP_SIZE) + GAP_SIZE; // width in pixels
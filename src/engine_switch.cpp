@@ -0,0 +1,79 @@
+#include <memory>
+#include <string>
+#include "engine_switch.h"
+#include "expectimax.h"
+#include "mcts.h"
+#include "parallel_solver.h"
+#include "solver_stats.h"
+#include "perf_counters.h"
+#include "trace.h"
+
+const char* solverEngineName(SolverEngine engine) {
+    switch (engine) {
+        case expectimaxEngine:
+            return "expectimax";
+        case mctsEngine:
+            return "mcts";
+        default:
+            return "two-ply";
+    }
+}
+
+bool parseSolverEngine(const std::string& name, SolverEngine& engine) {
+    for (int i = 0; i < numSolverEngines; i++) {
+        if (name == solverEngineName(static_cast<SolverEngine>(i))) {
+            engine = static_cast<SolverEngine>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+ParallelSolver& EngineSwitch::getTwoPlySolver() {
+    if (not this->twoPlySolver) {
+        this->twoPlySolver = std::make_unique<ParallelSolver>(this->threadCount, this->transpositionTableBytes);
+    }
+    return *this->twoPlySolver;
+}
+
+ExpectimaxSolver& EngineSwitch::getExpectimaxSolver() {
+    if (not this->expectimaxSolver) {
+        this->expectimaxSolver = std::make_unique<ExpectimaxSolver>(this->threadCount, this->transpositionTableBytes);
+    }
+    return *this->expectimaxSolver;
+}
+
+MctsSolver& EngineSwitch::getMctsSolver() {
+    if (not this->mctsSolver) {
+        this->mctsSolver = std::make_unique<MctsSolver>(this->mctsSettings, this->threadCount, this->transpositionTableBytes);
+    }
+    return *this->mctsSolver;
+}
+
+Moves EngineSwitch::solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    SOLVER_STATS_TIME_SOLVE();
+    TRACE_SCOPE("solve");
+    PERF_PHASE(solvePhase);
+    switch (this->engine) {
+        case expectimaxEngine:
+            return this->getExpectimaxSolver().solveForMovesToOptimalTetrimino(grid, firstTetrimino, secondTetrimino, weights);
+        case mctsEngine:
+            return this->getMctsSolver().solveForMovesToOptimalTetrimino(grid, firstTetrimino, secondTetrimino, weights);
+        default:
+            return this->getTwoPlySolver().solveForMovesToOptimalTetrimino(grid, firstTetrimino, secondTetrimino, weights);
+    }
+}
+
+Tetrimino EngineSwitch::solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    SOLVER_STATS_TIME_SOLVE();
+    TRACE_SCOPE("solve");
+    PERF_PHASE(solvePhase);
+    switch (this->engine) {
+        case expectimaxEngine:
+            return this->getExpectimaxSolver().solveForOptimalTetrimino(grid, firstTetrimino, secondTetrimino, weights);
+        case mctsEngine:
+            return this->getMctsSolver().solveForOptimalTetrimino(grid, firstTetrimino, secondTetrimino, weights);
+        default:
+            return this->getTwoPlySolver().solveForOptimalTetrimino(grid, firstTetrimino, secondTetrimino, weights);
+    }
+}
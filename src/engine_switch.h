@@ -0,0 +1,55 @@
+#ifndef ENGINE_SWITCH_H
+#define ENGINE_SWITCH_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include "expectimax.h"
+#include "mcts.h"
+#include "parallel_solver.h"
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+
+enum SolverEngine {
+    twoPlyEngine,       // ParallelSolver
+    expectimaxEngine,   // ExpectimaxSolver
+    mctsEngine          // MctsSolver
+};
+const int numSolverEngines = 3;
+
+const char* solverEngineName(SolverEngine engine);
+// Sets engine and returns true when name is one of the names above
+bool parseSolverEngine(const std::string& name, SolverEngine& engine);
+
+/*
+ * The solvers that take the current and next tetrimino, behind one solveForMovesToOptimalTetrimino 
+ * so the engine can be changed between moves. Each solver is only created the first time its 
+ * engine is used since they all hold a thread pool and transposition table.
+ */
+class EngineSwitch {
+    private:
+    std::unique_ptr<ParallelSolver> twoPlySolver;
+    std::unique_ptr<ExpectimaxSolver> expectimaxSolver;
+    std::unique_ptr<MctsSolver> mctsSolver;
+
+    private:
+    ParallelSolver& getTwoPlySolver();
+    ExpectimaxSolver& getExpectimaxSolver();
+    MctsSolver& getMctsSolver();
+
+    public:
+    SolverEngine engine = twoPlyEngine;
+    MctsSettings mctsSettings; // used when the MCTS solver is created
+    // used when any solver is created
+    int threadCount = ThreadPool::defaultThreadCount();
+    std::size_t transpositionTableBytes = 16 << 20;
+
+    public:
+    void nextEngine() { this->engine = static_cast<SolverEngine>((this->engine + 1) % numSolverEngines); };
+
+    Moves solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Tetrimino solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+};
+
+#endif
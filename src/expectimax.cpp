@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <optional>
+#include <vector>
+#include "expectimax.h"
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+
+std::array<double, N> nextShapeProbabilities() {
+    std::array<double, N> probabilities{};
+    for (int shape = 0; shape < numTetriminoShapes; shape++) {
+        probabilities[shape] = 1.0 / numTetriminoShapes;
+    }
+    return probabilities;
+}
+
+ExpectimaxSolver::ExpectimaxSolver(int threadCount, std::size_t transpositionTableBytes) :
+    pool(threadCount),
+    workers(pool.size()),
+    probabilities(nextShapeProbabilities())
+{
+    if (transpositionTableBytes > 0) {
+        this->transpositionTable = std::make_unique<TranspositionTable>(transpositionTableBytes);
+    }
+    for (Worker& worker : this->workers) {
+        worker.context.transpositionTable = this->transpositionTable.get();
+        worker.secondBoards.reserve(GRAPH_SIZE);
+        worker.thirdResults.reserve(GRAPH_SIZE);
+    }
+    this->values.resize(GRAPH_SIZE);
+}
+
+std::optional<double> ExpectimaxSolver::evaluateFirstPlacement(
+    Worker& worker,
+    GameGrid& grid,
+    Tetrimino firstPlacement,
+    Tetrimino firstTetrimino,
+    Tetrimino secondTetrimino,
+    EvaluationWeights weights
+) {
+    if (grid.checkCollision(firstPlacement)) {
+        return std::nullopt;
+    }
+    GameGrid firstGrid = grid;
+    firstGrid.setCells(firstPlacement);
+    int firstLinesCleared = firstGrid.clearFullRows();
+
+    bool pruning = this->pruning and not hasNegativeWeight(weights); // the bound needs every weight to penalize
+
+    worker.secondBoards.clear();
+    findPlacements(secondTetrimino, firstGrid, worker.context.secondBoard, worker.context.secondResults);
+    for (Tetrimino secondPlacement : worker.context.secondResults) {
+        if (firstGrid.checkCollision(secondPlacement)) {
+            continue;
+        }
+        SecondBoard secondBoard = { .grid = firstGrid, .linesCleared = 0, .bound = 0.0 };
+        secondBoard.grid.setCells(secondPlacement);
+        secondBoard.linesCleared = firstLinesCleared + secondBoard.grid.clearFullRows();
+        secondBoard.grid.getFeatures(); // brought up to date once for all the third placements copied from it
+        if (pruning) {
+            int totalLockHeight = firstTetrimino.getHeight() + secondTetrimino.getHeight();
+            secondBoard.bound = computeNextPlacementBound(secondBoard.grid, totalLockHeight, secondBoard.linesCleared, weights);
+        }
+        worker.secondBoards.push_back(secondBoard);
+    }
+    if (worker.secondBoards.empty()) {
+        return std::nullopt;
+    }
+    worker.stats.secondBoards += static_cast<int>(worker.secondBoards.size());
+    if (pruning) { // stable so equal bounds keep the order findPlacements gave
+        std::stable_sort(
+            worker.secondBoards.begin(),
+            worker.secondBoards.end(),
+            [](const SecondBoard& a, const SecondBoard& b) { return a.bound < b.bound; });
+    }
+
+    // lowest fitness found for each third shape over every second placement
+    std::array<double, N> bestFitnesses;
+    bestFitnesses.fill(std::numeric_limits<double>::infinity());
+
+    for (int shape = 0; shape < N; shape++) {
+        if (this->probabilities[shape] == 0.0) {
+            continue;
+        }
+        Tetrimino thirdTetrimino(static_cast<TetriminoShape>(shape), SPAWN_X_DELTA, 0, 0);
+        int totalLockHeight = firstTetrimino.getHeight() + secondTetrimino.getHeight() + thirdTetrimino.getHeight();
+
+        for (SecondBoard& secondBoard : worker.secondBoards) {
+            GameGrid& secondGrid = secondBoard.grid;
+            if (secondGrid.checkCollision(thirdTetrimino)) { // the game would be over
+                bestFitnesses[shape] = std::min(bestFitnesses[shape], TOP_OUT_FITNESS);
+                continue;
+            }
+            if (pruning and computeNextPlacementBound(secondGrid, totalLockHeight, secondBoard.linesCleared, weights) >= bestFitnesses[shape]) {
+                worker.stats.prunedChanceNodes++;
+                continue;
+            }
+
+            findPlacements(thirdTetrimino, secondGrid, worker.thirdBoard, worker.thirdResults);
+            for (Tetrimino thirdPlacement : worker.thirdResults) {
+                if (secondGrid.checkCollision(thirdPlacement)) {
+                    continue;
+                }
+                GameGrid thirdGrid = secondGrid;
+                thirdGrid.setCells(thirdPlacement);
+                int linesCleared = secondBoard.linesCleared + thirdGrid.clearFullRows();
+                double fitness = computeBoardFitness(worker.context, thirdGrid, totalLockHeight, linesCleared, weights);
+                bestFitnesses[shape] = std::min(bestFitnesses[shape], fitness);
+                worker.stats.evaluatedLeaves++;
+            }
+        }
+    }
+
+    double value = 0.0;
+    for (int shape = 0; shape < N; shape++) {
+        if (this->probabilities[shape] == 0.0) {
+            continue;
+        }
+        // no third placement at all means every one of them was blocked, treat it like a top out
+        double fitness = bestFitnesses[shape] == std::numeric_limits<double>::infinity() ? TOP_OUT_FITNESS : bestFitnesses[shape];
+        value += this->probabilities[shape] * fitness;
+    }
+    return value;
+}
+
+NodeIndex ExpectimaxSolver::solve(GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    makeGraph(this->context.firstGraph, firstTetrimino, grid);
+    search(&this->context.firstGraph, firstTetrimino, grid, this->context.queue, this->context.firstResults);
+    for (Worker& worker : this->workers) {
+        worker.stats = ExpectimaxStats();
+    }
+
+    auto evaluateTask = [&](int task, int worker) {
+        Tetrimino firstPlacement = this->context.firstGraph.getTetrimino(this->context.firstResults[task]);
+        this->values[task] = this->evaluateFirstPlacement(
+            this->workers[worker], grid, firstPlacement, firstTetrimino, secondTetrimino, weights);
+    };
+    this->pool.run(static_cast<int>(this->context.firstResults.size()), evaluateTask);
+
+    this->stats = ExpectimaxStats();
+    this->stats.firstPlacements = static_cast<int>(this->context.firstResults.size());
+    for (Worker& worker : this->workers) {
+        flushTranspositionCounters(worker.context);
+        this->stats.secondBoards += worker.stats.secondBoards;
+        this->stats.prunedChanceNodes += worker.stats.prunedChanceNodes;
+        this->stats.evaluatedLeaves += worker.stats.evaluatedLeaves;
+    }
+
+    // scanned in search order so the result doesn't depend on which worker finished first
+    NodeIndex bestResult = NO_NODE;
+    double bestValue = 0.0;
+    for (std::size_t i = 0; i < this->context.firstResults.size(); i++) {
+        const std::optional<double>& value = this->values[i];
+        if (not value) { // the second tetrimino couldn't be placed
+            continue;
+        }
+        if (bestResult == NO_NODE or *value < bestValue) {
+            bestValue = *value;
+            bestResult = this->context.firstResults[i];
+        }
+    }
+
+    return bestResult != NO_NODE ? bestResult : this->context.firstResults.at(0);
+}
+
+Moves ExpectimaxSolver::solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, firstTetrimino, secondTetrimino, weights);
+    return movesToReachSearchResult(&this->context.firstGraph, bestResult);
+}
+
+Tetrimino ExpectimaxSolver::solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, firstTetrimino, secondTetrimino, weights);
+    return this->context.firstGraph.getTetrimino(bestResult);
+}
@@ -0,0 +1,91 @@
+#ifndef EXPECTIMAX_H
+#define EXPECTIMAX_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+#include "transposition_table.h"
+
+// Chance of each shape coming next, matching GameState's randomizer which picks uniformly among the
+// first numTetriminoShapes shapes. Shapes it never picks get 0 and are never evaluated.
+std::array<double, N> nextShapeProbabilities();
+
+// Scored instead of a board when the third tetrimino can't spawn, high enough that any board
+// avoiding a top out is preferred
+const double TOP_OUT_FITNESS = 1e12;
+
+// What the last solve did, summed over workers
+struct ExpectimaxStats {
+    int firstPlacements = 0;
+    int secondBoards = 0;
+    int prunedChanceNodes = 0; // (second board, third shape) pairs skipped by the bound
+    int evaluatedLeaves = 0;
+};
+
+/*
+ * Three tetrimino search where the third one is unknown. The third tetrimino is revealed before the
+ * second has to be placed, so a first placement is worth the expectation, over the third shape,
+ * of the best board reachable by placing the second and third tetriminos:
+ *     value(first) = sum over shapes of probability(shape) * min over (second, third) of fitness
+ * The first placement with the lowest value is chosen, ties going to the earliest in search order
+ * like solve(). Lines cleared are summed over all three placements like the beam search does.
+ *
+ * First placements are handed out to a thread pool. A worker places the second tetrimino once and
+ * shares the boards between every chance shape. They are expanded most promising first so that a
+ * shape's third placements can be skipped as soon as computeNextPlacementBound shows they can't
+ * beat that shape's best board so far.
+ */
+class ExpectimaxSolver {
+    private:
+    // A board after the second placement, expanded for every third shape
+    struct SecondBoard {
+        GameGrid grid;
+        int linesCleared;
+        double bound; // computeNextPlacementBound without the third tetrimino's lock height, for ordering
+    };
+
+    // Per worker scratch space, the context's second* buffers hold the second tetrimino's placements
+    struct Worker {
+        SolverContext context;
+        std::vector<SecondBoard> secondBoards;
+        PlacementBoard thirdBoard;
+        std::vector<Tetrimino> thirdResults;
+        ExpectimaxStats stats;
+    };
+
+    ThreadPool pool;
+    std::unique_ptr<TranspositionTable> transpositionTable;
+    SolverContext context; // holds the first tetrimino's graph and search results
+    std::vector<Worker> workers;
+    std::vector<std::optional<double>> values; // indexed like context.firstResults, empty when the second tetrimino can't be placed
+    std::array<double, N> probabilities;
+
+    private:
+    std::optional<double> evaluateFirstPlacement(
+        Worker& worker, GameGrid& grid, Tetrimino firstPlacement, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+
+    public:
+    bool pruning = true; // can be turned off to check that pruning doesn't change results
+    ExpectimaxStats stats;
+
+    public:
+    explicit ExpectimaxSolver(
+        int threadCount = ThreadPool::defaultThreadCount(),
+        std::size_t transpositionTableBytes = 16 << 20);
+    int threadCount() const { return this->pool.size(); };
+
+    // The returned node refers to getFirstGraph() and is valid until the next solve
+    NodeIndex solve(GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Graph* getFirstGraph() { return &this->context.firstGraph; };
+    std::optional<double> getValue(int firstResultIndex) const { return this->values[firstResultIndex]; };
+
+    Moves solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Tetrimino solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+};
+
+#endif
@@ -9,16 +9,28 @@
 
 #include "constants.h"
 #include "tetris.h"
+#include "render.h"
 #include "solver.h"
+#include "engine_switch.h"
+#include "trace.h"
+
+// Usage: lazy [two-ply | expectimax | mcts]
+// Picks the solver to start with, pressing E switches to the next one from the following tetrimino on.
+int main(int argc, char** argv) { 
+    EngineSwitch solver;
+    if (argc >= 2 and not parseSolverEngine(argv[1], solver.engine)) {
+        std::cout << "unknown engine " << argv[1] << std::endl;
+        return 1;
+    }
+
+    bool tracing = startTracingFromEnvironment(); // TETRIS_TRACE=trace.json to see frame hitches
 
-int main(void) { 
     // third party setup
-    srand(static_cast<unsigned int>(time(0)));
     InitWindow(GRID_FRAME_WIDTH + 75, GRID_FRAME_HEIGHT, "Tetris");
     SetTargetFPS(60); // my 2014 macbook gets too warm at 60 fps
     
     // core game logic classes
-    GameState state;
+    GameState state(1, static_cast<uint64_t>(time(0)));
     state.playerControlled = false;
     FrameDrawer frameDrawer;
 
@@ -31,7 +43,7 @@ int main(void) {
         .totalRowTransitions = 30.185110719279040
     };
 
-    Moves moves = solveForMovesToOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
+    Moves moves = solver.solveForMovesToOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
     std::vector<Move>::iterator currentMove = moves.begin();
 
     int frameCounter = 0;
@@ -46,6 +58,10 @@ int main(void) {
         if (IsKeyPressed(KEY_UP)) {
             // increase speed
         }
+        if (IsKeyPressed(KEY_E)) {
+            solver.nextEngine();
+            std::cout << "engine: " << solverEngineName(solver.engine) << std::endl;
+        }
 
         if (frameCounter >= state.fallSpeed() and not state.isCurrentTetrominoPlaced()) {
             if (std::holds_alternative<Direction>(*currentMove)) {
@@ -70,7 +86,7 @@ int main(void) {
 
         if (state.isCurrentTetrominoPlaced() and frameCounter >= FRAMES_PER_TETRONIMO_RESET) {
             state.initNewTetrimino();
-            moves = solveForMovesToOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
+            moves = solver.solveForMovesToOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
             currentMove = moves.begin();
             frameCounter = 0;
         }
@@ -92,5 +108,8 @@ int main(void) {
     }
     
     CloseWindow();
+    if (tracing) {
+        writeTrace();
+    }
     return 0;
 }
\ No newline at end of file
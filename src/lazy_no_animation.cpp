@@ -1,24 +1,54 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
 #include <time.h>
+#include <vector>
 
 #include <raylib.h>
 #include <raymath.h>
 
 #include "constants.h"
 #include "tetris.h"
+#include "render.h"
 #include "solver.h"
+#include "beam_search.h"
+#include "engine_switch.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+// Usage: lazy_no_animation [depth beamWidth | engine [mctsBudgetMs]]
+// Without arguments the two piece solver is used. With depth and beamWidth the beam search solver
+// places depth tetriminos (the current one plus depth - 1 previewed ones) keeping beamWidth boards
+// per placement. engine is one of two-ply, expectimax or mcts, mctsBudgetMs being the time MCTS
+// gets per move. Unless the beam search is used, pressing E switches to the next engine.
+int main(int argc, char** argv) { 
+    EngineSwitch solver;
+    bool useBeamSearch = argc >= 3 and not parseSolverEngine(argv[1], solver.engine);
+    if (argc >= 2 and not useBeamSearch and not parseSolverEngine(argv[1], solver.engine)) {
+        std::cout << "unknown engine " << argv[1] << std::endl;
+        return 1;
+    }
+    if (argc >= 3 and solver.engine == mctsEngine) {
+        solver.mctsSettings.moveBudget = std::chrono::milliseconds(std::max(1, atoi(argv[2])));
+    }
+    BeamSettings beamSettings;
+    if (useBeamSearch) {
+        beamSettings.depth = std::max(1, atoi(argv[1]));
+        beamSettings.beamWidth = std::max(1, atoi(argv[2]));
+    }
+
+    bool tracing = startTracingFromEnvironment(); // TETRIS_TRACE=trace.json for a timeline of every solve
 
-int main(void) { 
     // third party setup
-    srand(static_cast<unsigned int>(time(0)));
     InitWindow(GRID_FRAME_WIDTH + 75, GRID_FRAME_HEIGHT, "Tetris");
     SetTargetFPS(60); // my 2014 macbook gets too warm at 60 fps
     
     // core game logic classes
-    GameState state;
+    GameState state(useBeamSearch ? beamSettings.depth - 1 : 1, static_cast<uint64_t>(time(0)));
     state.playerControlled = false;
     FrameDrawer frameDrawer;
+    BeamSearchSolver beamSearchSolver(beamSettings);
 
     EvaluationWeights weights = {
         .totalLinesCleared = 1.0,
@@ -29,12 +59,29 @@ int main(void) {
         .totalRowTransitions = 30.185110719279040
     };
 
-    Tetrimino tetriminoToPlace = solveForOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
+    auto solveForOptimalTetrimino = [&]() {
+        if (useBeamSearch) {
+            std::vector<Tetrimino> tetriminos = state.getPreviewTetriminos();
+            tetriminos.insert(tetriminos.begin(), state.getCurrentTetrimino());
+            return beamSearchSolver.solveForOptimalTetrimino(state.getGrid(), tetriminos, weights);
+        }
+        return solver.solveForOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
+    };
+
+    auto startTime = std::chrono::steady_clock::now();
+    int piecesPlaced = 0;
+    Tetrimino tetriminoToPlace = solveForOptimalTetrimino();
 
     // main gameplay loop
     while (!WindowShouldClose() and !state.gameOver) {
+        if (IsKeyPressed(KEY_E) and not useBeamSearch) {
+            solver.nextEngine();
+            std::cout << "engine: " << solverEngineName(solver.engine) << std::endl;
+        }
+
         state.currentTetrimino = tetriminoToPlace;
         state.moveTetrimino(down);
+        piecesPlaced++;
 
         if (state.isLineClearInProgress()) {
             state.clearFullLines();
@@ -42,13 +89,31 @@ int main(void) {
         }
 
         state.initNewTetrimino();
-        tetriminoToPlace = solveForOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), weights);
+        tetriminoToPlace = solveForOptimalTetrimino();
 
         frameDrawer.drawFrame(state, false);
     }
 
     std::cout << "Game Over" << std::endl;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    if (useBeamSearch) {
+        std::cout << "depth: " << beamSettings.depth << " beam width: " << beamSettings.beamWidth << std::endl;
+    }
+    else {
+        std::cout << "engine: " << solverEngineName(solver.engine) << std::endl;
+    }
+    std::cout << "pieces: " << piecesPlaced << " lines cleared: " << state.linesCleared << std::endl;
+    std::cout << "pieces/sec: " << piecesPlaced / seconds << std::endl;
+    if (solverStatsEnabled()) {
+        std::cout << "solver stats: ";
+        printSolverStats(std::cout, getSolverStats());
+        std::cout << std::endl;
+    }
     
     CloseWindow();
+    if (tracing) {
+        writeTrace();
+    }
     return 0;
 }
\ No newline at end of file
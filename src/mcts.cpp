@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mcts.h"
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+
+MctsSolver::MctsSolver(MctsSettings settings, int threadCount, std::size_t transpositionTableBytes) :
+    pool(threadCount),
+    workers(pool.size()),
+    settings(settings)
+{
+    if (transpositionTableBytes > 0) {
+        this->transpositionTable = std::make_unique<TranspositionTable>(transpositionTableBytes);
+    }
+    for (Worker& worker : this->workers) {
+        worker.context.transpositionTable = this->transpositionTable.get();
+        worker.path.reserve(3);
+    }
+}
+
+double MctsSolver::averageCost(const Node& node) const {
+    double range = this->highestCost - this->lowestCost;
+    int costedVisits = node.visits - node.topOuts;
+    double total = node.topOuts + node.virtualVisits; // each counts as the highest cost
+    if (costedVisits > 0 and range > 0) {
+        total += costedVisits * (node.costSum / costedVisits - this->lowestCost) / range;
+    }
+    return total / (node.visits + node.virtualVisits);
+}
+
+int MctsSolver::selectChild(const Node& parent) const {
+    double logVisits = std::log(std::max(1, parent.visits + parent.virtualVisits));
+    int bestChild = -1;
+    double bestScore = 0.0;
+    for (int child = parent.firstChild; child < parent.firstChild + parent.childCount; child++) {
+        const Node& node = this->nodes[child];
+        int visits = node.visits + node.virtualVisits;
+        if (visits == 0) { // unvisited children go first, in search order
+            return child;
+        }
+        double score = this->averageCost(node) - this->settings.exploration * std::sqrt(logVisits / visits);
+        if (bestChild < 0 or score < bestScore) {
+            bestChild = child;
+            bestScore = score;
+        }
+    }
+    return bestChild;
+}
+
+// Called and returns with lock held, but releases it while finding the children so other workers
+// can go on selecting and backpropagating. Virtual losses on the root and node steer them to other
+// first placements meanwhile.
+void MctsSolver::expand(int node, Worker& worker, Tetrimino tetrimino, std::unique_lock<std::mutex>& lock) {
+    GameGrid grid = this->nodes[node].grid; // copied since other workers can add nodes and move them
+    int linesCleared = this->nodes[node].linesCleared;
+    if (grid.checkCollision(tetrimino)) {
+        this->nodes[node].toppedOut = true;
+        return;
+    }
+    this->nodes[node].expanding = true;
+    this->nodes[0].virtualVisits += this->settings.virtualLoss;
+    this->nodes[node].virtualVisits += this->settings.virtualLoss;
+    lock.unlock();
+
+    worker.children.clear();
+    findPlacements(tetrimino, grid, worker.context.secondBoard, worker.context.secondResults);
+    for (Tetrimino placement : worker.context.secondResults) {
+        if (grid.checkCollision(placement)) {
+            continue;
+        }
+        Node child;
+        child.grid = grid;
+        child.grid.setCells(placement);
+        child.linesCleared = linesCleared + child.grid.clearFullRows();
+        child.grid.getFeatures(); // brought up to date once for every rollout copying it
+        worker.children.push_back(child);
+    }
+
+    lock.lock();
+    this->nodes[0].virtualVisits -= this->settings.virtualLoss;
+    this->nodes[node].virtualVisits -= this->settings.virtualLoss;
+    this->nodes[node].expanding = false;
+    this->nodes[node].firstChild = static_cast<int>(this->nodes.size());
+    this->nodes[node].childCount = static_cast<int>(worker.children.size());
+    this->nodes[node].toppedOut = worker.children.empty();
+    this->nodes.insert(this->nodes.end(), worker.children.begin(), worker.children.end());
+}
+
+bool MctsSolver::rollout(Worker& worker, GameGrid grid, int totalLockHeight, int linesCleared, EvaluationWeights weights, double& cost) {
+    std::uniform_int_distribution<int> randomShape(0, numTetriminoShapes - 1); // like GameState's randomizer
+    cost = computeBoardFitness(worker.context, grid, totalLockHeight, linesCleared, weights);
+
+    for (int i = 0; i < this->settings.rolloutDepth; i++) {
+        Tetrimino tetrimino(static_cast<TetriminoShape>(randomShape(worker.rng)), SPAWN_X_DELTA, 0, 0);
+        if (grid.checkCollision(tetrimino)) {
+            return false;
+        }
+        totalLockHeight += tetrimino.getHeight();
+
+        findPlacements(tetrimino, grid, worker.context.secondBoard, worker.context.secondResults);
+        double bestFitness = std::numeric_limits<double>::infinity();
+        Tetrimino bestPlacement = tetrimino;
+        for (Tetrimino placement : worker.context.secondResults) {
+            if (grid.checkCollision(placement)) {
+                continue;
+            }
+            GameGrid gridCopy = grid;
+            gridCopy.setCells(placement);
+            int totalLinesCleared = linesCleared + gridCopy.clearFullRows();
+            double fitness = computeBoardFitness(worker.context, gridCopy, totalLockHeight, totalLinesCleared, weights);
+            if (fitness < bestFitness) {
+                bestFitness = fitness;
+                bestPlacement = placement;
+            }
+        }
+        if (bestFitness == std::numeric_limits<double>::infinity()) {
+            return false;
+        }
+
+        grid.setCells(bestPlacement);
+        linesCleared += grid.clearFullRows();
+        cost = bestFitness;
+    }
+    return true;
+}
+
+void MctsSolver::iterate(Worker& worker, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    std::unique_lock<std::mutex> lock(this->treeMutex);
+
+    // selection, expanding the first placement reached if it hasn't been yet
+    worker.path.clear();
+    worker.path.push_back(0);
+    int node = 0;
+    while (not this->nodes[node].toppedOut) {
+        if (this->nodes[node].firstChild < 0) {
+            if (worker.path.size() != 2) { // second placements are leaves
+                break;
+            }
+            if (this->nodes[node].expanding) { // wait for the worker finding its children
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+                continue;
+            }
+            this->expand(node, worker, secondTetrimino, lock);
+            if (this->nodes[node].toppedOut) {
+                break;
+            }
+        }
+        node = this->selectChild(this->nodes[node]);
+        worker.path.push_back(node);
+    }
+    for (int pathNode : worker.path) {
+        this->nodes[pathNode].virtualVisits += this->settings.virtualLoss;
+    }
+    bool toppedOut = this->nodes[node].toppedOut;
+    GameGrid grid = this->nodes[node].grid;
+    int linesCleared = this->nodes[node].linesCleared;
+    lock.unlock();
+
+    double cost = 0.0;
+    if (not toppedOut) {
+        int totalLockHeight = firstTetrimino.getHeight() + secondTetrimino.getHeight();
+        toppedOut = not this->rollout(worker, grid, totalLockHeight, linesCleared, weights, cost);
+        worker.rolloutTopOuts += toppedOut ? 1 : 0;
+    }
+    worker.iterations++;
+
+    lock.lock();
+    if (not toppedOut) {
+        this->lowestCost = this->costSeen ? std::min(this->lowestCost, cost) : cost;
+        this->highestCost = this->costSeen ? std::max(this->highestCost, cost) : cost;
+        this->costSeen = true;
+    }
+    for (int pathNode : worker.path) {
+        Node& visited = this->nodes[pathNode];
+        visited.virtualVisits -= this->settings.virtualLoss;
+        visited.visits++;
+        if (toppedOut) {
+            visited.topOuts++;
+        }
+        else {
+            visited.costSum += cost;
+        }
+    }
+}
+
+NodeIndex MctsSolver::solve(GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    makeGraph(this->context.firstGraph, firstTetrimino, grid);
+    search(&this->context.firstGraph, firstTetrimino, grid, this->context.queue, this->context.firstResults);
+
+    // the root and the first placements are expanded up front
+    this->nodes.clear();
+    Node root;
+    root.grid = grid;
+    root.firstChild = 1;
+    root.childCount = static_cast<int>(this->context.firstResults.size());
+    this->nodes.push_back(root);
+    for (NodeIndex firstResult : this->context.firstResults) {
+        Node child;
+        child.grid = grid;
+        child.grid.setCells(this->context.firstGraph.getTetrimino(firstResult));
+        child.linesCleared = child.grid.clearFullRows();
+        this->nodes.push_back(child);
+    }
+    this->costSeen = false;
+    if (root.childCount == 0) {
+        return this->context.firstResults.at(0);
+    }
+
+    for (int i = 0; i < static_cast<int>(this->workers.size()); i++) {
+        Worker& worker = this->workers[i];
+        worker.rng.seed(this->settings.seed + i);
+        worker.iterations = 0;
+        worker.rolloutTopOuts = 0;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + this->settings.moveBudget;
+    std::atomic<int> startedIterations{0};
+    auto runRollouts = [&](int, int worker) {
+        while (std::chrono::steady_clock::now() < deadline) {
+            if (this->settings.maxIterations > 0 and startedIterations.fetch_add(1) >= this->settings.maxIterations) {
+                break;
+            }
+            this->iterate(this->workers[worker], firstTetrimino, secondTetrimino, weights);
+        }
+    };
+    this->pool.run(this->pool.size(), runRollouts);
+
+    this->stats = MctsStats();
+    this->stats.expandedNodes = static_cast<int>(this->nodes.size());
+    for (Worker& worker : this->workers) {
+        flushTranspositionCounters(worker.context);
+        this->stats.iterations += worker.iterations;
+        this->stats.rolloutTopOuts += worker.rolloutTopOuts;
+    }
+
+    // the most visited first placement, scanned in search order
+    int bestChild = -1;
+    for (int child = root.firstChild; child < root.firstChild + root.childCount; child++) {
+        const Node& node = this->nodes[child];
+        if (bestChild < 0 or node.visits > this->nodes[bestChild].visits) {
+            bestChild = child;
+        }
+        else if (node.visits == this->nodes[bestChild].visits and node.visits > 0 and this->averageCost(node) < this->averageCost(this->nodes[bestChild])) {
+            bestChild = child;
+        }
+    }
+
+    return this->context.firstResults.at(bestChild < 0 ? 0 : bestChild - root.firstChild);
+}
+
+Moves MctsSolver::solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, firstTetrimino, secondTetrimino, weights);
+    return movesToReachSearchResult(&this->context.firstGraph, bestResult);
+}
+
+Tetrimino MctsSolver::solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, firstTetrimino, secondTetrimino, weights);
+    return this->context.firstGraph.getTetrimino(bestResult);
+}
@@ -0,0 +1,118 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+#include "transposition_table.h"
+
+/*
+ * moveBudget: wall clock time each solve spends running rollouts
+ * maxIterations: stop after this many rollouts even if there is time left, 0 for no limit. With one
+ * thread and a limit that is reached within the budget, a solve only depends on the seed.
+ * rolloutDepth: how many random tetriminos a rollout places after the two known ones
+ * exploration: UCT constant, applied to costs normalized to [0, 1]
+ * virtualLoss: how many top outs a rollout in flight counts as for the nodes on its path, which
+ * steers other workers towards different nodes until it finishes
+ */
+struct MctsSettings {
+    std::chrono::milliseconds moveBudget{50};
+    int maxIterations = 0;
+    int rolloutDepth = 3;
+    double exploration = 0.3;
+    int virtualLoss = 1;
+    uint32_t seed = 0;
+};
+
+// What the last solve did, summed over workers
+struct MctsStats {
+    int iterations = 0;
+    int expandedNodes = 0;
+    int rolloutTopOuts = 0;
+};
+
+/*
+ * Monte Carlo tree search over the current and next tetriminos. The tree has the placements search
+ * finds for the current tetrimino below the root and the placements of the next tetrimino below
+ * those, expanded the first time a first placement is selected. Placements after that are unknown,
+ * so instead of growing the tree further a rollout places rolloutDepth random tetriminos, each at
+ * the placement the weights score best, and the final board's fitness is the rollout's cost.
+ * Lines cleared and lock heights are summed over every placement like the beam search does.
+ * Children are selected with UCT on costs normalized by the lowest and highest seen so far,
+ * a top out counting as the highest.
+ *
+ * Every worker of the thread pool runs rollouts until the move budget is spent. Selection and
+ * backpropagation happen under one lock, rollouts and finding a node's children outside it, with
+ * virtual loss keeping concurrent rollouts and expansions apart. The first placement with the most rollouts is chosen, ties
+ * going to the lower average cost and then to the earliest in search order.
+ */
+class MctsSolver {
+    private:
+    struct Node {
+        GameGrid grid; // after this node's placement, full rows cleared
+        int linesCleared = 0; // over every placement down to this node
+        int firstChild = -1; // children are stored next to each other, -1 until expanded
+        int childCount = 0;
+        bool toppedOut = false; // the next tetrimino can't spawn or be placed
+        bool expanding = false; // a worker is finding its children outside the lock
+        int visits = 0;
+        int virtualVisits = 0; // virtual losses of the rollouts in flight
+        int topOuts = 0;
+        double costSum = 0.0; // over the rollouts that didn't top out
+    };
+
+    // Per worker scratch space, the context's second* buffers are used by rollouts
+    struct Worker {
+        SolverContext context;
+        std::mt19937 rng;
+        std::vector<int> path;
+        std::vector<Node> children; // found by expand before they are added to the tree
+        int iterations = 0;
+        int rolloutTopOuts = 0;
+    };
+
+    ThreadPool pool;
+    std::unique_ptr<TranspositionTable> transpositionTable;
+    SolverContext context; // holds the first tetrimino's graph and search results
+    std::vector<Worker> workers;
+    std::mutex treeMutex;
+    std::vector<Node> nodes; // the root is nodes[0], its children are indexed like context.firstResults
+    double lowestCost = 0.0;
+    double highestCost = 0.0;
+    bool costSeen = false;
+
+    private:
+    double averageCost(const Node& node) const; // normalized, virtual losses included
+    int selectChild(const Node& parent) const;
+    void expand(int node, Worker& worker, Tetrimino tetrimino, std::unique_lock<std::mutex>& lock);
+    void iterate(Worker& worker, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights); // one rollout
+    bool rollout(Worker& worker, GameGrid grid, int totalLockHeight, int linesCleared, EvaluationWeights weights, double& cost);
+
+    public:
+    MctsSettings settings; // can be changed between solves
+    MctsStats stats;
+
+    public:
+    explicit MctsSolver(
+        MctsSettings settings = MctsSettings(),
+        int threadCount = ThreadPool::defaultThreadCount(),
+        std::size_t transpositionTableBytes = 16 << 20);
+    int threadCount() const { return this->pool.size(); };
+
+    // The returned node refers to getFirstGraph() and is valid until the next solve
+    NodeIndex solve(GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Graph* getFirstGraph() { return &this->context.firstGraph; };
+    int getVisits(int firstResultIndex) const { return this->nodes[1 + firstResultIndex].visits; };
+
+    Moves solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Tetrimino solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+};
+
+#endif
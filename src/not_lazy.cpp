@@ -7,15 +7,15 @@
 
 #include "constants.h"
 #include "tetris.h"
+#include "render.h"
 
 int main(void) { 
     // third party setup
-    srand(static_cast<unsigned int>(time(0)));
     InitWindow(GRID_FRAME_WIDTH + 75, GRID_FRAME_HEIGHT, "Tetris");
     SetTargetFPS(60); // my 2014 macbook gets too warm at 60 fps
     
     // core game logic classes
-    GameState state;
+    GameState state(1, static_cast<uint64_t>(time(0)));
     FrameDrawer frameDrawer;
     
     bool disableKeyDown = false;
@@ -0,0 +1,68 @@
+#include <vector>
+#include "parallel_solver.h"
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+
+ParallelSolver::ParallelSolver(int threadCount, std::size_t transpositionTableBytes) : 
+    pool(threadCount), 
+    workerContexts(pool.size()) 
+{
+    if (transpositionTableBytes > 0) {
+        this->transpositionTable = std::make_unique<TranspositionTable>(transpositionTableBytes);
+    }
+    for (SolverContext& workerContext : this->workerContexts) {
+        workerContext.transpositionTable = this->transpositionTable.get();
+    }
+    this->bestLeaves.resize(GRAPH_SIZE);
+}
+
+NodeIndex ParallelSolver::solve(GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    makeGraph(this->context.firstGraph, firstTetrimino, grid);
+    search(&this->context.firstGraph, firstTetrimino, grid, this->context.queue, this->context.firstResults);
+
+    auto analyzeFirstResult = [&](int task, int worker) {
+        NodeIndex firstResult = this->context.firstResults[task];
+        SolverContext& workerContext = this->workerContexts[worker];
+        workerContext.leaves.clear();
+
+        auto analyze = [&workerContext](GameGrid& grid, int totalLockHeight, int linesCleared, NodeIndex firstResult) {
+            addLeaf(workerContext, grid, totalLockHeight, linesCleared, firstResult);
+        };
+
+        Tetrimino firstPlacement = this->context.firstGraph.getTetrimino(firstResult);
+        analyzeSecondPlacements(
+            analyze, workerContext, grid, firstResult, firstPlacement, firstTetrimino, secondTetrimino);
+        this->bestLeaves[task] = findBestLeaf(workerContext.leaves, weights);
+    };
+    this->pool.run(static_cast<int>(this->context.firstResults.size()), analyzeFirstResult);
+    for (SolverContext& workerContext : this->workerContexts) {
+        flushTranspositionCounters(workerContext);
+    }
+
+    // same comparison as solve(), applied in search order so ties go to the earliest first placement
+    NodeIndex bestResult = NO_NODE;
+    double bestFitness = 0.0;
+    for (std::size_t i = 0; i < this->context.firstResults.size(); i++) {
+        const LeafScore& best = this->bestLeaves[i];
+        if (best.index < 0) { // no boards were analyzed for this first placement
+            continue;
+        }
+        if (bestResult == NO_NODE or best.fitness < bestFitness) {
+            bestFitness = best.fitness;
+            bestResult = this->context.firstResults[i];
+        }
+    }
+
+    return bestResult != NO_NODE ? bestResult : this->context.firstResults.at(0);
+}
+
+Moves ParallelSolver::solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, firstTetrimino, secondTetrimino, weights);
+    return movesToReachSearchResult(&this->context.firstGraph, bestResult);
+}
+
+Tetrimino ParallelSolver::solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = this->solve(grid, firstTetrimino, secondTetrimino, weights);
+    return this->context.firstGraph.getTetrimino(bestResult);
+}
@@ -0,0 +1,44 @@
+#ifndef PARALLEL_SOLVER_H
+#define PARALLEL_SOLVER_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "solver.h"
+#include "tetris.h"
+#include "thread_pool.h"
+#include "transposition_table.h"
+
+/*
+ * Same search as solve() with the second ply spread over a thread pool.
+ * Workers share one transposition table, which persists between solves, unless it is sized to 0 bytes.
+ * Each first placement is one task. Workers have their own SolverContext for the second tetrimino
+ * and record the best fitness found below their first placement, scoring that placement's leaves 
+ * as one batch. The best first placement is then 
+ * picked by scanning those fitnesses in search order with the same comparison solve() uses, so
+ * the result doesn't depend on which worker finished first and always matches solve().
+ */
+class ParallelSolver {
+    private:
+    ThreadPool pool;
+    std::unique_ptr<TranspositionTable> transpositionTable;
+    SolverContext context; // holds the first tetrimino's graph and search results
+    std::vector<SolverContext> workerContexts;
+    std::vector<LeafScore> bestLeaves; // indexed like context.firstResults, index -1 when nothing could be placed
+
+    public:
+    explicit ParallelSolver(
+        int threadCount = ThreadPool::defaultThreadCount(), 
+        std::size_t transpositionTableBytes = 16 << 20);
+    int threadCount() const { return this->pool.size(); };
+    TranspositionTable* getTranspositionTable() { return this->transpositionTable.get(); }; // null when disabled
+
+    // The returned node refers to getFirstGraph() and is valid until the next solve
+    NodeIndex solve(GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Graph* getFirstGraph() { return &this->context.firstGraph; };
+
+    Moves solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+    Tetrimino solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef PARSE_NUMBER_H
+#define PARSE_NUMBER_H
+
+#include <charconv>
+#include <string>
+#include <system_error>
+
+// The whole of text as a number of at least minimum, false for anything else. Used by the command
+// line tools so that a mistyped option stops them instead of running with a number nobody asked for.
+template <typename Number>
+bool parseNumber(const std::string& text, Number minimum, Number& number) {
+    Number value{};
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() or end != text.data() + text.size() or value < minimum) {
+        return false;
+    }
+    number = value;
+    return true;
+}
+
+#endif
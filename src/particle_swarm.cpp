@@ -1,11 +1,263 @@
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <vector>
+#include "particle_swarm.h"
+#include "engine_switch.h"
+#include "simulation.h"
+#include "xoshiro.h"
 
-#include "solver.h"
-#include "tetris.h"
+EvaluationWeights weightsFromPosition(const SwarmPosition& position) {
+    return {
+        .totalLinesCleared = position[0],
+        .totalLockHeight = position[1],
+        .totalWellCells = position[2],
+        .totalColumnHoles = position[3],
+        .totalColumnTransitions = position[4],
+        .totalRowTransitions = position[5]
+    };
+}
 
-using namespace std;
+SwarmPosition positionFromWeights(const EvaluationWeights& weights) {
+    return {
+        weights.totalLinesCleared,
+        weights.totalLockHeight,
+        weights.totalWellCells,
+        weights.totalColumnHoles,
+        weights.totalColumnTransitions,
+        weights.totalRowTransitions
+    };
+}
 
-int main(void) {
-    cout << "success!" << endl;
-    return 0;
-}
\ No newline at end of file
+// The seed's generator long jumped twice. Stream 0 is the seed's generator itself and a game's
+// garbage comes from its stream long jumped once, so the swarm's numbers are none of the games'.
+static Xoshiro256 swarmGenerator(uint64_t seed) {
+    Xoshiro256 rng(seed);
+    rng.longJump();
+    rng.longJump();
+    return rng;
+}
+
+ParticleSwarm::ParticleSwarm(SwarmSettings settings) :
+    settings(settings),
+    rng(swarmGenerator(settings.seed)),
+    pool(settings.threadCount),
+    solvers(pool.size())
+{
+    for (EngineSwitch& solver : this->solvers) {
+        solver.threadCount = 1;
+        solver.transpositionTableBytes = 4 << 20;
+    }
+
+    double range = settings.maxWeight - settings.minWeight;
+    this->particles.resize(std::max(settings.particles, 1));
+    for (Particle& particle : this->particles) {
+        for (int i = 0; i < WEIGHT_COUNT; i++) {
+            particle.position[i] = settings.minWeight + this->uniform() * range;
+            particle.velocity[i] = (this->uniform() * 2.0 - 1.0) * settings.maxVelocity * range;
+        }
+        particle.bestPosition = particle.position;
+    }
+}
+
+double ParticleSwarm::uniform() {
+    return (this->rng() >> 11) * 0x1.0p-53;
+}
+
+std::vector<double> ParticleSwarm::evaluate(const std::vector<EvaluationWeights>& weights) {
+    int games = std::max(this->settings.gamesPerParticle, 1);
+    std::vector<int> linesCleared(weights.size() * games);
+    std::vector<std::vector<double>> solveMicroseconds(this->pool.size());
+    std::vector<Xoshiro256> generators = streamGenerators(this->settings.seed, games);
+
+    auto playTask = [&](int task, int worker) {
+        SimulationSettings game;
+        game.seed = this->settings.seed;
+        game.pieceCap = this->settings.pieceCap;
+        game.weights = weights[task / games];
+        solveMicroseconds[worker].clear(); // only needed by tetris_sim
+        linesCleared[task] = playGame(this->solvers[worker], game, task % games, generators[task % games], solveMicroseconds[worker]).linesCleared;
+    };
+    this->pool.run(static_cast<int>(linesCleared.size()), playTask);
+
+    std::vector<double> fitnesses(weights.size(), 0.0);
+    for (std::size_t task = 0; task < linesCleared.size(); task++) {
+        fitnesses[task / games] += linesCleared[task];
+    }
+    for (double& fitness : fitnesses) {
+        fitness /= games;
+    }
+    return fitnesses;
+}
+
+GenerationStats ParticleSwarm::update(const std::vector<double>& fitnesses, double seconds) {
+    GenerationStats stats;
+    stats.generation = this->generation;
+    stats.seconds = seconds;
+    stats.generationBestFitness = fitnesses.at(0);
+
+    for (std::size_t i = 0; i < this->particles.size(); i++) {
+        Particle& particle = this->particles[i];
+        particle.fitness = fitnesses.at(i);
+        if (particle.fitness > particle.bestFitness) {
+            particle.bestFitness = particle.fitness;
+            particle.bestPosition = particle.position;
+        }
+        if (particle.fitness > this->bestFitness) {
+            this->bestFitness = particle.fitness;
+            this->bestPosition = particle.position;
+        }
+        stats.generationBestFitness = std::max(stats.generationBestFitness, particle.fitness);
+        stats.meanFitness += particle.fitness;
+    }
+    stats.meanFitness /= this->particles.size();
+
+    SwarmPosition centroid{};
+    for (const Particle& particle : this->particles) {
+        stats.fitnessStddev += (particle.fitness - stats.meanFitness) * (particle.fitness - stats.meanFitness);
+        for (int i = 0; i < WEIGHT_COUNT; i++) {
+            centroid[i] += particle.position[i] / this->particles.size();
+        }
+    }
+    stats.fitnessStddev = std::sqrt(stats.fitnessStddev / this->particles.size());
+    for (const Particle& particle : this->particles) {
+        double squaredDistance = 0.0;
+        for (int i = 0; i < WEIGHT_COUNT; i++) {
+            squaredDistance += (particle.position[i] - centroid[i]) * (particle.position[i] - centroid[i]);
+        }
+        stats.diversity += std::sqrt(squaredDistance) / this->particles.size();
+    }
+    stats.bestFitness = this->bestFitness;
+    stats.bestPosition = this->bestPosition;
+
+    // move every particle towards its own best and the swarm's best
+    double maxVelocity = this->settings.maxVelocity * (this->settings.maxWeight - this->settings.minWeight);
+    for (Particle& particle : this->particles) {
+        for (int i = 0; i < WEIGHT_COUNT; i++) {
+            double velocity =
+                this->settings.inertia * particle.velocity[i] +
+                this->settings.cognitive * this->uniform() * (particle.bestPosition[i] - particle.position[i]) +
+                this->settings.social * this->uniform() * (this->bestPosition[i] - particle.position[i]);
+            particle.velocity[i] = std::clamp(velocity, -maxVelocity, maxVelocity);
+            particle.position[i] += particle.velocity[i];
+            if (particle.position[i] < this->settings.minWeight or particle.position[i] > this->settings.maxWeight) {
+                particle.position[i] = std::clamp(particle.position[i], this->settings.minWeight, this->settings.maxWeight);
+                particle.velocity[i] = 0.0; // stop at the wall instead of pushing against it
+            }
+        }
+    }
+
+    this->generation++;
+    return stats;
+}
+
+GenerationStats ParticleSwarm::step() {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<double> fitnesses = this->evaluate(this->getParticleWeights());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return this->update(fitnesses, seconds);
+}
+
+std::vector<EvaluationWeights> ParticleSwarm::getParticleWeights() const {
+    std::vector<EvaluationWeights> weights;
+    for (const Particle& particle : this->particles) {
+        weights.push_back(weightsFromPosition(particle.position));
+    }
+    return weights;
+}
+
+static const char checkpointMagic[8] = { 'T', 'S', 'W', 'A', 'R', 'M', '0', '1' };
+
+template <typename T>
+static void writeValue(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+bool ParticleSwarm::saveCheckpoint(const std::string& path) const {
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        out.write(checkpointMagic, sizeof(checkpointMagic));
+        writeValue(out, this->settings.gamesPerParticle);
+        writeValue(out, this->settings.pieceCap);
+        writeValue(out, this->settings.seed);
+        writeValue(out, this->settings.inertia);
+        writeValue(out, this->settings.cognitive);
+        writeValue(out, this->settings.social);
+        writeValue(out, this->settings.minWeight);
+        writeValue(out, this->settings.maxWeight);
+        writeValue(out, this->settings.maxVelocity);
+        writeValue(out, this->rng.getState());
+        writeValue(out, this->generation);
+        writeValue(out, this->bestFitness);
+        writeValue(out, this->bestPosition);
+        writeValue(out, static_cast<int>(this->particles.size()));
+        for (const Particle& particle : this->particles) {
+            writeValue(out, particle.position);
+            writeValue(out, particle.velocity);
+            writeValue(out, particle.bestPosition);
+            writeValue(out, particle.fitness);
+            writeValue(out, particle.bestFitness);
+        }
+        out.flush();
+        if (not out) {
+            return false;
+        }
+    }
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+bool ParticleSwarm::loadCheckpoint(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(checkpointMagic)];
+    if (not in.read(magic, sizeof(magic)) or std::memcmp(magic, checkpointMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    SwarmSettings settings = this->settings;
+    std::array<uint64_t, 4> rngState;
+    int generation;
+    double bestFitness;
+    SwarmPosition bestPosition;
+    int particleCount;
+    bool read = readValue(in, settings.gamesPerParticle) and readValue(in, settings.pieceCap) and
+        readValue(in, settings.seed) and readValue(in, settings.inertia) and
+        readValue(in, settings.cognitive) and readValue(in, settings.social) and
+        readValue(in, settings.minWeight) and readValue(in, settings.maxWeight) and
+        readValue(in, settings.maxVelocity) and readValue(in, rngState) and
+        readValue(in, generation) and readValue(in, bestFitness) and
+        readValue(in, bestPosition) and readValue(in, particleCount);
+    if (not read or particleCount < 1 or particleCount > 1 << 20) {
+        return false;
+    }
+    std::vector<Particle> particles(particleCount);
+    for (Particle& particle : particles) {
+        read = readValue(in, particle.position) and readValue(in, particle.velocity) and
+            readValue(in, particle.bestPosition) and readValue(in, particle.fitness) and
+            readValue(in, particle.bestFitness);
+        if (not read) {
+            return false;
+        }
+    }
+    if (in.peek() != std::ifstream::traits_type::eof()) {
+        return false;
+    }
+
+    settings.particles = particleCount;
+    this->settings = settings;
+    this->rng = Xoshiro256(rngState);
+    this->generation = generation;
+    this->bestFitness = bestFitness;
+    this->bestPosition = bestPosition;
+    this->particles = std::move(particles);
+    return true;
+}
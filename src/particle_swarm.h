@@ -0,0 +1,116 @@
+#ifndef PARTICLE_SWARM_H
+#define PARTICLE_SWARM_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include "engine_switch.h"
+#include "solver.h"
+#include "thread_pool.h"
+#include "xoshiro.h"
+
+const int WEIGHT_COUNT = 6;
+typedef std::array<double, WEIGHT_COUNT> SwarmPosition; // EvaluationWeights in declaration order
+
+EvaluationWeights weightsFromPosition(const SwarmPosition& position);
+SwarmPosition positionFromWeights(const EvaluationWeights& weights);
+
+/*
+ * particles, generations: swarm size and how many times it is evaluated and moved
+ * gamesPerParticle, pieceCap: a particle's fitness is the mean lines cleared over this many games,
+ * each stopped after pieceCap tetriminos
+ * seed: seeds the swarm's own random numbers and the games. Every particle plays the same games,
+ * streams 0 to gamesPerParticle - 1 of the seed like tetris_sim, so differences in fitness come
+ * from the weights and not from luckier tetriminos (common random numbers). The swarm draws from
+ * the seed's generator long jumped, apart from every game's tetriminos.
+ * inertia, cognitive, social: the usual PSO coefficients, defaults from Clerc's constriction
+ * minWeight, maxWeight: bounds of every weight
+ * maxVelocity: per move speed limit as a fraction of maxWeight - minWeight
+ */
+struct SwarmSettings {
+    int particles = 24;
+    int generations = 50;
+    int gamesPerParticle = 8;
+    int pieceCap = 500;
+    uint64_t seed = 0;
+    double inertia = 0.7298;
+    double cognitive = 1.49618;
+    double social = 1.49618;
+    double minWeight = -10.0;
+    double maxWeight = 50.0;
+    double maxVelocity = 0.2;
+    int threadCount = ThreadPool::defaultThreadCount();
+};
+
+struct Particle {
+    SwarmPosition position{};
+    SwarmPosition velocity{};
+    SwarmPosition bestPosition{};
+    double fitness = 0.0;
+    double bestFitness = -std::numeric_limits<double>::infinity(); // until evaluated
+};
+
+// Convergence of one generation, fitness being lines cleared per game
+struct GenerationStats {
+    int generation = 0;
+    double bestFitness = 0.0; // best ever, at bestPosition
+    double generationBestFitness = 0.0;
+    double meanFitness = 0.0;
+    double fitnessStddev = 0.0;
+    double diversity = 0.0; // mean distance of the particles from their centroid
+    double seconds = 0.0;
+    SwarmPosition bestPosition{};
+};
+
+/*
+ * Particle swarm optimizer tuning EvaluationWeights to clear the most lines. Fitness is maximized.
+ * step() evaluates every particle's weights then moves the swarm. Evaluation plays every game of
+ * every particle as one task on a thread pool, each thread solving with its own single threaded
+ * solver, so all cores stay busy until the generation's last game. Evaluation and moving are
+ * separate so that fitnesses can also be computed elsewhere and passed to update().
+ */
+class ParticleSwarm {
+    private:
+    SwarmSettings settings;
+    Xoshiro256 rng;
+    std::vector<Particle> particles;
+    SwarmPosition bestPosition{};
+    double bestFitness = -std::numeric_limits<double>::infinity();
+    int generation = 0;
+    ThreadPool pool;
+    std::vector<EngineSwitch> solvers; // one per pool worker
+
+    private:
+    double uniform(); // in [0, 1)
+
+    public:
+    explicit ParticleSwarm(SwarmSettings settings);
+
+    // Lines cleared per game for each weights, in order
+    std::vector<double> evaluate(const std::vector<EvaluationWeights>& weights);
+    // Takes the fitness of each particle's current position, updates the bests and moves the swarm
+    GenerationStats update(const std::vector<double>& fitnesses, double seconds = 0.0);
+    GenerationStats step();
+
+    /*
+     * A checkpoint holds the settings that shape the search, the swarm's generator state, every
+     * particle and the best so far, in the machine's byte order. Loading one into any swarm with the
+     * same threadCount continues exactly where the saved swarm was: generations and threadCount are
+     * the only settings not taken from the file.
+     * Saving writes path.tmp and renames it over path so an interrupted save leaves the last good
+     * checkpoint. Loading leaves the swarm as it was if the file is missing or not a checkpoint.
+     */
+    bool saveCheckpoint(const std::string& path) const;
+    bool loadCheckpoint(const std::string& path);
+
+    std::vector<EvaluationWeights> getParticleWeights() const;
+    const std::vector<Particle>& getParticles() const { return this->particles; };
+    const SwarmPosition& getBestPosition() const { return this->bestPosition; };
+    double getBestFitness() const { return this->bestFitness; };
+    int getGeneration() const { return this->generation; };
+    const SwarmSettings& getSettings() const { return this->settings; };
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "parse_number.h"
+#include "particle_swarm.h"
+#include "solver_stats.h"
+#ifdef TETRIS_PROCESS_WORKERS
+#include "process_evaluator.h"
+#endif
+
+// Usage: particle_swarm [--particles N] [--generations G] [--games N] [--pieces P] [--seed S] [--threads T]
+//                       [--processes N] [--game-timeout seconds] [--checkpoint path]
+// Tunes the evaluation weights with a particle swarm, printing one line of convergence stats per
+// generation and the best weights found as an initializer to paste into the mains.
+// --processes plays the games in N forked worker processes instead of threads (POSIX only).
+// --game-timeout replaces a worker process still playing one game after that long, 0 for no limit.
+// --checkpoint saves the swarm to path after every generation, and if path already holds a
+// checkpoint the run resumes from it, with the checkpoint's settings, up to G generations in total.
+// A path holding anything else is an error rather than something to overwrite.
+static void printUsage() {
+    std::cerr << "usage: particle_swarm [--particles N] [--generations G] [--games N] [--pieces P] [--seed S] [--threads T] "
+        << "[--processes N] [--game-timeout seconds] [--checkpoint path]" << std::endl;
+}
+
+static void printWeights(const SwarmPosition& position) {
+    EvaluationWeights weights = weightsFromPosition(position);
+    std::cout.precision(17);
+    std::cout << "EvaluationWeights weights = {\n"
+        << "    .totalLinesCleared = " << weights.totalLinesCleared << ",\n"
+        << "    .totalLockHeight = " << weights.totalLockHeight << ",\n"
+        << "    .totalWellCells = " << weights.totalWellCells << ",\n"
+        << "    .totalColumnHoles = " << weights.totalColumnHoles << ",\n"
+        << "    .totalColumnTransitions = " << weights.totalColumnTransitions << ",\n"
+        << "    .totalRowTransitions = " << weights.totalRowTransitions << "\n"
+        << "};" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    SwarmSettings settings;
+    int processes = 0;
+#ifdef TETRIS_PROCESS_WORKERS
+    int gameTimeoutSeconds = 600;
+#endif
+    std::string checkpoint;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--particles" and parseNumber(value, 1, settings.particles)) {
+            continue;
+        }
+        else if (option == "--generations" and parseNumber(value, 0, settings.generations)) {
+            continue;
+        }
+        else if (option == "--games" and parseNumber(value, 1, settings.gamesPerParticle)) {
+            continue;
+        }
+        else if (option == "--pieces" and parseNumber(value, 0, settings.pieceCap)) {
+            continue;
+        }
+        else if (option == "--seed" and parseNumber(value, uint64_t(0), settings.seed)) {
+            continue;
+        }
+        else if (option == "--threads" and parseNumber(value, 1, settings.threadCount)) {
+            continue;
+        }
+#ifdef TETRIS_PROCESS_WORKERS
+        else if (option == "--processes" and parseNumber(value, 0, processes)) {
+            continue;
+        }
+        else if (option == "--game-timeout" and parseNumber(value, 0, gameTimeoutSeconds)) {
+            continue;
+        }
+#endif
+        else if (option == "--checkpoint") {
+            checkpoint = value;
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (processes > 0) {
+        settings.threadCount = 1; // no pool threads alive when the workers fork
+    }
+    ParticleSwarm swarm(settings);
+    std::error_code error;
+    if (not checkpoint.empty() and std::filesystem::exists(checkpoint, error)) {
+        if (not swarm.loadCheckpoint(checkpoint)) {
+            std::cerr << checkpoint << " isn't a swarm checkpoint, move it away to start a new run" << std::endl;
+            return 1;
+        }
+        std::cout << "resuming " << checkpoint << " at generation " << swarm.getGeneration() << std::endl;
+    }
+    const SwarmSettings& swarmSettings = swarm.getSettings();
+    std::cout << "particles " << swarmSettings.particles << ", games per particle " << swarmSettings.gamesPerParticle
+        << ", piece cap " << swarmSettings.pieceCap << ", seed " << swarmSettings.seed;
+    if (processes > 0) {
+        std::cout << ", processes " << processes << std::endl;
+    }
+    else {
+        std::cout << ", threads " << swarmSettings.threadCount << std::endl;
+    }
+
+#ifdef TETRIS_PROCESS_WORKERS
+    ProcessEvaluator evaluator(processes, swarmSettings);
+    evaluator.gameTimeout = std::chrono::seconds(gameTimeoutSeconds);
+    if (processes > 0 and not evaluator.start()) {
+        std::cerr << "couldn't start the worker processes" << std::endl;
+        return 1;
+    }
+#endif
+    while (swarm.getGeneration() < settings.generations) {
+        GenerationStats stats;
+#ifdef TETRIS_PROCESS_WORKERS
+        if (processes > 0) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<double> fitnesses;
+            if (not evaluator.evaluate(swarm.getParticleWeights(), fitnesses)) {
+                std::cerr << "a game kept killing or hanging its worker process, giving up" << std::endl;
+                return 1;
+            }
+            stats = swarm.update(fitnesses, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        else {
+            stats = swarm.step();
+        }
+#else
+        stats = swarm.step();
+#endif
+        std::cout.precision(6);
+        std::cout << "generation " << stats.generation
+            << ": best " << stats.bestFitness
+            << ", generation best " << stats.generationBestFitness
+            << ", mean " << stats.meanFitness
+            << ", stddev " << stats.fitnessStddev
+            << ", diversity " << stats.diversity
+            << ", " << stats.seconds << " s" << std::endl;
+        if (not checkpoint.empty() and not swarm.saveCheckpoint(checkpoint)) {
+            std::cerr << "couldn't save " << checkpoint << std::endl;
+        }
+    }
+
+    std::cout << "best lines cleared per game: " << swarm.getBestFitness() << std::endl;
+    printWeights(swarm.getBestPosition());
+    if (solverStatsEnabled() and processes == 0) { // worker processes keep their own
+        std::cout << "solver stats: ";
+        printSolverStats(std::cout, getSolverStats());
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const char* perfEventName(PerfEvent event) {
+    switch (event) {
+        case cyclesEvent:
+            return "cycles";
+        case instructionsEvent:
+            return "instructions";
+        case l1dMissesEvent:
+            return "l1dMisses";
+        case llcMissesEvent:
+            return "llcMisses";
+        default:
+            return "branchMisses";
+    }
+}
+
+const char* perfPhaseName(PerfPhase phase) {
+    switch (phase) {
+        case solvePhase:
+            return "solve";
+        case makeGraphPhase:
+            return "makeGraph";
+        case searchPhase:
+            return "search";
+        case secondPlyPhase:
+            return "secondPly";
+        default:
+            return "evaluate";
+    }
+}
+
+/*****************
+ * PerfCounterGroup
+ *****************/
+
+PerfCounterGroup::~PerfCounterGroup() {
+    this->close();
+}
+
+std::vector<PerfCounterGroup::Event> PerfCounterGroup::hardwareEvents() {
+#ifdef __linux__
+    return {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES }, // last level cache
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+    };
+#else
+    return std::vector<Event>(numPerfEvents, { 0, 0 });
+#endif
+}
+
+bool PerfCounterGroup::open(const std::vector<Event>& events) {
+    this->close();
+    if (events.size() > static_cast<std::size_t>(numPerfEvents)) {
+        this->error = "more than " + std::to_string(numPerfEvents) + " events";
+        return false;
+    }
+    this->requested = static_cast<int>(events.size());
+#ifdef __linux__
+    for (int i = 0; i < this->requested; i++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = events[i].type;
+        attr.config = events[i].config;
+        attr.exclude_kernel = 1; // all that perf_event_paranoid 2 allows, and the solver is user space anyway
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int leader = this->fds.empty() ? -1 : this->fds[0];
+        int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0)); // this thread, any cpu
+        if (fd < 0) {
+            if (this->error.empty()) {
+                std::string name = this->requested == numPerfEvents ? perfEventName(static_cast<PerfEvent>(i)) : "event " + std::to_string(i);
+                this->error = name + ": " + std::strerror(errno);
+            }
+            continue;
+        }
+        this->fds.push_back(fd);
+        this->slots.push_back(i);
+    }
+#else
+    this->error = "perf_event_open is Linux only";
+#endif
+    return this->isOpen();
+}
+
+void PerfCounterGroup::close() {
+#ifdef __linux__
+    for (int fd : this->fds) {
+        ::close(fd);
+    }
+#endif
+    this->fds.clear();
+    this->slots.clear();
+}
+
+bool PerfCounterGroup::isCounting(int event) const {
+    return std::find(this->slots.begin(), this->slots.end(), event) != this->slots.end();
+}
+
+bool PerfCounterGroup::read(PerfReading& reading) const {
+    reading = PerfReading();
+    if (not this->isOpen()) {
+        return false;
+    }
+#ifdef __linux__
+    uint64_t buffer[3 + numPerfEvents]; // count, time enabled, time running, then a value per event
+    std::size_t bytes = (3 + this->fds.size()) * sizeof(uint64_t);
+    if (::read(this->fds[0], buffer, bytes) != static_cast<ssize_t>(bytes)) {
+        return false;
+    }
+    reading.enabled = buffer[1];
+    reading.running = buffer[2];
+    for (std::size_t i = 0; i < this->fds.size(); i++) {
+        reading.values[this->slots[i]] = buffer[3 + i];
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t perfCountBetween(const PerfReading& start, const PerfReading& end, int event) {
+    uint64_t enabled = end.enabled - start.enabled;
+    uint64_t running = end.running - start.running;
+    if (running == 0 or end.values[event] < start.values[event]) {
+        return 0;
+    }
+    uint64_t count = end.values[event] - start.values[event];
+    if (running < enabled) { // only counted part of the time, extrapolate
+        count = static_cast<uint64_t>(static_cast<double>(count) * enabled / running);
+    }
+    return count;
+}
+
+/************
+ * Perf phases
+ ************/
+
+std::atomic<bool> perfPhasesEnabled{false};
+
+struct PerfThreadPhases {
+    PerfCounterGroup group;
+    bool opened = false; // tried to open the group
+    std::array<PerfPhaseTotals, numPerfPhases> totals{};
+
+    PerfThreadPhases();
+    ~PerfThreadPhases();
+};
+
+static std::mutex registryMutex;
+static std::vector<PerfThreadPhases*> liveThreads;
+static PerfReport finishedThreads; // totals of threads that exited
+static thread_local PerfThreadPhases threadPhases;
+
+static void addTotals(std::array<PerfPhaseTotals, numPerfPhases>& totals, const std::array<PerfPhaseTotals, numPerfPhases>& other) {
+    for (int phase = 0; phase < numPerfPhases; phase++) {
+        totals[phase].calls += other[phase].calls;
+        for (int event = 0; event < numPerfEvents; event++) {
+            totals[phase].counts[event] += other[phase].counts[event];
+        }
+    }
+}
+
+static void addThread(PerfReport& report, const PerfThreadPhases& thread) {
+    addTotals(report.phases, thread.totals);
+    report.available = report.available or thread.group.isOpen();
+    for (int event = 0; event < numPerfEvents; event++) {
+        report.counting[event] = report.counting[event] or thread.group.isCounting(event);
+    }
+    if (report.error.empty()) {
+        report.error = thread.group.getError();
+    }
+}
+
+PerfThreadPhases::PerfThreadPhases() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    liveThreads.push_back(this);
+}
+
+PerfThreadPhases::~PerfThreadPhases() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    addThread(finishedThreads, *this);
+    liveThreads.erase(std::find(liveThreads.begin(), liveThreads.end(), this));
+}
+
+void startPerfPhases() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    finishedThreads = PerfReport();
+    for (PerfThreadPhases* thread : liveThreads) {
+        thread->totals = {};
+    }
+    perfPhasesEnabled.store(true);
+}
+
+PerfReport getPerfReport() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    PerfReport report = finishedThreads;
+    for (PerfThreadPhases* thread : liveThreads) {
+        addThread(report, *thread);
+    }
+    return report;
+}
+
+PerfPhaseScope::PerfPhaseScope(PerfPhase phase) : phase(phase) {
+    if (not perfPhasesEnabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    PerfThreadPhases& thread = threadPhases;
+    if (not thread.opened) {
+        thread.opened = true;
+        thread.group.open(PerfCounterGroup::hardwareEvents());
+    }
+    if (thread.group.read(this->start)) {
+        this->thread = &thread;
+    }
+}
+
+PerfPhaseScope::~PerfPhaseScope() {
+    PerfReading end;
+    if (this->thread == nullptr or not this->thread->group.read(end)) {
+        return;
+    }
+    PerfPhaseTotals& totals = this->thread->totals[this->phase];
+    totals.calls++;
+    for (int event = 0; event < numPerfEvents; event++) {
+        totals.counts[event] += perfCountBetween(this->start, end, event);
+    }
+}
+
+void printPerfReport(std::ostream& out, const PerfReport& report, long pieces) {
+    out << "{\"available\": " << (report.available ? "true" : "false");
+    if (not report.error.empty()) {
+        out << ", \"error\": \"" << report.error << "\"";
+    }
+    out << ", \"events\": [";
+    bool first = true;
+    for (int event = 0; event < numPerfEvents; event++) {
+        if (report.counting[event]) {
+            out << (first ? "" : ", ") << "\"" << perfEventName(static_cast<PerfEvent>(event)) << "\"";
+            first = false;
+        }
+    }
+    out << "]";
+
+    // counts divided by calls or pieces, with IPC when both cycles and instructions were counted
+    auto printCounts = [&](const PerfPhaseTotals& totals, double divisor) {
+        out << "{";
+        bool firstCount = true;
+        for (int event = 0; event < numPerfEvents; event++) {
+            if (report.counting[event]) {
+                out << (firstCount ? "" : ", ") << "\"" << perfEventName(static_cast<PerfEvent>(event)) << "\": " << totals.counts[event] / divisor;
+                firstCount = false;
+            }
+        }
+        if (report.counting[cyclesEvent] and report.counting[instructionsEvent] and totals.counts[cyclesEvent] > 0) {
+            out << ", \"ipc\": " << static_cast<double>(totals.counts[instructionsEvent]) / totals.counts[cyclesEvent];
+        }
+        out << "}";
+    };
+
+    if (report.available and pieces > 0) {
+        out << ", \"perPiece\": ";
+        printCounts(report.phases[solvePhase], static_cast<double>(pieces));
+    }
+    out << ", \"phases\": {";
+    first = true;
+    for (int phase = 0; phase < numPerfPhases; phase++) {
+        const PerfPhaseTotals& totals = report.phases[phase];
+        if (totals.calls == 0) {
+            continue;
+        }
+        out << (first ? "" : ", ") << "\"" << perfPhaseName(static_cast<PerfPhase>(phase)) << "\": {\"calls\": " << totals.calls << ", \"perCall\": ";
+        printCounts(totals, static_cast<double>(totals.calls));
+        out << "}";
+        first = false;
+    }
+    out << "}}";
+}
@@ -0,0 +1,132 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Hardware performance counters of the calling thread through Linux's perf_event_open, so changes to
+ * the layout of Graph or GameGrid can be judged by cache misses and IPC and not just wall time.
+ * Counters are often missing: containers and VMs may not expose a PMU, perf_event_paranoid may forbid
+ * them, and other systems don't have perf_event_open at all. Opening then fails with a reason and
+ * everything that uses the counters carries on without them. Events that open are kept when others
+ * don't.
+ */
+enum PerfEvent { cyclesEvent, instructionsEvent, l1dMissesEvent, llcMissesEvent, branchMissesEvent, numPerfEvents };
+
+const char* perfEventName(PerfEvent event);
+
+/*
+ * A group's raw counts at one moment. When there are more events than the PMU has counters the
+ * kernel multiplexes the group: running then falls behind enabled and the counts only cover the
+ * time it ran. Scaling running totals by enabled / running would make a count that went up read as
+ * one that went down once the ratio shrinks, so counts are only scaled as differences, see
+ * perfCountBetween.
+ */
+struct PerfReading {
+    uint64_t enabled = 0; // nanoseconds the group was enabled
+    uint64_t running = 0; // nanoseconds it was on the PMU
+    std::array<uint64_t, numPerfEvents> values{}; // raw running totals, one per requested event
+};
+
+// How many times event happened between two readings: the raw difference extrapolated by the time the
+// group was enabled over the time it ran in between. 0 when it didn't run at all in between.
+uint64_t perfCountBetween(const PerfReading& start, const PerfReading& end, int event);
+
+// One group of counters on the calling thread, read all at once
+class PerfCounterGroup {
+    public:
+    struct Event {
+        uint32_t type; // perf_event_attr type and config
+        uint64_t config;
+    };
+
+    private:
+    std::vector<int> fds; // opened events, the first one leads the group
+    std::vector<int> slots; // which requested event each fd counts
+    int requested = 0;
+    std::string error;
+
+    public:
+    PerfCounterGroup() = default;
+    ~PerfCounterGroup();
+    PerfCounterGroup(const PerfCounterGroup&) = delete;
+    PerfCounterGroup& operator = (const PerfCounterGroup&) = delete;
+
+    static std::vector<Event> hardwareEvents(); // in PerfEvent order
+
+    // Counting starts right away, in user space only. True if at least one event opened. At most
+    // numPerfEvents events.
+    bool open(const std::vector<Event>& events);
+    void close();
+    bool isOpen() const { return not this->fds.empty(); };
+    bool isCounting(int event) const;
+    const std::string& getError() const { return this->error; }; // why the first event that failed didn't open
+    // Raw running totals, one per requested event (0 for ones that didn't open)
+    bool read(PerfReading& reading) const;
+};
+
+/*
+ * Counts per solver phase, summed over every thread. The phases nest: a solve includes its makeGraph,
+ * search, second plies and evaluation. Each phase boundary reads the counters with a system call, a
+ * microsecond or so, which is noticeable next to the shortest phases but the same for every branch.
+ * Configure with -DPERF_COUNTERS=ON to define TETRIS_PERF_COUNTERS, without it PERF_PHASE expands to
+ * nothing. Counting also needs startPerfPhases; each thread opens its own counters on its first phase.
+ */
+enum PerfPhase { solvePhase, makeGraphPhase, searchPhase, secondPlyPhase, evaluatePhase, numPerfPhases };
+
+const char* perfPhaseName(PerfPhase phase);
+
+struct PerfPhaseTotals {
+    uint64_t calls = 0;
+    std::array<uint64_t, numPerfEvents> counts{};
+};
+
+struct PerfReport {
+    bool available = false; // some thread counted at least one event
+    std::string error; // the first reason a thread couldn't open its counters
+    std::array<bool, numPerfEvents> counting{};
+    std::array<PerfPhaseTotals, numPerfPhases> phases{};
+};
+
+constexpr bool perfCountersCompiledIn() {
+#ifdef TETRIS_PERF_COUNTERS
+    return true;
+#else
+    return false;
+#endif
+}
+
+extern std::atomic<bool> perfPhasesEnabled;
+
+void startPerfPhases(); // clears earlier totals
+PerfReport getPerfReport(); // call while no phase is running
+// JSON object with counts per call for every phase that ran, and per piece for whole solves when pieces > 0
+void printPerfReport(std::ostream& out, const PerfReport& report, long pieces);
+
+struct PerfThreadPhases;
+
+class PerfPhaseScope {
+    private:
+    PerfPhase phase;
+    PerfThreadPhases* thread = nullptr;
+    PerfReading start;
+
+    public:
+    explicit PerfPhaseScope(PerfPhase phase);
+    ~PerfPhaseScope();
+    PerfPhaseScope(const PerfPhaseScope&) = delete;
+    PerfPhaseScope& operator = (const PerfPhaseScope&) = delete;
+};
+
+#ifdef TETRIS_PERF_COUNTERS
+#define PERF_PHASE(phase) PerfPhaseScope perfPhaseScope(phase)
+#else
+#define PERF_PHASE(phase) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <new>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "process_evaluator.h"
+#include "engine_switch.h"
+#include "simulation.h"
+#include "xoshiro.h"
+
+enum SlotState { idleSlot, assignedSlot, finishedSlot };
+
+// Lives in the shared mapping. Everything but state is only touched by whichever side state says
+// owns the slot: the coordinator while idle or finished, the worker while assigned.
+struct ProcessEvaluator::WorkerSlot {
+    std::atomic<int> state{idleSlot};
+    int stream = 0;
+    EvaluationWeights weights{};
+    int linesCleared = 0;
+};
+
+static void pollDelay() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+ProcessEvaluator::ProcessEvaluator(int processes, const SwarmSettings& settings) :
+    settings(settings),
+    processes(std::max(processes, 1))
+{}
+
+ProcessEvaluator::~ProcessEvaluator() {
+    this->stop();
+}
+
+bool ProcessEvaluator::start() {
+    static_assert(std::atomic<int>::is_always_lock_free, "slot states are shared between processes");
+    if (this->slots != nullptr) {
+        return true;
+    }
+    this->mappedBytes = sizeof(WorkerSlot) * this->processes;
+    void* mapping = mmap(nullptr, this->mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    this->slots = static_cast<WorkerSlot*>(mapping);
+    for (int i = 0; i < this->processes; i++) {
+        new (&this->slots[i]) WorkerSlot();
+    }
+
+    this->workers.assign(this->processes, -1);
+    for (int i = 0; i < this->processes; i++) {
+        if (not this->spawnWorker(i)) {
+            this->stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProcessEvaluator::spawnWorker(int worker) {
+    this->slots[worker].state.store(idleSlot);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        this->workerLoop(worker);
+    }
+    this->workers[worker] = pid;
+    return true;
+}
+
+void ProcessEvaluator::workerLoop(int worker) {
+    pid_t coordinator = getppid();
+    EngineSwitch solver;
+    solver.threadCount = 1;
+    solver.transpositionTableBytes = 4 << 20;
+    SimulationSettings game;
+    game.seed = this->settings.seed;
+    game.pieceCap = this->settings.pieceCap;
+    std::vector<double> solveMicroseconds;
+    std::vector<Xoshiro256> generators = streamGenerators(game.seed, std::max(this->settings.gamesPerParticle, 1));
+
+    WorkerSlot& slot = this->slots[worker];
+    while (getppid() == coordinator) { // don't outlive a coordinator that crashed
+        if (slot.state.load(std::memory_order_acquire) != assignedSlot) {
+            pollDelay();
+            continue;
+        }
+        game.weights = slot.weights;
+        solveMicroseconds.clear();
+        slot.linesCleared = playGame(solver, game, slot.stream, generators.at(slot.stream), solveMicroseconds).linesCleared;
+        slot.state.store(finishedSlot, std::memory_order_release);
+    }
+    _exit(0);
+}
+
+void ProcessEvaluator::stop() {
+    for (pid_t pid : this->workers) {
+        if (pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+    }
+    this->workers.clear();
+    if (this->slots != nullptr) {
+        munmap(this->slots, this->mappedBytes);
+        this->slots = nullptr;
+    }
+}
+
+bool ProcessEvaluator::evaluate(const std::vector<EvaluationWeights>& weights, std::vector<double>& fitnesses) {
+    if (this->slots == nullptr and not this->start()) {
+        return false;
+    }
+    int games = std::max(this->settings.gamesPerParticle, 1);
+    int taskCount = static_cast<int>(weights.size()) * games;
+    std::vector<int> linesCleared(taskCount);
+    std::vector<int> attempts(taskCount, 0);
+    std::vector<int> heldTask(this->processes, -1);
+    std::vector<std::chrono::steady_clock::time_point> assignedAt(this->processes);
+    std::deque<int> queue;
+    for (int task = 0; task < taskCount; task++) {
+        queue.push_back(task);
+    }
+
+    int remaining = taskCount;
+    while (remaining > 0) {
+        for (int i = 0; i < this->processes; i++) {
+            WorkerSlot& slot = this->slots[i];
+            int state = slot.state.load(std::memory_order_acquire);
+            bool hung = state == assignedSlot and this->gameTimeout.count() > 0 and
+                std::chrono::steady_clock::now() - assignedAt[i] > this->gameTimeout;
+            if (hung) { // handled below like a worker that died
+                kill(this->workers[i], SIGKILL);
+            }
+            if (state == finishedSlot) {
+                linesCleared[heldTask[i]] = slot.linesCleared;
+                heldTask[i] = -1;
+                remaining--;
+                slot.state.store(idleSlot);
+                state = idleSlot;
+            }
+            else if (waitpid(this->workers[i], nullptr, hung ? 0 : WNOHANG) == this->workers[i]) {
+                this->workers[i] = -1;
+                if (heldTask[i] >= 0) { // give its game to someone else, unless it keeps doing this
+                    int task = heldTask[i];
+                    heldTask[i] = -1;
+                    if (++attempts[task] >= maxAttempts) {
+                        this->stop();
+                        return false;
+                    }
+                    queue.push_front(task);
+                }
+                if (not this->spawnWorker(i)) {
+                    this->stop();
+                    return false;
+                }
+                state = idleSlot;
+            }
+
+            if (state == idleSlot and not queue.empty()) {
+                int task = queue.front();
+                queue.pop_front();
+                slot.stream = task % games;
+                slot.weights = weights[task / games];
+                heldTask[i] = task;
+                assignedAt[i] = std::chrono::steady_clock::now();
+                slot.state.store(assignedSlot, std::memory_order_release);
+            }
+        }
+        if (remaining > 0) {
+            pollDelay();
+        }
+    }
+
+    fitnesses.assign(weights.size(), 0.0);
+    for (int task = 0; task < taskCount; task++) {
+        fitnesses[task / games] += linesCleared[task];
+    }
+    for (double& fitness : fitnesses) {
+        fitness /= games;
+    }
+    return true;
+}
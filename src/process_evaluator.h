@@ -0,0 +1,61 @@
+#ifndef PROCESS_EVALUATOR_H
+#define PROCESS_EVALUATOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+#include "particle_swarm.h"
+#include "solver.h"
+
+/*
+ * Evaluates swarm fitness in forked worker processes instead of threads (POSIX only).
+ * The coordinator and the workers share one anonymous memory mapping, made before forking, holding a
+ * slot per worker. The coordinator writes a particle's weights and a game stream into an idle slot
+ * and marks it assigned; the worker plays the game with its own single threaded solver, writes the
+ * lines cleared back and marks the slot finished. Fitnesses are then the same as
+ * ParticleSwarm::evaluate, game for game.
+ * Each worker has its own heap and a worker that dies only loses its game: the coordinator notices
+ * with waitpid, forks a replacement and hands the game out again, giving up on a game that has
+ * taken down maxAttempts workers. A worker still playing one game after gameTimeout is taken to
+ * be hung and is killed and replaced the same way.
+ * Both sides poll their slots about every millisecond, which is nothing next to a game and needs
+ * no process shared locks.
+ */
+class ProcessEvaluator {
+    private:
+    struct WorkerSlot;
+
+    SwarmSettings settings;
+    int processes;
+    WorkerSlot* slots = nullptr;
+    std::size_t mappedBytes = 0;
+    std::vector<pid_t> workers;
+
+    private:
+    bool spawnWorker(int worker);
+    [[noreturn]] void workerLoop(int worker);
+    void stop();
+
+    public:
+    static const int maxAttempts = 3;
+    std::chrono::milliseconds gameTimeout = std::chrono::minutes(10); // 0 for no limit
+
+    // Uses settings' seed, gamesPerParticle and pieceCap for the games
+    ProcessEvaluator(int processes, const SwarmSettings& settings);
+    ~ProcessEvaluator();
+    ProcessEvaluator(const ProcessEvaluator&) = delete;
+    ProcessEvaluator& operator = (const ProcessEvaluator&) = delete;
+
+    // Maps the shared slots and forks the workers. Fork workers before starting any threads in the
+    // coordinator, since a forked child only gets the thread that forked it.
+    bool start();
+    // Lines cleared per game for each weights, in order. False, with the workers stopped, if a game
+    // kept killing its worker or a worker couldn't be replaced.
+    bool evaluate(const std::vector<EvaluationWeights>& weights, std::vector<double>& fitnesses);
+
+    int size() const { return this->processes; };
+    pid_t getWorkerPid(int worker) const { return this->workers.at(worker); };
+};
+
+#endif
@@ -0,0 +1,190 @@
+#include <sstream>
+#include <iomanip>
+#include <iso646.h>
+
+#include <raylib.h>
+
+#include "render.h"
+#include "tetris.h"
+#include "constants.h"
+#include "trace.h"
+
+/*********
+ * Sprites
+ *********/
+
+Sprites::Sprites() {
+    for (auto colors : levelColors) {
+        std::vector<Texture2D> spriteList;
+        spriteList.push_back(this->generateSprite(0, colors.at(0)));
+        spriteList.push_back(this->generateSprite(1, colors.at(0)));
+        spriteList.push_back(this->generateSprite(1, colors.at(1)));
+        this->sprites.push_back(spriteList);
+    }
+}
+
+Texture2D Sprites::generateSprite(int pixelLayoutIndex, Color color) {
+    std::vector<Color> imageData;
+    Texture2D sprite;
+    Image image;
+    for (int pixel : spritePixelLayouts.at(pixelLayoutIndex)) {
+            if (pixel) {
+                imageData.push_back(color);
+            }
+            else {
+                imageData.push_back(WHITE);
+            }
+        }
+    image = {
+        .data = imageData.data(),
+        .width = sprite_width,
+        .height = sprite_height,
+        .mipmaps = 1,
+        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+    };
+    sprite = LoadTextureFromImage(image);
+    return sprite;
+}
+
+Texture2D Sprites::getSprite(SpriteType spriteType, int level) {
+    return this->sprites.at((level) % this->sprites.size()).at(spriteType);
+}
+
+/*************
+ * FrameDrawer
+ *************/
+
+FrameDrawer::FrameDrawer() {
+    this->font = LoadFontEx("resources/CommitMonoNerdFont-Regular.otf", 16, NULL, 0);
+    SetTextureFilter(this->font.texture, TEXTURE_FILTER_BILINEAR);
+}
+
+int FrameDrawer::getHorizontalOffset(Tetrimino tetrimino) {
+    return -tetrimino.getMask().minX;
+}
+
+void FrameDrawer::drawCurrentTetrimino(GameState& state) {
+    if (not state.isCurrentTetrominoPlaced()) {
+        Tetrimino tetrimino = state.getCurrentTetrimino();
+        SpriteType spriteType = tetrimino.getSpriteType();
+        Texture2D sprite = this->sprites.getSprite(spriteType, state.level);
+        for (auto gridPos : tetrimino.getPositions()) {
+            float x = static_cast<float>((gridPos.x * BLOCK_SIZE) + (gridPos.x * GAP_SIZE) + GAP_SIZE);
+            float y = static_cast<float>((BLOCK_SIZE * gridPos.y) + (gridPos.y * GAP_SIZE) + GAP_SIZE);
+            DrawTexturePro(
+                sprite,
+                { 0.0f, 0.0f, (float)sprite.width, (float)sprite.height },
+                { x, y, (float)BLOCK_SIZE, (float)BLOCK_SIZE},
+                { 0.0f, 0.0f },
+                0.0f,
+                WHITE
+            );
+        }
+    }
+}
+
+void FrameDrawer::drawGridCells(GameState& state) {
+    GameGrid grid = state.getGrid();
+    for (int gridX = 0; gridX < GRID_WIDTH; gridX++) {
+        for (int gridY = 0; gridY < GRID_HEIGHT; gridY++) {
+            Position gridPos(gridX, gridY);
+
+            if (!grid.isEmpty(gridPos)) {
+                Texture2D sprite = this->sprites.getSprite(
+                    grid.getSpriteType(gridPos), state.level);
+                float x = static_cast<float>((gridPos.x * BLOCK_SIZE) + (gridPos.x * GAP_SIZE) + GAP_SIZE);
+                float y = static_cast<float>((BLOCK_SIZE * gridPos.y) + (gridPos.y * GAP_SIZE) + GAP_SIZE);
+
+                DrawTexturePro(
+                    sprite,
+                    { 0.0f, 0.0f, (float)sprite.width, (float)sprite.height },
+                    { x, y, (float)BLOCK_SIZE, (float)BLOCK_SIZE},
+                    { 0.0f, 0.0f },
+                    0.0f,
+                    WHITE
+                );
+            }
+        }
+    }
+}
+
+void FrameDrawer::drawSideBar(GameState& state) {
+    float yStart = 10;
+
+    DrawLine(GRID_FRAME_WIDTH, 0, GRID_FRAME_WIDTH, GRID_FRAME_HEIGHT, WHITE);
+
+    // draw level in side bar
+    DrawTextEx(this->font, "Level:", {GRID_FRAME_WIDTH + 10, yStart}, 16, 0, WHITE);
+    std::stringstream ss1;
+    ss1 << std::setfill('0') << std::setw(4) << state.level;
+    DrawTextEx(this->font, ss1.str().c_str(), {GRID_FRAME_WIDTH + 10, yStart + 16} , 16, 0, WHITE);
+
+    yStart += 44;
+
+    // draw number of line clears in side bar
+    DrawTextEx(this->font, "Lines:", {GRID_FRAME_WIDTH + 10, yStart}, 16, 0, WHITE);
+    std::stringstream ss2;
+    ss2 << std::setfill('0') << std::setw(4) << state.linesCleared;
+    DrawTextEx(this->font, ss2.str().c_str(), {GRID_FRAME_WIDTH + 10, yStart + 16} , 16, 0, WHITE);
+
+    yStart += 44;
+
+    // draw next tetrimino in side bar
+    DrawTextEx(this->font, "Next:", {GRID_FRAME_WIDTH + 10, yStart}, 16, 0, WHITE);
+    Tetrimino tetrimino = state.getNextTetrimino();
+    SpriteType spriteType = tetrimino.getSpriteType();
+    Texture2D sprite = this->sprites.getSprite(spriteType, state.level);
+    TetriminoCells positions = rotationTable[tetrimino.shape][0];
+    int xAdjust = this->getHorizontalOffset(tetrimino);
+    for (auto pos : positions) {
+        float x = static_cast<float>(GRID_FRAME_WIDTH + 10 + ((pos.x + xAdjust) * BLOCK_SIZE) + ((pos.x + xAdjust) * GAP_SIZE));
+        float y = static_cast<float>(yStart + 20 + (BLOCK_SIZE * pos.y) + (pos.y * GAP_SIZE));
+        DrawTexturePro(
+            sprite,
+            { 0.0f, 0.0f, (float)sprite.width, (float)sprite.height },
+            { x, y, (float)BLOCK_SIZE, (float)BLOCK_SIZE},
+            { 0.0f, 0.0f },
+            0.0f,
+            WHITE
+        );
+    }
+}
+
+void FrameDrawer::drawGameOver(int level) {
+    Color color1 = levelColors.at((level) % levelColors.size()).at(0);
+    Color color2 = levelColors.at((level) % levelColors.size()).at(1);
+
+    for (int i = 0; i < this->gameOverStep; i++) {
+        int y1 = (i * BLOCK_SIZE) + (i * GAP_SIZE);
+        int y2 = y1 + 3;
+        int y3 = y1 + BLOCK_SIZE - 3;
+        int y4 = y3 + GAP_SIZE;
+
+        DrawRectangle(0, y1, GRID_FRAME_WIDTH, 3, color1);
+        DrawRectangle(0, y2, GRID_FRAME_WIDTH, BLOCK_SIZE - 6, WHITE);
+        DrawRectangle(0, y3, GRID_FRAME_WIDTH, 3, color2);
+        DrawRectangle(0, y4, GRID_FRAME_WIDTH, 3, BLACK);
+    }
+}
+
+void FrameDrawer::drawFrame(GameState& state, bool drawCurrentTetrimino) {
+    TRACE_SCOPE("drawFrame");
+    BeginDrawing();
+        ClearBackground(BLACK);
+        if (drawCurrentTetrimino) {
+            this->drawCurrentTetrimino(state);
+        }
+        this->drawGridCells(state);
+        this->drawSideBar(state);
+
+        if (state.gameOver) {
+            this->drawGameOver(state.level);
+        }
+    EndDrawing();
+}
+
+void FrameDrawer::nextGameOverStep() {
+    if (this->gameOverStep < GRID_HEIGHT) {
+        this->gameOverStep++;
+    }
+}
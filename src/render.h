@@ -0,0 +1,78 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <vector>
+#include "raylib.h"
+#include "tetris.h"
+
+/// Drawing the game with raylib. Everything else only needs tetris.h, so the game logic and 
+/// solvers build and run without a display.
+
+/// used by the Sprites class when generating sprites.
+/// each level has two colors.
+const std::vector<std::vector<Color>> levelColors = {
+    { BLUE, SKYBLUE },
+    { LIME, GREEN },
+    { {216,0,204,255},  {248,120,248,255} },
+    { {0,88,248,255},   {0,184,0,255} },
+    { {228,0,88,255},   {88,248,152,255} },
+    { {88,248,152,255}, {104,136,252,255} },
+    { {248,56,0,255},   {124,124,124,255} },
+    { {104,68,252,255}, {168,0,32,255} },
+    { {0,88,248,255},   {248,56,0,255} },
+    { {248,56,0,255},   {252,160,68,255} },
+};
+
+/// The flat lists of integers are used by the Sprites class when generating sprites.
+/// 1 means to color the sprite using levelColors.
+/// 0 means to color the pixel white.
+const int sprite_width = 5;
+const int sprite_height = 5;
+const std::vector<int> spritePixelLayout1 = {
+    0, 1, 1, 1, 1,
+    1, 0, 0, 0, 1,
+    1, 0, 0, 0, 1,
+    1, 0, 0, 0, 1,
+    1, 1, 1, 1, 1
+};
+const std::vector<int> spritePixelLayout2 = {
+    0, 1, 1, 1, 1,
+    1, 0, 0, 1, 1, 
+    1, 0, 1, 1, 1,
+    1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1
+};
+const std::vector<std::vector<int>> spritePixelLayouts = { spritePixelLayout1, spritePixelLayout2 };
+
+class Sprites {
+    private:
+    std::vector<std::vector<Texture2D>> sprites;
+
+    private:
+    Texture2D generateSprite(int pixelLayoutIndex, Color colour);
+
+    public:
+    Sprites();
+    Texture2D getSprite(SpriteType spriteType, int level);
+};
+
+class FrameDrawer {
+    private:
+    Font font;
+    Sprites sprites;
+    int gameOverStep = 0;
+
+    private:
+    int getHorizontalOffset(Tetrimino tetrimino);
+    void drawCurrentTetrimino(GameState& state);
+    void drawGridCells(GameState& state);
+    void drawSideBar(GameState& state);
+    void drawGameOver(int level);
+
+    public:
+    FrameDrawer(); 
+    void drawFrame(GameState& state, bool drawCurrentTetrimino = true);
+    void nextGameOverStep();
+};
+
+#endif
@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include "replay.h"
+
+#if defined(__unix__) or defined(__APPLE__)
+#define REPLAY_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char replayMagic[8] = { 'T', 'R', 'E', 'P', 'L', 'A', 'Y', '2' };
+
+/*
+ * Placement bytes count every column each rotation of each shape fits in, shape by shape. That is
+ * 162 placements, so one byte covers them and leaves room for tuckedPlacement.
+ */
+struct PlacementCodes {
+    std::array<std::array<int, 4>, N> base{}; // code of a shape's rotation in the leftmost column
+    std::array<Tetrimino, 256> tetriminos{}; // at yDelta 0, N past the last code
+    int count = 0;
+};
+
+constexpr PlacementCodes placementCodes = [] {
+    PlacementCodes codes;
+    for (int shape = 0; shape < N; shape++) {
+        for (int rotation = 0; rotation < rotationCounts[shape]; rotation++) {
+            const PieceMask& mask = pieceMaskTable[shape][rotation];
+            codes.base[shape][rotation] = codes.count;
+            for (int left = 0; left + mask.maxX - mask.minX < GRID_WIDTH; left++) {
+                codes.tetriminos[codes.count++] = Tetrimino(static_cast<TetriminoShape>(shape), left - mask.minX, 0, rotation);
+            }
+        }
+    }
+    return codes;
+}();
+
+static_assert(placementCodes.count < tuckedPlacement);
+
+static uint8_t placementCode(const Tetrimino& placement) {
+    return static_cast<uint8_t>(placementCodes.base[placement.shape][placement.rotationStep] + placement.xDelta + placement.getMask().minX);
+}
+
+// Where tetrimino lands dropped straight down from yDelta 0, false if it doesn't fit there
+static bool hardDrop(GameGrid& grid, Tetrimino tetrimino, Tetrimino& landed) {
+    tetrimino.yDelta = 0;
+    if (grid.checkCollision(tetrimino)) {
+        return false;
+    }
+    for (Tetrimino below = tetrimino.move(down); not grid.checkCollision(below); below = below.move(down)) {
+        tetrimino = below;
+    }
+    landed = tetrimino;
+    return true;
+}
+
+static GameGrid gridFromRows(const std::array<uint16_t, GRID_HEIGHT>& rows) {
+    GameGrid grid;
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        for (int x = 0; x < GRID_WIDTH; x++) {
+            if (rows[y] & (1 << x)) {
+                grid.setCell(Position(x, y), first);
+            }
+        }
+    }
+    return grid;
+}
+
+int applyPlacement(GameGrid& grid, const Tetrimino& placement) {
+    grid.setCells(placement);
+    return grid.clearFullRows();
+}
+
+/*************
+ * ReplayWriter
+ *************/
+
+ReplayWriter::ReplayWriter(const SimulationSettings& settings, int stream, int keyframeInterval) {
+    std::memcpy(this->header.magic, replayMagic, sizeof(replayMagic));
+    this->header.seed = settings.seed;
+    this->header.stream = static_cast<uint32_t>(stream);
+    this->header.keyframeInterval = static_cast<uint32_t>(std::max(keyframeInterval, 1));
+    this->header.pieceCap = static_cast<uint32_t>(settings.pieceCap);
+    this->header.engine = static_cast<uint8_t>(settings.engine);
+    this->header.weights = settings.weights;
+    this->header.mctsSettings = settings.mctsSettings;
+    this->addKeyframe();
+}
+
+void ReplayWriter::addKeyframe() {
+    ReplayKeyframe keyframe{};
+    keyframe.piece = this->header.pieces;
+    keyframe.offset = this->placements.size();
+    keyframe.linesCleared = this->header.linesCleared;
+    keyframe.rollingHash = this->header.rollingHash;
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        keyframe.rows[y] = this->grid.getRow(y);
+    }
+    this->keyframes.push_back(keyframe);
+}
+
+void ReplayWriter::addPlacement(const Tetrimino& placement, uint64_t boardHash) {
+    uint8_t code = placementCode(placement);
+    Tetrimino landed;
+    if (hardDrop(this->grid, placement, landed) and landed == placement) {
+        this->placements.push_back(code);
+    }
+    else {
+        this->placements.insert(this->placements.end(), { tuckedPlacement, code, static_cast<uint8_t>(placement.yDelta) });
+    }
+
+    this->header.linesCleared += applyPlacement(this->grid, placement);
+    this->header.pieces++;
+    this->header.rollingHash = rollReplayHash(this->header.rollingHash, boardHash);
+    if (this->header.pieces % this->header.keyframeInterval == 0) {
+        this->addKeyframe();
+    }
+}
+
+void ReplayWriter::finish(bool toppedOut) {
+    this->header.toppedOut = toppedOut ? 1 : 0;
+}
+
+std::vector<uint8_t> ReplayWriter::toBytes() const {
+    ReplayHeader header = this->header;
+    header.placementsOffset = sizeof(ReplayHeader);
+    header.placementsBytes = this->placements.size();
+    header.keyframesOffset = (header.placementsOffset + header.placementsBytes + 7) / 8 * 8;
+    header.keyframeCount = this->keyframes.size();
+
+    std::vector<uint8_t> bytes(header.keyframesOffset + header.keyframeCount * sizeof(ReplayKeyframe));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::copy(this->placements.begin(), this->placements.end(), bytes.begin() + header.placementsOffset);
+    std::memcpy(bytes.data() + header.keyframesOffset, this->keyframes.data(), header.keyframeCount * sizeof(ReplayKeyframe));
+    return bytes;
+}
+
+bool ReplayWriter::save(const std::string& path) const {
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::vector<uint8_t> bytes = this->toBytes();
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        out.flush();
+        if (not out) {
+            return false;
+        }
+    }
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+/*******
+ * Replay
+ *******/
+
+Replay::~Replay() {
+    this->close();
+}
+
+bool Replay::open(const std::string& path) {
+    this->close();
+#ifdef REPLAY_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 or status.st_size < static_cast<off_t>(sizeof(ReplayHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    this->mapping = mapping;
+    this->data = static_cast<const uint8_t*>(mapping);
+    this->size = static_cast<std::size_t>(status.st_size);
+    if (not this->readHeader()) {
+        this->close();
+        return false;
+    }
+    return true;
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (not in) {
+        return false;
+    }
+    return this->load(std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+#endif
+}
+
+bool Replay::load(std::vector<uint8_t> bytes) {
+    this->close();
+    this->buffer = std::move(bytes);
+    this->data = this->buffer.data();
+    this->size = this->buffer.size();
+    if (not this->readHeader()) {
+        this->close();
+        return false;
+    }
+    return true;
+}
+
+void Replay::close() {
+#ifdef REPLAY_MMAP
+    if (this->mapping != nullptr) {
+        munmap(this->mapping, this->size);
+    }
+#endif
+    this->mapping = nullptr;
+    this->buffer.clear();
+    this->data = nullptr;
+    this->size = 0;
+    this->header = ReplayHeader{};
+}
+
+bool Replay::readHeader() {
+    if (this->size < sizeof(ReplayHeader)) {
+        return false;
+    }
+    std::memcpy(&this->header, this->data, sizeof(ReplayHeader));
+    const ReplayHeader& header = this->header;
+    return std::memcmp(header.magic, replayMagic, sizeof(replayMagic)) == 0 and
+        header.keyframeInterval > 0 and
+        header.placementsOffset >= sizeof(ReplayHeader) and header.placementsOffset <= this->size and
+        header.placementsBytes <= this->size - header.placementsOffset and
+        header.keyframesOffset <= this->size and
+        header.keyframeCount == header.pieces / header.keyframeInterval + 1 and
+        header.keyframeCount <= (this->size - header.keyframesOffset) / sizeof(ReplayKeyframe);
+}
+
+ReplayKeyframe Replay::getKeyframe(uint64_t index) const {
+    ReplayKeyframe keyframe;
+    std::memcpy(&keyframe, this->data + this->header.keyframesOffset + index * sizeof(ReplayKeyframe), sizeof(keyframe));
+    return keyframe;
+}
+
+bool Replay::seek(uint64_t piece, ReplayPosition& position) const {
+    if (this->data == nullptr or piece > this->header.pieces) {
+        return false;
+    }
+    ReplayKeyframe keyframe = this->getKeyframe(std::min(piece / this->header.keyframeInterval, this->header.keyframeCount - 1));
+    position.piece = keyframe.piece;
+    position.offset = keyframe.offset;
+    position.linesCleared = keyframe.linesCleared;
+    position.rollingHash = keyframe.rollingHash;
+    position.grid = gridFromRows(keyframe.rows);
+    while (position.piece < piece) {
+        if (not this->step(position)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Replay::step(ReplayPosition& position, Tetrimino* placement) const {
+    const uint8_t* placements = this->data + this->header.placementsOffset;
+    uint64_t remaining = this->header.placementsBytes - std::min(position.offset, this->header.placementsBytes);
+    if (position.piece >= this->header.pieces or remaining == 0) {
+        return false;
+    }
+    bool tucked = placements[position.offset] == tuckedPlacement;
+    if (tucked and remaining < 3) {
+        return false;
+    }
+    uint8_t code = placements[position.offset + (tucked ? 1 : 0)];
+    if (code >= placementCodes.count) {
+        return false;
+    }
+
+    Tetrimino tetrimino = placementCodes.tetriminos[code];
+    if (tucked) {
+        tetrimino.yDelta = static_cast<int8_t>(placements[position.offset + 2]);
+        if (position.grid.checkCollision(tetrimino)) {
+            return false;
+        }
+    }
+    else if (not hardDrop(position.grid, tetrimino, tetrimino)) {
+        return false;
+    }
+
+    position.linesCleared += applyPlacement(position.grid, tetrimino);
+    position.piece++;
+    position.offset += tucked ? 3 : 1;
+    position.rollingHash = rollReplayHash(position.rollingHash, position.grid.getHash());
+    if (placement != nullptr) {
+        *placement = tetrimino;
+    }
+    return true;
+}
+
+bool Replay::verify(uint64_t& divergence) const {
+    if (this->data == nullptr) {
+        divergence = 0;
+        return false;
+    }
+    ReplayPosition position;
+    for (uint64_t index = 0; index < this->header.keyframeCount; index++) {
+        ReplayKeyframe keyframe = this->getKeyframe(index);
+        while (position.piece < keyframe.piece and this->step(position)) {}
+        bool matches = position.piece == keyframe.piece and position.offset == keyframe.offset and
+            position.linesCleared == keyframe.linesCleared and position.rollingHash == keyframe.rollingHash;
+        for (int y = 0; y < GRID_HEIGHT and matches; y++) {
+            matches = position.grid.getRow(y) == keyframe.rows[y];
+        }
+        if (not matches) {
+            divergence = std::min(position.piece, keyframe.piece);
+            return false;
+        }
+    }
+    while (this->step(position)) {}
+    if (position.piece != this->header.pieces or position.offset != this->header.placementsBytes or
+        position.linesCleared != this->header.linesCleared or position.rollingHash != this->header.rollingHash) {
+        divergence = position.piece;
+        return false;
+    }
+    return true;
+}
+
+uint64_t matchingPlacements(const Replay& expected, const Replay& actual) {
+    ReplayPosition expectedPosition;
+    ReplayPosition actualPosition;
+    if (not expected.seek(0, expectedPosition) or not actual.seek(0, actualPosition)) {
+        return 0;
+    }
+    Tetrimino expectedPlacement;
+    Tetrimino actualPlacement;
+    uint64_t matching = 0;
+    while (expected.step(expectedPosition, &expectedPlacement) and actual.step(actualPosition, &actualPlacement) and
+        expectedPlacement == actualPlacement) {
+        matching++;
+    }
+    return matching;
+}
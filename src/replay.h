@@ -0,0 +1,150 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "constants.h"
+#include "mcts.h"
+#include "simulation.h"
+#include "solver.h"
+#include "tetris.h"
+
+/*
+ * A played game written down compactly enough to keep every game of a simulation, and laid out so
+ * any point of it can be reached without replaying what came before.
+ *
+ * The file is a ReplayHeader, the placement bytes, then the keyframes:
+ * - header: the seed, stream and settings the game was played with, so it can be played again,
+ *   and where the other two parts start
+ * - placements: usually one byte per tetrimino naming its shape, rotation and column, the tetrimino
+ *   being hard dropped from the top of the grid. Tetriminos that were tucked or spun somewhere a
+ *   hard drop doesn't reach take three bytes: tuckedPlacement, the placement byte and its row.
+ * - keyframes: every keyframeInterval pieces the whole board, lines cleared and the offset of the
+ *   next placement byte, so seeking to a piece replays at most keyframeInterval - 1 placements
+ *
+ * After every placement the zobrist hash of the game's board is folded into a rolling hash, which the
+ * keyframes and the header record. Reading a replay back checks its boards against them, so a replay
+ * that doesn't rebuild the boards the game had, or a change to the game rules, shows up at the first
+ * keyframe that no longer matches, and replaying the game with the
+ * current solver and comparing placements shows where a solver change first plays differently.
+ * Values are stored in native byte order, like the swarm checkpoints. Keyframes keep occupancy only,
+ * a board restored from one has every cell drawn as the first sprite type.
+ */
+const int defaultKeyframeInterval = 1024;
+const uint8_t tuckedPlacement = 0xff; // prefix of a placement a hard drop doesn't reach
+
+struct ReplayHeader {
+    char magic[8];
+    uint64_t seed;
+    uint32_t stream;
+    uint32_t keyframeInterval;
+    uint32_t pieceCap;
+    uint8_t engine; // SolverEngine
+    uint8_t toppedOut;
+    uint16_t reserved;
+    EvaluationWeights weights;
+    MctsSettings mctsSettings; // what the MCTS engine searched with, whatever the engine
+    uint64_t pieces;
+    uint64_t linesCleared;
+    uint64_t rollingHash; // after the last placement
+    uint64_t placementsOffset; // from the start of the file
+    uint64_t placementsBytes;
+    uint64_t keyframesOffset;
+    uint64_t keyframeCount;
+};
+
+struct ReplayKeyframe {
+    uint64_t piece; // placements made before it, a multiple of keyframeInterval
+    uint64_t offset; // of the next placement in the placement bytes
+    uint64_t linesCleared;
+    uint64_t rollingHash;
+    std::array<uint16_t, GRID_HEIGHT> rows; // GameGrid occupancy
+};
+
+static_assert(std::is_trivially_copyable_v<ReplayHeader> and std::is_trivially_copyable_v<ReplayKeyframe>);
+
+constexpr uint64_t rollReplayHash(uint64_t rollingHash, uint64_t boardHash) {
+    return splitMix64(rollingHash ^ boardHash);
+}
+
+// Puts placement into the grid and clears full rows the way the game does, returning the rows cleared
+int applyPlacement(GameGrid& grid, const Tetrimino& placement);
+
+// Records a game placement by placement, keeping its own board to know which placements need a row
+class ReplayWriter {
+    private:
+    ReplayHeader header{};
+    std::vector<uint8_t> placements;
+    std::vector<ReplayKeyframe> keyframes;
+    GameGrid grid;
+
+    private:
+    void addKeyframe();
+
+    public:
+    ReplayWriter(const SimulationSettings& settings, int stream, int keyframeInterval = defaultKeyframeInterval);
+
+    // boardHash: GameGrid::getHash of the game's board after the placement and its line clears
+    void addPlacement(const Tetrimino& placement, uint64_t boardHash);
+    void finish(bool toppedOut);
+    std::vector<uint8_t> toBytes() const;
+    bool save(const std::string& path) const; // through path.tmp so a replay is never half written
+
+    uint64_t getPieces() const { return this->header.pieces; };
+    uint64_t getRollingHash() const { return this->header.rollingHash; };
+    const GameGrid& getGrid() const { return this->grid; };
+};
+
+// Where a replay is up to: the board after piece placements
+struct ReplayPosition {
+    uint64_t piece = 0;
+    uint64_t offset = 0; // of the next placement
+    uint64_t linesCleared = 0;
+    uint64_t rollingHash = 0;
+    GameGrid grid;
+};
+
+// A replay file, memory mapped where the platform allows and read into memory otherwise
+class Replay {
+    private:
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+    void* mapping = nullptr;
+    std::vector<uint8_t> buffer;
+    ReplayHeader header{};
+
+    private:
+    bool readHeader();
+
+    public:
+    Replay() = default;
+    ~Replay();
+    Replay(const Replay&) = delete;
+    Replay& operator = (const Replay&) = delete;
+
+    // False, leaving the replay closed, if the file can't be read or its header doesn't add up
+    bool open(const std::string& path);
+    bool load(std::vector<uint8_t> bytes);
+    void close();
+
+    const ReplayHeader& getHeader() const { return this->header; };
+    std::size_t getSize() const { return this->size; };
+    ReplayKeyframe getKeyframe(uint64_t index) const;
+
+    // The board after the first piece placements, from the last keyframe at or before it
+    bool seek(uint64_t piece, ReplayPosition& position) const;
+    // Makes the next placement, false at the end or when the placement bytes are bad
+    bool step(ReplayPosition& position, Tetrimino* placement = nullptr) const;
+    // Replays the whole game checking every keyframe and the header's totals. False with
+    // divergence set to the piece of the first one that doesn't match.
+    bool verify(uint64_t& divergence) const;
+};
+
+// How many placements the two replays share before they first differ
+uint64_t matchingPlacements(const Replay& expected, const Replay& actual);
+
+#endif
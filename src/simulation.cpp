@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "simulation.h"
+#include "engine_switch.h"
+#include "replay.h"
+#include "tetris.h"
+#include "thread_pool.h"
+#include "xoshiro.h"
+
+long SimulationReport::totalPieces() const {
+    long pieces = 0;
+    for (const GameResult& game : this->games) {
+        pieces += game.pieces;
+    }
+    return pieces;
+}
+
+double SimulationReport::solveSeconds() const {
+    double microseconds = 0.0;
+    for (double solve : this->solveMicroseconds) {
+        microseconds += solve;
+    }
+    return microseconds / 1e6;
+}
+
+// Pushes every row up one and fills the bottom row but for one random column. False, leaving the
+// grid as it was, when a filled cell would be pushed off the top, which ends the game.
+static bool addGarbageRow(GameGrid& grid, Xoshiro256& rng) {
+    if (grid.getRow(0) != 0) {
+        return false;
+    }
+    for (int y = 0; y < GRID_HEIGHT - 1; y++) {
+        for (int x = 0; x < GRID_WIDTH; x++) {
+            Position below(x, y + 1);
+            if (grid.isEmpty(below)) {
+                grid.clearCell(Position(x, y));
+            }
+            else {
+                grid.setCell(Position(x, y), grid.getSpriteType(below));
+            }
+        }
+    }
+    int hole = static_cast<int>(rng.below(GRID_WIDTH));
+    for (int x = 0; x < GRID_WIDTH; x++) {
+        if (x == hole) {
+            grid.clearCell(Position(x, GRID_HEIGHT - 1));
+        }
+        else {
+            grid.setCell(Position(x, GRID_HEIGHT - 1), third);
+        }
+    }
+    return true;
+}
+
+Xoshiro256 streamGenerator(uint64_t seed, int stream) {
+    Xoshiro256 rng(seed);
+    for (int i = 0; i < stream; i++) {
+        rng.jump();
+    }
+    return rng;
+}
+
+std::vector<Xoshiro256> streamGenerators(uint64_t seed, int count) {
+    std::vector<Xoshiro256> generators;
+    generators.reserve(std::max(count, 0));
+    Xoshiro256 rng(seed);
+    for (int stream = 0; stream < count; stream++) {
+        generators.push_back(rng);
+        rng.jump();
+    }
+    return generators;
+}
+
+GameResult playGame(
+    EngineSwitch& solver,
+    const SimulationSettings& settings,
+    int stream,
+    Xoshiro256 rng,
+    std::vector<double>& solveMicroseconds,
+    ReplayWriter* replay
+) {
+    Xoshiro256 garbageRng = rng;
+    garbageRng.longJump();
+    GameState state(1, rng);
+    state.playerControlled = false;
+
+    GameResult result;
+    result.stream = stream;
+    while (not state.gameOver and (settings.pieceCap == 0 or result.pieces < settings.pieceCap)) {
+        auto start = std::chrono::steady_clock::now();
+        Tetrimino placement = solver.solveForOptimalTetrimino(state.getGrid(), state.getCurrentTetrimino(), state.getNextTetrimino(), settings.weights);
+        solveMicroseconds.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        if (state.getGrid().checkCollision(placement)) { // nowhere left to go
+            state.gameOver = true;
+            break;
+        }
+
+        state.currentTetrimino = placement;
+        state.moveTetrimino(down);
+        result.pieces++;
+        if (state.isLineClearInProgress()) {
+            state.clearFullLines();
+        }
+        if (replay != nullptr) {
+            replay->addPlacement(placement, state.grid.getHash());
+        }
+        if (settings.garbageInterval > 0 and result.pieces % settings.garbageInterval == 0 and not addGarbageRow(state.grid, garbageRng)) {
+            state.gameOver = true;
+            break;
+        }
+        state.initNewTetrimino();
+    }
+    result.linesCleared = state.linesCleared;
+    result.toppedOut = state.gameOver;
+    if (replay != nullptr) {
+        replay->finish(result.toppedOut);
+    }
+    return result;
+}
+
+SimulationReport runSimulation(const SimulationSettings& settings) {
+    ThreadPool pool(settings.threadCount);
+    std::vector<EngineSwitch> solvers(pool.size());
+    std::vector<std::vector<double>> solveMicroseconds(pool.size());
+    for (EngineSwitch& solver : solvers) {
+        solver.engine = settings.engine;
+        solver.mctsSettings = settings.mctsSettings;
+        solver.threadCount = 1;
+        solver.transpositionTableBytes = settings.transpositionTableBytes;
+    }
+
+    SimulationReport report;
+    report.games.resize(std::max(settings.games, 0));
+    std::vector<Xoshiro256> generators = streamGenerators(settings.seed, settings.games);
+    auto start = std::chrono::steady_clock::now();
+    auto playTask = [&](int task, int worker) {
+        if (settings.replayDirectory.empty() or settings.garbageInterval > 0) {
+            report.games[task] = playGame(solvers[worker], settings, task, generators[task], solveMicroseconds[worker]);
+            return;
+        }
+        ReplayWriter replay(settings, task);
+        report.games[task] = playGame(solvers[worker], settings, task, generators[task], solveMicroseconds[worker], &replay);
+        report.games[task].replaySaved = replay.save(settings.replayDirectory + "/game" + std::to_string(task) + ".replay");
+    };
+    pool.run(static_cast<int>(report.games.size()), playTask);
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const std::vector<double>& workerSolves : solveMicroseconds) {
+        report.solveMicroseconds.insert(report.solveMicroseconds.end(), workerSolves.begin(), workerSolves.end());
+    }
+    std::sort(report.solveMicroseconds.begin(), report.solveMicroseconds.end());
+    return report;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    int rank = static_cast<int>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::clamp(rank - 1, 0, static_cast<int>(sorted.size()) - 1)];
+}
@@ -0,0 +1,85 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine_switch.h"
+#include "mcts.h"
+#include "solver.h"
+#include "thread_pool.h"
+#include "xoshiro.h"
+
+class ReplayWriter;
+
+/*
+ * games: how many games to play
+ * seed: game i draws its tetriminos from Xoshiro256(seed) jumped i times, so every game gets its own
+ * stream and plays out the same whatever else runs
+ * pieceCap: a game stops after placing this many tetriminos, 0 to play until it tops out
+ * threadCount: games played at the same time, each solving on its own thread
+ * replayDirectory: when set, every game is also saved there as game<stream>.replay, see replay.h.
+ * Replays only record placements, so games with garbage are never saved.
+ * garbageInterval: after every this many pieces the board is pushed up a row and a garbage row with
+ * one random hole rises from the floor, 0 for none. The holes come from the game's generator
+ * long jumped, so adding garbage doesn't change which tetriminos a game gets.
+ */
+struct SimulationSettings {
+    int games = 1;
+    uint64_t seed = 0;
+    int pieceCap = 1000;
+    int threadCount = ThreadPool::defaultThreadCount();
+    SolverEngine engine = twoPlyEngine;
+    MctsSettings mctsSettings;
+    std::size_t transpositionTableBytes = 4 << 20; // per thread
+    EvaluationWeights weights;
+    std::string replayDirectory;
+    int garbageInterval = 0;
+};
+
+struct GameResult {
+    int stream = 0; // times the seeded generator was jumped
+    int pieces = 0;
+    int linesCleared = 0;
+    bool toppedOut = false;
+    bool replaySaved = false;
+};
+
+struct SimulationReport {
+    std::vector<GameResult> games; // in stream order
+    std::vector<double> solveMicroseconds; // how long every solve of every game took, sorted
+    double seconds = 0.0; // wall clock time for all the games
+
+    long totalPieces() const;
+    double solveSeconds() const; // summed over threads
+};
+
+/*
+ * Plays games without drawing them, the way lazy_no_animation plays a GameState: the current
+ * tetrimino goes where the engine says and the game is over once a new tetrimino can't spawn.
+ * Games are handed out to a thread pool and each thread has its own single threaded solver, so
+ * adding threads plays more games at once without changing any game's result (except with an MCTS
+ * engine limited by time).
+ */
+SimulationReport runSimulation(const SimulationSettings& settings);
+// The generator game stream draws its tetriminos from: Xoshiro256(seed) jumped stream times
+Xoshiro256 streamGenerator(uint64_t seed, int stream);
+// The generators of streams 0 to count - 1, one jump apart, so count games cost count jumps
+// rather than one per stream before them
+std::vector<Xoshiro256> streamGenerators(uint64_t seed, int count);
+
+// One of runSimulation's games with the given solver and its stream's generator, appending how long
+// each solve took and recording every placement in replay when given one
+GameResult playGame(
+    EngineSwitch& solver,
+    const SimulationSettings& settings,
+    int stream,
+    Xoshiro256 rng,
+    std::vector<double>& solveMicroseconds,
+    ReplayWriter* replay = nullptr);
+
+// Nearest rank percentile of sorted values, p in [0, 100]. 0 when there are no values.
+double percentile(const std::vector<double>& sorted, double p);
+
+#endif
@@ -1,101 +1,126 @@
 #include <algorithm>
-#include <queue>
+#include <array>
+#include <bit>
+#include <numeric>
 #include <vector>
 #include "constants.h"
 #include "tetris.h"
 #include "solver.h"
+#include "solver_stats.h"
+#include "perf_counters.h"
+#include "trace.h"
 
-void setNodeNeighbours(GraphNode& node, Graph* graph, GameGrid& grid) {
+void setNodeNeighbours(NodeIndex node, Graph* graph, GameGrid& grid) {
     // hot path optimization: this function gets called a lot so instead of using tetrimino.move which makes a copy,
     // a copy of the node tetrimino is made and its state is modified directly
-    Tetrimino tetriminoCopy(node.tetrimino.shape, node.tetrimino.xDelta, node.tetrimino.yDelta, node.tetrimino.rotationStep);
+    Tetrimino tetriminoCopy = graph->getTetrimino(node);
+    uint8_t neighbours = 0;
+    SOLVER_STATS_COUNT(graphNodesCounter, 1);
+    SOLVER_STATS_COUNT(neighbourTestsCounter, 4);
 
     tetriminoCopy.xDelta -= 1; // move left
     if (not grid.checkCollision(tetriminoCopy)) {
-        node.neighbours.push_back(&(*graph)[tetriminoCopy.yDelta][tetriminoCopy.xDelta][tetriminoCopy.rotationStep]);
+        neighbours |= leftNeighbour;
     }
 
     tetriminoCopy.xDelta += 2; // move right
     if (not grid.checkCollision(tetriminoCopy)) {
-        node.neighbours.push_back(&(*graph)[tetriminoCopy.yDelta][tetriminoCopy.xDelta][tetriminoCopy.rotationStep]);
+        neighbours |= rightNeighbour;
     }
 
     tetriminoCopy.xDelta -= 1; // undo move right
-    int oldRotationStep = tetriminoCopy.rotationStep;
-    tetriminoCopy.rotationStep = (tetriminoCopy.rotationStep + 1) % tetriminoCopy.rotationList->size();
+    int8_t oldRotationStep = tetriminoCopy.rotationStep;
+    tetriminoCopy.rotationStep = (tetriminoCopy.rotationStep + 1) % tetriminoCopy.getRotationCount();
     if (not grid.checkCollision(tetriminoCopy)) {
-        node.neighbours.push_back(&(*graph)[tetriminoCopy.yDelta][tetriminoCopy.xDelta][tetriminoCopy.rotationStep]);
+        neighbours |= rotatedNeighbour;
     }
     tetriminoCopy.rotationStep = oldRotationStep; // restore rotation step
 
     tetriminoCopy.yDelta += 1; // move down
     if (not grid.checkCollision(tetriminoCopy)) {
-        node.neighbours.push_back(&(*graph)[tetriminoCopy.yDelta][tetriminoCopy.xDelta][tetriminoCopy.rotationStep]);
+        neighbours |= belowNeighbour;
     }
+
+    graph->neighbours[node] = neighbours;
 }
 
 
-std::unique_ptr<Graph> makeGraph(Tetrimino& tetrimino, GameGrid& grid) {
-    auto graph = std::make_unique<Graph>();
+void makeGraph(Graph& graph, Tetrimino& tetrimino, GameGrid& grid) {
+    TRACE_SCOPE("makeGraph");
+    PERF_PHASE(makeGraphPhase);
+    // the graph may be reused from a previous solve so only the rotations that exist for this 
+    // tetrimino are linked. Nodes for other rotations keep stale masks but are never reachable.
+    int rotationCount = tetrimino.getRotationCount();
+    graph.shape = tetrimino.shape;
 
     for (int y = 0; y < GRID_HEIGHT; y++) {
         for (int x = 0; x < GRID_WIDTH; x++) {
-            for (int rotation = 0; rotation < tetrimino.rotationList->size(); rotation++) {
-                (*graph)[y][x][rotation] = { // GraphNode
-                    .tetrimino = Tetrimino(tetrimino.shape, x, y, rotation),
-                };
+            for (int rotation = 0; rotation < rotationCount; rotation++) {
+                setNodeNeighbours(nodeIndex(x, y, rotation), &graph, grid);
             }
         }
     }
+}
 
-    for (std::array<std::array<GraphNode, 4>, GRID_WIDTH>& row : *graph) {
-        for (std::array<GraphNode, 4>& col : row) {
-            for(GraphNode& node : col) {
-                if (node.tetrimino.shape != N) { // tetrimino is not null
-                    setNodeNeighbours(node, graph.get(), grid);
-                }
-            }
-        }
-    }
+
+std::unique_ptr<Graph> makeGraph(Tetrimino& tetrimino, GameGrid& grid) {
+    auto graph = std::make_unique<Graph>();
+    makeGraph(*graph, tetrimino, grid);
     return graph;
 }
 
 
-std::vector<GraphNode*> search(Graph* graph, Tetrimino& tetrimino, GameGrid& grid) {
-    std::queue<GraphNode*> queue;
-    std::vector<GraphNode*> results;
+void search(Graph* graph, Tetrimino& tetrimino, GameGrid& grid, SearchQueue& queue, std::vector<NodeIndex>& results) {
+    TRACE_SCOPE("search");
+    PERF_PHASE(searchPhase);
+    queue.clear();
+    results.clear();
+    graph->visited.fill(0);
+    int rotationCount = tetrimino.getRotationCount();
 
-    GraphNode& root = (*graph)[tetrimino.yDelta][tetrimino.xDelta][tetrimino.rotationStep];
-    root.visited = true;  
-    queue.push(&root);
+    NodeIndex root = nodeIndex(tetrimino.xDelta, tetrimino.yDelta, tetrimino.rotationStep);
+    graph->setVisited(root);
+    graph->prev[root] = NO_NODE;
+    queue.push(root);
 
     while (not queue.empty()) {
-        GraphNode* node = queue.front();
-        queue.pop();
+        NodeIndex node = queue.pop();
+        SOLVER_STATS_COUNT(bfsVisitsCounter, 1);
 
-        if (grid.checkCollision(node->tetrimino.move(down))) {
+        if (grid.checkCollision(graph->getTetrimino(node).move(down))) {
             results.push_back(node);
         }
 
-        for (GraphNode* neighbour : node->neighbours) {
-            if (not neighbour->visited) {
-                neighbour->visited = true;
-                neighbour->prev = node;
+        // visit neighbours lowest bit first, the order setNodeNeighbours found them in
+        for (uint8_t neighbours = graph->neighbours[node]; neighbours != 0; neighbours &= neighbours - 1) {
+            NeighbourBit bit = static_cast<NeighbourBit>(neighbours & -neighbours);
+            NodeIndex neighbour = neighbourIndex(node, bit, rotationCount);
+            if (not graph->isVisited(neighbour)) {
+                graph->setVisited(neighbour);
+                graph->prev[neighbour] = node;
                 queue.push(neighbour);
             }
         }
     }
+    SOLVER_STATS_COUNT(searchedPlacementsCounter, results.size());
+}
+
+
+std::vector<NodeIndex> search(Graph* graph, Tetrimino& tetrimino, GameGrid& grid) {
+    SearchQueue queue;
+    std::vector<NodeIndex> results;
+    search(graph, tetrimino, grid, queue, results);
     return results;
 }
 
 
-Moves movesToReachSearchResult(GraphNode* searchResult) {
-    GraphNode* node = searchResult;
+Moves movesToReachSearchResult(Graph* graph, NodeIndex searchResult) {
+    NodeIndex node = searchResult;
     Moves moves; // iterating from locked position to spawn point means this will need to be reversed before returning
 
-    while (node->prev != nullptr) {
-        Tetrimino current = node->tetrimino;
-        Tetrimino parent = node->prev->tetrimino;
+    while (graph->prev[node] != NO_NODE) {
+        Tetrimino current = graph->getTetrimino(node);
+        Tetrimino parent = graph->getTetrimino(graph->prev[node]);
 
         if (current.xDelta != parent.xDelta) {
             parent.xDelta < current.xDelta ? moves.push_back(right) : moves.push_back(left);
@@ -106,7 +131,163 @@ Moves movesToReachSearchResult(GraphNode* searchResult) {
         else {
             moves.push_back(down);
         }
-        node = node->prev;
+        node = graph->prev[node];
+    }
+    std::reverse(moves.begin(), moves.end());
+    moves.push_back(down); // add a final down move to lock piece in place on the grid
+    return moves;
+}
+
+
+void findPlacements(Tetrimino& tetrimino, GameGrid& grid, PlacementBoard& board, std::vector<Tetrimino>& results) {
+    int rotationCount = tetrimino.getRotationCount();
+    board.shape = tetrimino.shape;
+    results.clear();
+
+    // A tetrimino collides at x when a grid row has a cell at x + offset for any cell offset of
+    // the tetrimino in that row, so shifting the grid row by each offset gives every x at once
+    for (int rotation = 0; rotation < rotationCount; rotation++) {
+        const PieceMask& mask = pieceMaskTable[tetrimino.shape][rotation];
+        uint16_t inBounds = ((1 << (GRID_WIDTH - mask.maxX)) - 1) & ~((1 << -mask.minX) - 1);
+
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            int top = y + mask.minY;
+            if (top + mask.height > GRID_HEIGHT) { // below the floor
+                board.fits[rotation][y] = 0;
+                continue;
+            }
+
+            uint16_t collisions = 0;
+            for (int i = 0; i < mask.height; i++) {
+                if (top + i < 0) { // rows above the grid are open
+                    continue;
+                }
+                uint16_t row = grid.getRow(top + i);
+                for (uint16_t cells = mask.rows[i]; cells != 0; cells &= cells - 1) {
+                    int offset = std::countr_zero(cells) + mask.minX;
+                    collisions |= offset >= 0 ? row >> offset : row << -offset;
+                }
+            }
+            board.fits[rotation][y] = inBounds & ~collisions;
+        }
+    }
+
+    // Flood fill from the spawn position. A position is reached by moving down from the row above,
+    // rotating clockwise from the previous rotation or sliding left/right within its row. The spawn
+    // position itself is always reached, like the root of a search, even if it doesn't fit.
+    for (auto& rows : board.reachable) {
+        rows.fill(0);
+    }
+    board.reachable[tetrimino.rotationStep][tetrimino.yDelta] = 1 << tetrimino.xDelta;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int rotation = 0; rotation < rotationCount; rotation++) {
+            int previousRotation = (rotation + rotationCount - 1) % rotationCount;
+
+            for (int y = 0; y < GRID_HEIGHT; y++) {
+                uint16_t fits = board.fits[rotation][y];
+                uint16_t reachable = board.reachable[rotation][y];
+                uint16_t expanded = reachable | (board.reachable[previousRotation][y] & fits);
+                if (y > 0) {
+                    expanded |= board.reachable[rotation][y - 1] & fits;
+                }
+
+                uint16_t previous;
+                do {
+                    previous = expanded;
+                    expanded |= ((expanded << 1) | (expanded >> 1)) & fits;
+                } while (expanded != previous);
+
+                if (expanded != reachable) {
+                    board.reachable[rotation][y] = expanded;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // a reachable position is a placement when it can't move down any further
+    for (int rotation = 0; rotation < rotationCount; rotation++) {
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            uint16_t below = y + 1 < GRID_HEIGHT ? board.fits[rotation][y + 1] : 0;
+            for (uint16_t landed = board.reachable[rotation][y] & ~below; landed != 0; landed &= landed - 1) {
+                results.push_back(Tetrimino(tetrimino.shape, std::countr_zero(landed), y, rotation));
+            }
+        }
+    }
+    SOLVER_STATS_COUNT(foundPlacementsCounter, results.size());
+}
+
+
+Moves movesToReachPlacement(const PlacementBoard& board, Tetrimino& tetrimino, Tetrimino placement) {
+    typedef std::array<std::array<uint16_t, GRID_HEIGHT>, 4> Positions;
+    int rotationCount = tetrimino.getRotationCount();
+    auto contains = [](const Positions& positions, int x, int y, int rotation) {
+        return x >= 0 and x < GRID_WIDTH and y >= 0 and (positions[rotation][y] >> x) & 1;
+    };
+
+    // breadth first search one whole layer of positions at a time. layers[i] holds every position
+    // that is i moves away from the spawn position.
+    std::vector<Positions> layers(1);
+    layers[0][tetrimino.rotationStep][tetrimino.yDelta] = 1 << tetrimino.xDelta;
+    Positions visited = layers[0];
+
+    while (not contains(layers.back(), placement.xDelta, placement.yDelta, placement.rotationStep)) {
+        const Positions& frontier = layers.back();
+        Positions next{};
+        for (int rotation = 0; rotation < rotationCount; rotation++) {
+            for (int y = 0; y < GRID_HEIGHT; y++) {
+                uint16_t positions = frontier[rotation][y];
+                next[rotation][y] |= (positions << 1) | (positions >> 1);
+                next[(rotation + 1) % rotationCount][y] |= positions;
+                if (y + 1 < GRID_HEIGHT) {
+                    next[rotation][y + 1] |= positions;
+                }
+            }
+        }
+
+        bool found = false;
+        for (int rotation = 0; rotation < rotationCount; rotation++) {
+            for (int y = 0; y < GRID_HEIGHT; y++) {
+                next[rotation][y] &= board.fits[rotation][y] & ~visited[rotation][y];
+                visited[rotation][y] |= next[rotation][y];
+                found = found or next[rotation][y] != 0;
+            }
+        }
+        if (not found) { // placement can't be reached
+            return {};
+        }
+        layers.push_back(next);
+    }
+
+    // walk back through the layers, each time stepping to a position in the previous layer that
+    // leads to the current one
+    Moves moves;
+    int x = placement.xDelta;
+    int y = placement.yDelta;
+    int rotation = placement.rotationStep;
+    for (int layer = static_cast<int>(layers.size()) - 1; layer > 0; layer--) {
+        const Positions& previous = layers[layer - 1];
+        int previousRotation = (rotation + rotationCount - 1) % rotationCount;
+
+        if (contains(previous, x, y - 1, rotation)) {
+            moves.push_back(down);
+            y--;
+        }
+        else if (contains(previous, x + 1, y, rotation)) {
+            moves.push_back(left);
+            x++;
+        }
+        else if (contains(previous, x - 1, y, rotation)) {
+            moves.push_back(right);
+            x--;
+        }
+        else {
+            moves.push_back(clockwise);
+            rotation = previousRotation;
+        }
     }
     std::reverse(moves.begin(), moves.end());
     moves.push_back(down); // add a final down move to lock piece in place on the grid
@@ -201,6 +382,13 @@ void computeEvaluationFactors(GameGrid grid, EvaluationFactors& factors) {
     }
 }
 
+void getEvaluationFactors(GameGrid& grid, EvaluationFactors& factors) {
+    const BoardFeatures& features = grid.getFeatures();
+    factors.totalWellCells = features.wellCells;
+    factors.totalColumnHoles = features.columnHoles;
+    factors.totalColumnTransistions = features.columnTransitions;
+    factors.totalRowTransitions = features.rowTransitions;
+}
 
 double computeFitness(EvaluationFactors factors, EvaluationWeights weights) {
     return (
@@ -213,39 +401,210 @@ double computeFitness(EvaluationFactors factors, EvaluationWeights weights) {
     );
 }
 
-GraphNode* solve(Graph* firstTetriminoGraph, GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
-    GraphNode* bestResult = nullptr;
-    double bestFitness = -1.0;
+double computeBoardFitness(GameGrid& grid, int totalLockHeight, int linesCleared, EvaluationWeights weights) {
+    EvaluationFactors factors;
+    getEvaluationFactors(grid, factors);
+    factors.totalLinesCleared = linesCleared;
+    factors.totalLockHeight = totalLockHeight;
+    return computeFitness(factors, weights);
+}
 
-    auto analyze = [&firstTetriminoGraph, &bestResult, &bestFitness, &weights](GameGrid& grid, int totalLockHeight, int linesCleared, GraphNode* tetriminoPlacement) {
-        EvaluationFactors factors;
-        computeEvaluationFactors(grid, factors);
-        factors.totalLinesCleared = linesCleared;
-        factors.totalLockHeight = totalLockHeight;
+void getEvaluationFactors(SolverContext& context, GameGrid& grid, EvaluationFactors& factors) {
+    SOLVER_STATS_COUNT(leavesEvaluatedCounter, 1);
+    if (context.transpositionTable == nullptr) {
+        getEvaluationFactors(grid, factors);
+    } else if (not context.transpositionTable->probe(grid.getHash(), factors, context.transpositionCounters)) {
+        getEvaluationFactors(grid, factors);
+        context.transpositionTable->store(grid.getHash(), factors, context.transpositionCounters);
+    }
+}
 
-        double fitness = computeFitness(factors, weights);
+double computeBoardFitness(SolverContext& context, GameGrid& grid, int totalLockHeight, int linesCleared, EvaluationWeights weights) {
+    EvaluationFactors factors;
+    getEvaluationFactors(context, grid, factors);
+    factors.totalLinesCleared = linesCleared;
+    factors.totalLockHeight = totalLockHeight;
+    return computeFitness(factors, weights);
+}
+
+void addLeaf(SolverContext& context, GameGrid& grid, int totalLockHeight, int linesCleared, NodeIndex firstResult) {
+    EvaluationFactors factors;
+    getEvaluationFactors(context, grid, factors);
+    factors.totalLinesCleared = linesCleared;
+    factors.totalLockHeight = totalLockHeight;
+    context.leaves.push(factors, firstResult);
+}
 
-        if (bestFitness < 0 or fitness < bestFitness) {
-            bestFitness = fitness;
-            bestResult = tetriminoPlacement;
+void flushTranspositionCounters(SolverContext& context) {
+    if (context.transpositionTable != nullptr) {
+        context.transpositionTable->addCounters(context.transpositionCounters);
+    }
+    context.transpositionCounters = TranspositionCounters();
+}
+
+// Largest sum of values over count consecutive entries
+template <std::size_t Size>
+static int maxWindowSum(const std::array<int, Size>& values, int count) {
+    int sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    int best = sum;
+    for (std::size_t i = count; i < Size; i++) {
+        sum += values[i] - values[i - count];
+        best = std::max(best, sum);
+    }
+    return best;
+}
+
+double computeNextPlacementBound(GameGrid& grid, int totalLockHeight, int linesCleared, EvaluationWeights weights) {
+    // How far one more tetrimino can bring each factor down:
+    // - it covers at most 4 consecutive rows and columns, everything else is only changed by clearing
+    //   rows, and a row can only be cleared if it is missing 4 cells or less
+    // - filling a cell removes at most 2 transitions from its row, 2 from its column and 1 hole
+    // - clearing a row removes at most 1 hole and 2 transitions from every column and never removes 
+    //   a well cell, so wells only change in the tetrimino's columns and their neighbours
+    std::array<uint16_t, GRID_HEIGHT> rows;
+    std::array<int, GRID_HEIGHT> rowTransitions;
+    int maxRowsCleared = 0;
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        rows[y] = grid.getRow(y);
+        rowTransitions[y] = countRowTransitions(rows[y]);
+        if (GRID_WIDTH - std::popcount(rows[y]) <= 4) {
+            maxRowsCleared++;
         }
+    }
+    maxRowsCleared = std::min(maxRowsCleared, 4);
+
+    std::array<uint32_t, GRID_WIDTH> columns = transposeRows(rows);
+    std::array<int, GRID_WIDTH> wellCells;
+    std::array<int, GRID_WIDTH> columnHoles;
+    std::array<int, GRID_WIDTH> columnTransitions;
+    for (int col = 0; col < GRID_WIDTH; col++) {
+        uint32_t left = col == 0 ? WALL_COLUMN : columns[col - 1];
+        uint32_t right = col == GRID_WIDTH - 1 ? WALL_COLUMN : columns[col + 1];
+        wellCells[col] = countColumnWellCells(columns[col], left, right);
+        columnHoles[col] = std::max(countColumnHoles(columns[col]) - maxRowsCleared, 0);
+        columnTransitions[col] = std::max(countColumnTransitions(columns[col]) - 2 * maxRowsCleared, 0);
+    }
+
+    EvaluationFactors factors;
+    factors.totalLinesCleared = linesCleared;
+    factors.totalLockHeight = totalLockHeight;
+    factors.totalWellCells = std::accumulate(wellCells.begin(), wellCells.end(), 0) - maxWindowSum(wellCells, 6);
+    factors.totalColumnHoles = (
+        std::accumulate(columnHoles.begin(), columnHoles.end(), 0) - std::min(maxWindowSum(columnHoles, 4), 4));
+    factors.totalColumnTransistions = (
+        std::accumulate(columnTransitions.begin(), columnTransitions.end(), 0) - std::min(maxWindowSum(columnTransitions, 4), 8));
+    factors.totalRowTransitions = (
+        std::accumulate(rowTransitions.begin(), rowTransitions.end(), 0) - std::min(maxWindowSum(rowTransitions, 4), 8));
+    // every factor is at most the real one and computeFitness adds them in a fixed order, so with 
+    // no negative weights rounding can't push the bound above a real score
+    return computeFitness(factors, weights);
+}
+
+bool hasNegativeWeight(const EvaluationWeights& weights) {
+    return (
+        weights.totalLinesCleared < 0 or weights.totalLockHeight < 0 or weights.totalWellCells < 0 or 
+        weights.totalColumnHoles < 0 or weights.totalColumnTransitions < 0 or weights.totalRowTransitions < 0
+    );
+}
+
+NodeIndex solve(SolverContext& context, GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    makeGraph(context.firstGraph, firstTetrimino, grid);
+    search(&context.firstGraph, firstTetrimino, grid, context.queue, context.firstResults);
+    context.stats = SolveStats();
+    context.stats.firstPlacements = static_cast<int>(context.firstResults.size());
+
+    // the bound only holds when every weight penalizes, otherwise everything is expanded in search order
+    bool pruning = context.pruning and not hasNegativeWeight(weights);
+    int totalLockHeight = firstTetrimino.getHeight() + secondTetrimino.getHeight();
+
+    context.firstPlacementOrder.clear();
+    for (int i = 0; i < static_cast<int>(context.firstResults.size()); i++) {
+        double bound = 0.0;
+        if (pruning) {
+            Tetrimino firstPlacement = context.firstGraph.getTetrimino(context.firstResults[i]);
+            if (grid.checkCollision(firstPlacement)) {
+                continue;
+            }
+            GameGrid gridCopy = grid;
+            gridCopy.setCells(firstPlacement);
+            int linesCleared = gridCopy.clearFullRows();
+            bound = computeNextPlacementBound(gridCopy, totalLockHeight, linesCleared, weights);
+        }
+        context.firstPlacementOrder.push_back({ .bound = bound, .order = i });
+    }
+    // most promising first so the best board found early prunes as much as possible
+    std::sort(
+        context.firstPlacementOrder.begin(), 
+        context.firstPlacementOrder.end(), 
+        [](const FirstPlacementBound& a, const FirstPlacementBound& b) {
+            return a.bound != b.bound ? a.bound < b.bound : a.order < b.order;
+        });
+
+    // leaves are collected per first placement, scoring them in one batch lets findBestLeaf use SIMD
+    auto analyze = [&context](GameGrid& grid, int totalLockHeight, int linesCleared, NodeIndex tetriminoPlacement) {
+        addLeaf(context, grid, totalLockHeight, linesCleared, tetriminoPlacement);
     };
 
-    GraphNode* defaultResult = analyzeAllCombinations(analyze, firstTetriminoGraph, grid, firstTetrimino, secondTetrimino);
+    int bestOrder = -1;
+    double bestFitness = 0.0;
+    int expanded = 0;
+    for (const FirstPlacementBound& candidate : context.firstPlacementOrder) {
+        // candidates are sorted so once one can't win none of the remaining ones can either
+        bool beaten = candidate.bound > bestFitness or (candidate.bound == bestFitness and candidate.order > bestOrder);
+        if (pruning and bestOrder >= 0 and beaten) {
+            break;
+        }
+
+        NodeIndex firstResult = context.firstResults[candidate.order];
+        context.leaves.clear();
+        analyzeSecondPlacements(
+            analyze, context, grid, firstResult, context.firstGraph.getTetrimino(firstResult), firstTetrimino, secondTetrimino);
+        LeafScore best = findBestLeaf(context.leaves, weights);
+        context.stats.evaluatedLeaves += context.leaves.size();
+        expanded++;
+
+        if (best.index < 0) {
+            continue;
+        }
+        if (bestOrder < 0 or best.fitness < bestFitness or (best.fitness == bestFitness and candidate.order < bestOrder)) {
+            bestFitness = best.fitness;
+            bestOrder = candidate.order;
+        }
+    }
+    flushTranspositionCounters(context);
+
+    context.stats.prunedFirstPlacements = static_cast<int>(context.firstPlacementOrder.size()) - expanded;
+    if (expanded > 0) {
+        context.stats.estimatedPrunedLeaves = context.stats.prunedFirstPlacements * context.stats.evaluatedLeaves / expanded;
+    }
 
-    return bestResult ? bestResult : defaultResult;
+    // need a default result in case everything causes collisions with the grid
+    return bestOrder >= 0 ? context.firstResults[bestOrder] : context.firstResults.at(0);
+}
+
+
+Moves solveForMovesToOptimalTetrimino(SolverContext& context, GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = solve(context, grid, firstTetrimino, secondTetrimino, weights);
+    return movesToReachSearchResult(&context.firstGraph, bestResult);
 }
 
 
 Moves solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
-    auto firstGraph = makeGraph(firstTetrimino, grid);
-    GraphNode* bestResult = solve(firstGraph.get(), grid, firstTetrimino, secondTetrimino, weights);
-    return movesToReachSearchResult(bestResult);
+    SolverContext context;
+    return solveForMovesToOptimalTetrimino(context, grid, firstTetrimino, secondTetrimino, weights);
+}
+
+
+Tetrimino solveForOptimalTetrimino(SolverContext& context, GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
+    NodeIndex bestResult = solve(context, grid, firstTetrimino, secondTetrimino, weights);
+    return context.firstGraph.getTetrimino(bestResult);
 }
 
 
 Tetrimino solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights) {
-    auto firstGraph = makeGraph(firstTetrimino, grid);
-    GraphNode* bestResult = solve(firstGraph.get(), grid, firstTetrimino, secondTetrimino, weights);
-    return bestResult->tetrimino;
+    SolverContext context;
+    return solveForOptimalTetrimino(context, grid, firstTetrimino, secondTetrimino, weights);
 }
\ No newline at end of file
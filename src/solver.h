@@ -2,49 +2,68 @@
 #define SOLVER_H
 
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <variant>
 #include <vector>
 #include "constants.h"
+#include "batch_evaluator.h"
+#include "perf_counters.h"
 #include "tetris.h"
+#include "trace.h"
+#include "transposition_table.h"
 
-struct GraphNode; 
-
-/* 
- * This class was made for optimization purposes.
- * It's goal is to act like a vector but under the hood it's an array of 
- * size 4.
- * Originally, node neighbours were stored in a vector but this was very costly
- * because the vectors were very small and many were allocated.
- * We know a node's neighbours will be at most 4 by looking at setNodeNeighbours.
- * We can take advantage of this by having a stack allocated array with a vector
- * like interface.
+/*
+ * Graph nodes are identified by their index into the Graph arrays instead of by pointer.
+ * The index encodes the node's tetrimino: ((row * GRID_WIDTH) + column) * 4 + rotation.
  */
- class NodeNeighbours {
-    public:
-    std::array<GraphNode*, 4> arr{};
-    std::size_t size = 0;
-
-    void push_back(GraphNode* neighbour) {this->arr[this->size] = neighbour; this->size++;};
-    std::array<GraphNode*, 4>::iterator end() {return this->arr.begin() + this->size;};
-    std::array<GraphNode*, 4>::iterator begin() { return this->arr.begin(); };
-    std::array<GraphNode*, 4>::const_iterator begin() const {return this->arr.begin();};
-    std::array<GraphNode*, 4>::const_iterator end() const {return this->arr.begin() + this->size;};
+typedef uint16_t NodeIndex;
+const NodeIndex NO_NODE = 0xFFFF; // prev of the root node
+
+const int GRAPH_SIZE = GRID_HEIGHT * GRID_WIDTH * 4;
+
+constexpr NodeIndex nodeIndex(int x, int y, int rotation) {
+    return static_cast<NodeIndex>((((y * GRID_WIDTH) + x) * 4) + rotation);
+}
+
+/*
+ * A node has at most 4 neighbours, one for each move in setNodeNeighbours, so they are stored as
+ * a bitmask of these flags instead of a list. The neighbour's index is computed from the flag.
+ * Bits are in the order setNodeNeighbours tests them which is also the order search visits them.
+ */
+enum NeighbourBit : uint8_t {
+    leftNeighbour = 1 << 0,
+    rightNeighbour = 1 << 1,
+    rotatedNeighbour = 1 << 2, // clockwise
+    belowNeighbour = 1 << 3
 };
 
- //class Graph {
- //public:
- //    std::vector<GraphNode> graph{ GRID_FRAME_HEIGHT * GRID_WIDTH * 4 };
- //    GraphNode at(size_t row, size_t col, size_t rotation) { return graph[(row * GRID_WIDTH * 4) + (col * 4) + rotation]; }
- //    void set(size_t row, size_t col, size_t rotation, GraphNode node) { graph[(row * GRID_WIDTH * 4) + (col * 4) + rotation] = node; }
- //};
-
-struct GraphNode {
-    Tetrimino tetrimino;
-    bool visited = false;
-    GraphNode* prev = nullptr;
-    NodeNeighbours neighbours;
+constexpr NodeIndex neighbourIndex(NodeIndex node, NeighbourBit neighbour, int rotationCount) {
+    switch (neighbour) {
+        case leftNeighbour: return node - 4;
+        case rightNeighbour: return node + 4;
+        case rotatedNeighbour: return node - (node % 4) + (((node % 4) + 1) % rotationCount);
+        default: return node + (GRID_WIDTH * 4); // belowNeighbour
+    }
+}
+
+/*
+ * Stored as a structure of arrays rather than an array of node structs. BFS only touches the 
+ * neighbour masks, prev links and visited bits, which add up to a couple of kilobytes per graph, 
+ * so a whole graph stays in cache. A node's tetrimino is derived from its index and the shape.
+ */
+struct Graph {
+    TetriminoShape shape = N;
+    std::array<uint8_t, GRAPH_SIZE> neighbours{}; // NeighbourBit flags
+    std::array<NodeIndex, GRAPH_SIZE> prev{};
+    std::array<uint64_t, (GRAPH_SIZE + 63) / 64> visited{};
+
+    Tetrimino getTetrimino(NodeIndex node) const {
+        return Tetrimino(this->shape, (node / 4) % GRID_WIDTH, node / (GRID_WIDTH * 4), node % 4);
+    };
+    bool isVisited(NodeIndex node) const { return this->visited[node / 64] & (uint64_t(1) << (node % 64)); };
+    void setVisited(NodeIndex node) { this->visited[node / 64] |= uint64_t(1) << (node % 64); };
 };
 
 struct EvaluationFactors {
@@ -65,59 +84,184 @@ struct EvaluationWeights {
     double totalRowTransitions;
 };
 
-typedef std::array<std::array<std::array<GraphNode, 4>, GRID_WIDTH>, GRID_HEIGHT> Graph; // first dimension is row second dimension is column third dimension is rotation
+/*
+ * Ring buffer used as the BFS queue in search.
+ * A node is pushed at most once per search so the queue can never hold more than GRAPH_SIZE 
+ * nodes. The capacity is rounded up to a power of two so wrapping around is a mask.
+ */
+class SearchQueue {
+    public:
+    static const std::size_t capacity = 1024;
+    static_assert(capacity >= GRAPH_SIZE and (capacity & (capacity - 1)) == 0);
+
+    private:
+    std::array<NodeIndex, capacity> buffer;
+    std::size_t head = 0;
+    std::size_t tail = 0;
+
+    public:
+    bool empty() const { return this->head == this->tail; };
+    void clear() { this->head = this->tail = 0; };
+    void push(NodeIndex node) { this->buffer[this->tail++ & (capacity - 1)] = node; };
+    NodeIndex pop() { return this->buffer[this->head++ & (capacity - 1)]; };
+};
+
+/*
+ * Bitboard alternative to makeGraph + search that finds every reachable position of a tetrimino 
+ * without building a per-node graph.
+ * Bit x of fits[r][y] is set when the tetrimino can be at (x, y) in rotation r without colliding,
+ * bit x of reachable[r][y] is set when that position can be reached from the spawn position. 
+ * Both are filled a whole row of positions at a time using shifts and masks.
+ */
+struct PlacementBoard {
+    TetriminoShape shape = N;
+    std::array<std::array<uint16_t, GRID_HEIGHT>, 4> fits{};
+    std::array<std::array<uint16_t, GRID_HEIGHT>, 4> reachable{};
+};
+
+// One first placement in the order solve() expands them
+struct FirstPlacementBound {
+    double bound; // no board reached through this placement scores lower
+    int order; // index into firstResults
+};
+
+// What the last solve with a context did. Leaves under pruned placements are never generated so 
+// their number is estimated from the average of the expanded placements.
+struct SolveStats {
+    int firstPlacements = 0;
+    int prunedFirstPlacements = 0;
+    int evaluatedLeaves = 0;
+    int estimatedPrunedLeaves = 0;
+};
+
+/*
+ * Scratch space for solving. Holding on to one of these between calls means that, once its result 
+ * buffers have grown on the first solve, solving makes no heap allocations.
+ * Node indices returned by solve refer to firstGraph and are only valid until the next solve that 
+ * uses the same context.
+ * When transpositionTable is set, board evaluations are looked up in it before being computed. The
+ * table can be shared by several contexts. Hits and misses are counted in transpositionCounters 
+ * until flushTranspositionCounters adds them to the table.
+ */
+class SolverContext {
+    public:
+    Graph firstGraph;
+    SearchQueue queue;
+    std::vector<NodeIndex> firstResults;
+    PlacementBoard secondBoard;
+    std::vector<Tetrimino> secondResults;
+    LeafBatch leaves; // boards reached by placing both tetriminos, scored together once per first placement
+    std::vector<FirstPlacementBound> firstPlacementOrder;
+    bool pruning = true; // can be turned off to check that pruning doesn't change results
+    SolveStats stats;
+    TranspositionTable* transpositionTable = nullptr;
+    TranspositionCounters transpositionCounters;
+
+    SolverContext() {
+        this->firstResults.reserve(GRAPH_SIZE);
+        this->secondResults.reserve(GRAPH_SIZE);
+        this->leaves.reserve(GRAPH_SIZE);
+        this->firstPlacementOrder.reserve(GRAPH_SIZE);
+    };
+};
+
 typedef std::variant<Direction, Rotation> Move;
 typedef std::vector<Move> Moves;
 
-void setNodeNeighbours(GraphNode& node, Graph* graph, GameGrid& grid);
+void setNodeNeighbours(NodeIndex node, Graph* graph, GameGrid& grid);
+void makeGraph(Graph& graph, Tetrimino& tetrimino, GameGrid& grid);
 std::unique_ptr<Graph> makeGraph(Tetrimino& tetrimino, GameGrid& grid);
-std::vector<GraphNode*> search(Graph* graph, Tetrimino& tetrimino, GameGrid& grid);
-Moves movesToReachSearchResult(GraphNode* searchResult);
+void search(Graph* graph, Tetrimino& tetrimino, GameGrid& grid, SearchQueue& queue, std::vector<NodeIndex>& results);
+std::vector<NodeIndex> search(Graph* graph, Tetrimino& tetrimino, GameGrid& grid);
+Moves movesToReachSearchResult(Graph* graph, NodeIndex searchResult);
+void findPlacements(Tetrimino& tetrimino, GameGrid& grid, PlacementBoard& board, std::vector<Tetrimino>& results);
+Moves movesToReachPlacement(const PlacementBoard& board, Tetrimino& tetrimino, Tetrimino placement);
+// Scans the whole grid. The solvers use getEvaluationFactors, which reads the features GameGrid keeps
+// up to date and must give the same result
 void computeEvaluationFactors(GameGrid grid, EvaluationFactors& factors);
+void getEvaluationFactors(GameGrid& grid, EvaluationFactors& factors);
+void getEvaluationFactors(SolverContext& context, GameGrid& grid, EvaluationFactors& factors); // uses the context's transposition table
 double computeFitness(EvaluationFactors factors, EvaluationWeights weights);
+double computeBoardFitness(GameGrid& grid, int totalLockHeight, int linesCleared, EvaluationWeights weights);
+double computeBoardFitness(SolverContext& context, GameGrid& grid, int totalLockHeight, int linesCleared, EvaluationWeights weights);
+void addLeaf(SolverContext& context, GameGrid& grid, int totalLockHeight, int linesCleared, NodeIndex firstResult); // to context.leaves
+void flushTranspositionCounters(SolverContext& context);
+// Lower bound on the fitness of every board reachable from grid by placing one more tetrimino, 
+// given the lock height and lines cleared that board will be scored with. Only valid when no 
+// weight is negative.
+double computeNextPlacementBound(GameGrid& grid, int totalLockHeight, int linesCleared, EvaluationWeights weights);
+bool hasNegativeWeight(const EvaluationWeights& weights);
 
-GraphNode* solve(
-    Graph* firstTetriminoGraph,
+// Picks the first placement leading to the lowest scoring board once both tetriminos are placed, 
+// the earliest one in search order on ties. First placements are expanded in order of their 
+// computeNextPlacementBound and the rest are skipped once their bound can't beat the best board 
+// found so far. The skipped counts end up in context.stats.
+NodeIndex solve(
+    SolverContext& context,
     GameGrid& grid, 
     Tetrimino firstTetrimino, 
     Tetrimino secondTetrimino, 
     EvaluationWeights weights);
 
+Moves solveForMovesToOptimalTetrimino(SolverContext& context, GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
 Moves solveForMovesToOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
+Tetrimino solveForOptimalTetrimino(SolverContext& context, GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
 Tetrimino solveForOptimalTetrimino(GameGrid grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino, EvaluationWeights weights);
 
+// Calls analyze for every board reachable by placing secondTetrimino after firstPlacement.
+// firstResult is firstPlacement's node in the first tetrimino's graph and is passed through to analyze.
+// The second tetrimino's placements only need to be found, not reached, so they come from 
+// findPlacements instead of a graph search.
 template <typename Func>
-GraphNode* analyzeAllCombinations(Func analyze, Graph* firstTetriminoGraph, GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino) {
-    std::vector<GraphNode*> firstResults = search(firstTetriminoGraph, firstTetrimino, grid);
+void analyzeSecondPlacements(
+    Func& analyze, 
+    SolverContext& context, 
+    GameGrid& grid, 
+    NodeIndex firstResult, 
+    Tetrimino firstPlacement, 
+    Tetrimino firstTetrimino, 
+    Tetrimino secondTetrimino
+) {
+    TRACE_SCOPE("secondPly");
+    PERF_PHASE(secondPlyPhase);
+    if (grid.checkCollision(firstPlacement)) {
+        return;
+    }
+
+    GameGrid gridCopy = grid;
+    gridCopy.setCells(firstPlacement);
+    int linesCleared = gridCopy.clearFullRows();
+    gridCopy.getFeatures(); // bring the features up to date once instead of in every copy below
+
+    findPlacements(secondTetrimino, gridCopy, context.secondBoard, context.secondResults);
 
-    for (GraphNode* firstResult : firstResults) {
-        if (grid.checkCollision(firstResult->tetrimino)) {
+    for (Tetrimino secondPlacement : context.secondResults) {
+        if (gridCopy.checkCollision(secondPlacement)) {
             continue;
         }
 
-        GameGrid gridCopy = grid;
-        gridCopy.setCells(firstResult->tetrimino);
-        int linesCleared = static_cast<int>(gridCopy.getFullRows().size());
-        gridCopy.clearFullRows();
+        GameGrid secondGridCopy = gridCopy;
+        secondGridCopy.setCells(secondPlacement);
+        linesCleared += static_cast<int>(gridCopy.getFullRows().size());
+        secondGridCopy.clearFullRows();
 
-        auto secondGraph = makeGraph(secondTetrimino, gridCopy);
-        std::vector<GraphNode*> secondResults = search(secondGraph.get(), secondTetrimino, gridCopy);
-
-        for (GraphNode* secondResult : secondResults) {
-            if (gridCopy.checkCollision(secondResult->tetrimino)) {
-                continue;
-            }
+        analyze(secondGridCopy, firstTetrimino.getHeight() + secondTetrimino.getHeight(), linesCleared, firstResult);
+    }
+}
 
-            GameGrid secondGridCopy = gridCopy;
-            secondGridCopy.setCells(secondResult->tetrimino);
-            linesCleared += static_cast<int>(gridCopy.getFullRows().size());
-            secondGridCopy.clearFullRows();
+// Builds the first tetrimino's graph in context.firstGraph and calls analyze for every board 
+// reachable by placing both tetriminos
+template <typename Func>
+NodeIndex analyzeAllCombinations(Func analyze, SolverContext& context, GameGrid& grid, Tetrimino firstTetrimino, Tetrimino secondTetrimino) {
+    makeGraph(context.firstGraph, firstTetrimino, grid);
+    search(&context.firstGraph, firstTetrimino, grid, context.queue, context.firstResults);
 
-            analyze(secondGridCopy, firstTetrimino.getHeight() + secondTetrimino.getHeight(), linesCleared, firstResult);
-        }
+    for (NodeIndex firstResult : context.firstResults) {
+        Tetrimino firstPlacement = context.firstGraph.getTetrimino(firstResult);
+        analyzeSecondPlacements(analyze, context, grid, firstResult, firstPlacement, firstTetrimino, secondTetrimino);
     }
 
-    return firstResults.at(0); // need a default result in case everything causes collisions with the grid
+    return context.firstResults.at(0); // need a default result in case everything causes collisions with the grid
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include "solver_stats.h"
+
+const char* solverCounterName(SolverCounter counter) {
+    switch (counter) {
+        case graphNodesCounter:
+            return "graphNodes";
+        case neighbourTestsCounter:
+            return "neighbourTests";
+        case collisionChecksCounter:
+            return "collisionChecks";
+        case bfsVisitsCounter:
+            return "bfsVisits";
+        case searchedPlacementsCounter:
+            return "searchedPlacements";
+        case foundPlacementsCounter:
+            return "foundPlacements";
+        default:
+            return "leavesEvaluated";
+    }
+}
+
+int LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < 2 * subBuckets) {
+        return static_cast<int>(value);
+    }
+    int shift = std::bit_width(value) - 5; // keep the top 5 bits, the leading one and 4 bits of sub bucket
+    return (shift + 1) * subBuckets + static_cast<int>((value >> shift) - subBuckets);
+}
+
+uint64_t LatencyHistogram::bucketHighest(int index) {
+    if (index < 2 * subBuckets) {
+        return index;
+    }
+    int shift = index / subBuckets - 1;
+    uint64_t lowest = static_cast<uint64_t>(subBuckets + index % subBuckets) << shift;
+    return lowest + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    this->buckets[bucketIndex(value)]++;
+    this->count++;
+    this->total += value;
+    this->maxValue = std::max(this->maxValue, value);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < bucketCount; i++) {
+        this->buckets[i] += other.buckets[i];
+    }
+    this->count += other.count;
+    this->total += other.total;
+    this->maxValue = std::max(this->maxValue, other.maxValue);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (this->count == 0) {
+        return 0;
+    }
+    uint64_t rank = std::clamp<uint64_t>(static_cast<uint64_t>(std::ceil(p / 100.0 * this->count)), 1, this->count);
+    uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; i++) {
+        seen += this->buckets[i];
+        if (seen >= rank) {
+            return std::min(bucketHighest(i), this->maxValue);
+        }
+    }
+    return this->maxValue;
+}
+
+// Counters of live threads, and what finished threads had counted
+static std::mutex registryMutex;
+static std::vector<ThreadSolverCounters*> liveCounters;
+static SolverCounts finishedCounts{};
+static LatencyHistogram solveHistogram;
+static std::vector<SlowSolve> slowestSolves; // slowest first
+
+thread_local ThreadSolverCounters threadSolverCounters;
+
+ThreadSolverCounters::ThreadSolverCounters() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    liveCounters.push_back(this);
+}
+
+ThreadSolverCounters::~ThreadSolverCounters() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (int i = 0; i < numSolverCounters; i++) {
+        finishedCounts[i] += this->counts[i].load(std::memory_order_relaxed);
+    }
+    liveCounters.erase(std::find(liveCounters.begin(), liveCounters.end(), this));
+}
+
+SolverCounts ThreadSolverCounters::snapshot() const {
+    SolverCounts counts;
+    for (int i = 0; i < numSolverCounters; i++) {
+        counts[i] = this->counts[i].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+SolverStatsReport getSolverStats() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    SolverStatsReport report;
+    report.counters = finishedCounts;
+    for (ThreadSolverCounters* counters : liveCounters) {
+        for (int i = 0; i < numSolverCounters; i++) {
+            report.counters[i] += counters->counts[i].load(std::memory_order_relaxed);
+        }
+    }
+    report.solveNanoseconds = solveHistogram;
+    report.slowestSolves = slowestSolves;
+    return report;
+}
+
+void resetSolverStats() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    finishedCounts.fill(0);
+    for (ThreadSolverCounters* counters : liveCounters) {
+        for (std::atomic<uint64_t>& count : counters->counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+    solveHistogram = LatencyHistogram();
+    slowestSolves.clear();
+}
+
+void recordSolve(uint64_t nanoseconds, const SolverCounts& counters) {
+    std::lock_guard<std::mutex> lock(registryMutex); // once per solve, so not worth a histogram per thread
+    solveHistogram.record(nanoseconds);
+    if (slowestSolves.size() == SolverStatsReport::slowSolveCount and nanoseconds <= slowestSolves.back().nanoseconds) {
+        return;
+    }
+    auto slower = [](const SlowSolve& a, const SlowSolve& b) { return a.nanoseconds > b.nanoseconds; };
+    SlowSolve solve = { .nanoseconds = nanoseconds, .counters = counters };
+    slowestSolves.insert(std::upper_bound(slowestSolves.begin(), slowestSolves.end(), solve, slower), solve);
+    if (slowestSolves.size() > SolverStatsReport::slowSolveCount) {
+        slowestSolves.pop_back();
+    }
+}
+
+static uint64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ScopedSolveTimer::ScopedSolveTimer() : start(nowNanoseconds()), startCounts(threadSolverCounters.snapshot()) {}
+
+ScopedSolveTimer::~ScopedSolveTimer() {
+    uint64_t nanoseconds = nowNanoseconds() - this->start;
+    SolverCounts counts = threadSolverCounters.snapshot();
+    for (int i = 0; i < numSolverCounters; i++) {
+        counts[i] -= this->startCounts[i];
+    }
+    recordSolve(nanoseconds, counts);
+}
+
+void printSolverStats(std::ostream& out, const SolverStatsReport& report) {
+    uint64_t solves = report.solves();
+    const LatencyHistogram& histogram = report.solveNanoseconds;
+    out << "{\"solves\": " << solves << ", \"totals\": {";
+    for (int i = 0; i < numSolverCounters; i++) {
+        out << (i == 0 ? "" : ", ") << "\"" << solverCounterName(static_cast<SolverCounter>(i)) << "\": " << report.counters[i];
+    }
+    out << "}, \"perSolve\": {";
+    for (int i = 0; i < numSolverCounters; i++) {
+        double perSolve = solves > 0 ? static_cast<double>(report.counters[i]) / solves : 0.0;
+        out << (i == 0 ? "" : ", ") << "\"" << solverCounterName(static_cast<SolverCounter>(i)) << "\": " << perSolve;
+    }
+    out << "}, \"solveMicroseconds\": {"
+        << "\"mean\": " << histogram.mean() / 1e3 << ", "
+        << "\"p50\": " << histogram.percentile(50) / 1e3 << ", "
+        << "\"p90\": " << histogram.percentile(90) / 1e3 << ", "
+        << "\"p99\": " << histogram.percentile(99) / 1e3 << ", "
+        << "\"p999\": " << histogram.percentile(99.9) / 1e3 << ", "
+        << "\"max\": " << histogram.getMax() / 1e3 << "}, \"slowestSolves\": [";
+    for (std::size_t s = 0; s < report.slowestSolves.size(); s++) {
+        const SlowSolve& solve = report.slowestSolves[s];
+        out << (s == 0 ? "" : ", ") << "{\"microseconds\": " << solve.nanoseconds / 1e3;
+        for (int i = 0; i < numSolverCounters; i++) {
+            out << ", \"" << solverCounterName(static_cast<SolverCounter>(i)) << "\": " << solve.counters[i];
+        }
+        out << "}";
+    }
+    out << "]}";
+}
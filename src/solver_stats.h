@@ -0,0 +1,132 @@
+#ifndef SOLVER_STATS_H
+#define SOLVER_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/*
+ * Opt-in counters of the work the solvers do, plus a histogram of how long every solve took.
+ * Configure with -DSOLVER_STATS=ON to define TETRIS_SOLVER_STATS. Without it SOLVER_STATS_COUNT and
+ * SOLVER_STATS_TIME_SOLVE expand to nothing, so the hot path is exactly what it was, and the report
+ * stays empty.
+ * Counters are per thread so counting is a plain add to a cache line no other thread writes. They are
+ * summed over every thread, live or finished, when a report is taken.
+ * Solves are timed in EngineSwitch and BeamSearchSolver, which is everything the mains and the
+ * headless runners solve with. Counters count wherever the work happens, whoever asked for it.
+ * The slowest solves are also kept with what was counted on the solving thread while they ran, which
+ * is all of a solve's work when its solver is single threaded as in tetris_sim and the swarm.
+ */
+enum SolverCounter {
+    graphNodesCounter, // setNodeNeighbours calls while building graphs
+    neighbourTestsCounter, // moves tested by setNodeNeighbours, 4 per node
+    collisionChecksCounter, // GameGrid::checkCollision calls, game logic included
+    bfsVisitsCounter, // nodes popped by search
+    searchedPlacementsCounter, // placements found by search, the current tetrimino's
+    foundPlacementsCounter, // placements found by findPlacements: every later ply of every engine, and MCTS rollouts
+    leavesEvaluatedCounter, // boards scored through a SolverContext, transposition table hits included
+    numSolverCounters
+};
+
+const char* solverCounterName(SolverCounter counter);
+
+/*
+ * HDR style histogram of nanoseconds: values under 32 get a bucket each and above that every power
+ * of two is split into 16 buckets, so any value is known to within 1/16 while covering the whole
+ * uint64_t range in under a thousand buckets.
+ */
+class LatencyHistogram {
+    public:
+    static const int subBuckets = 16;
+    static const int bucketCount = 61 * subBuckets;
+
+    private:
+    std::array<uint64_t, bucketCount> buckets{};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t maxValue = 0;
+
+    public:
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketHighest(int index); // largest value that falls in the bucket
+
+    void record(uint64_t value);
+    void merge(const LatencyHistogram& other);
+    // Highest value of the bucket holding the pth percentile (nearest rank), never above the max seen
+    uint64_t percentile(double p) const;
+    uint64_t getCount() const { return this->count; };
+    uint64_t getMax() const { return this->maxValue; };
+    double mean() const { return this->count > 0 ? static_cast<double>(this->total) / this->count : 0.0; };
+};
+
+typedef std::array<uint64_t, numSolverCounters> SolverCounts;
+
+struct SlowSolve {
+    uint64_t nanoseconds = 0;
+    SolverCounts counters{};
+};
+
+struct SolverStatsReport {
+    static const int slowSolveCount = 8;
+
+    SolverCounts counters{};
+    LatencyHistogram solveNanoseconds;
+    std::vector<SlowSolve> slowestSolves; // at most slowSolveCount, slowest first
+
+    uint64_t solves() const { return this->solveNanoseconds.getCount(); };
+};
+
+constexpr bool solverStatsEnabled() {
+#ifdef TETRIS_SOLVER_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+SolverStatsReport getSolverStats();
+void resetSolverStats(); // only while nothing is solving
+// Adds a solve to the histogram, and to the slowest solves if it's one of them
+void recordSolve(uint64_t nanoseconds, const SolverCounts& counters);
+// The report as a JSON object: solves, counter totals, counters per solve, solve time percentiles and
+// the slowest solves
+void printSolverStats(std::ostream& out, const SolverStatsReport& report);
+
+// One thread's counters. Only the owning thread writes them, relaxed atomics let reports read them.
+struct ThreadSolverCounters {
+    std::array<std::atomic<uint64_t>, numSolverCounters> counts{};
+
+    ThreadSolverCounters();
+    ~ThreadSolverCounters(); // adds the counts to the finished threads' totals
+    SolverCounts snapshot() const;
+
+    void add(SolverCounter counter, uint64_t count) {
+        std::atomic<uint64_t>& value = this->counts[counter];
+        value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    };
+};
+
+extern thread_local ThreadSolverCounters threadSolverCounters;
+
+// Times its scope as one solve, and counts what the thread counted meanwhile
+class ScopedSolveTimer {
+    private:
+    uint64_t start;
+    SolverCounts startCounts;
+
+    public:
+    ScopedSolveTimer();
+    ~ScopedSolveTimer();
+};
+
+#ifdef TETRIS_SOLVER_STATS
+#define SOLVER_STATS_COUNT(counter, count) threadSolverCounters.add(counter, count)
+#define SOLVER_STATS_TIME_SOLVE() ScopedSolveTimer solveTimer
+#else
+#define SOLVER_STATS_COUNT(counter, count) ((void)0)
+#define SOLVER_STATS_TIME_SOLVE() ((void)0)
+#endif
+
+#endif
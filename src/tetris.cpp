@@ -1,44 +1,29 @@
+#include <algorithm>
 #include <array>
+#include <bit>
 #include <cstdlib>
-#include <sstream>
-#include <iomanip>
 #include <iso646.h>
 #include <iostream>
 
-#include <raylib.h>
-
 #include "tetris.h"
 #include "constants.h"
+#include "solver_stats.h"
+#include "trace.h"
 
 /***********
  * Tetrimino
  ***********/
 
-Tetrimino::Tetrimino(TetriminoShape shape) {
-    this->shape = shape;
-    this->rotationList = &rotationListMap.at(shape);
-    this->xDelta = 0;
-    this->yDelta = 0;
-    this->rotationStep = 0;
-}
-
-Tetrimino::Tetrimino(TetriminoShape shape, int xDelta, int yDelta, int rotationStep) {
-    this->shape = shape;
-    this->rotationList = &rotationListMap.at(shape);
-    this->xDelta = xDelta;
-    this->yDelta = yDelta;
-    this->rotationStep = rotationStep % this->rotationList->size();
-}
-
-std::vector<Position> Tetrimino::getPositions() {
-    std::vector<Position> positions;
-    for (Position p : this->rotationList->at(this->rotationStep)) {
-        positions.push_back({p.x + this->xDelta, p.y + this->yDelta});
+TetriminoCells Tetrimino::getPositions() const {
+    TetriminoCells positions = rotationTable[this->shape][this->rotationStep];
+    for (Position& p : positions) {
+        p.x += this->xDelta;
+        p.y += this->yDelta;
     }
     return positions;
 }
 
-Tetrimino Tetrimino::move(Direction direction) {
+Tetrimino Tetrimino::move(Direction direction) const {
     if (direction == down) {
         return Tetrimino(this->shape, this->xDelta, this->yDelta + 1, this->rotationStep);
     }
@@ -50,30 +35,35 @@ Tetrimino Tetrimino::move(Direction direction) {
     }
 }
 
-Tetrimino Tetrimino::rotate(Rotation rotation) {
+Tetrimino Tetrimino::rotate(Rotation rotation) const {
+    int rotationCount = this->getRotationCount();
     int rotationStep;
     if (rotation == clockwise) {
-        rotationStep = (this->rotationStep + 1) % this->rotationList->size();
+        rotationStep = (this->rotationStep + 1) % rotationCount;
     }
     else { // rotation == counterClockwise
-        rotationStep = (this->rotationStep - 1) % this->rotationList->size();
+        rotationStep = (this->rotationStep + rotationCount - 1) % rotationCount;
     }
     return Tetrimino(this->shape, this->xDelta, this->yDelta, rotationStep);
 }
 
-SpriteType Tetrimino::getSpriteType() {
-    return spriteTypeMap.at(this->shape);
+int Tetrimino::getRotationCount() const {
+    return rotationCounts[this->shape];
 }
 
-int Tetrimino::getHeight() {
-    int height = 100; // arbitrary big number
-    for (Position p : this->rotationList->at(this->rotationStep)) {
-        // coordinates start in top left but height is considered from the bottom so we subtract
-        if (GRID_HEIGHT - 1 - (p.y + this->yDelta) < height) {
-            height = GRID_HEIGHT - 1 - (p.y + this->yDelta);
-        }
-    }
-    return height;
+SpriteType Tetrimino::getSpriteType() const {
+    return spriteTypeTable[this->shape];
+}
+
+const PieceMask& Tetrimino::getMask() const {
+    return pieceMaskTable[this->shape][this->rotationStep];
+}
+
+int Tetrimino::getHeight() const {
+    // coordinates start in top left but height is considered from the bottom so the lowest cell
+    // of the tetrimino determines its height
+    const PieceMask& mask = this->getMask();
+    return GRID_HEIGHT - 1 - (this->yDelta + mask.minY + mask.height - 1);
 }
 
 bool Tetrimino::operator == (const Tetrimino& tetrimino) const {
@@ -89,50 +79,111 @@ bool Tetrimino::operator == (const Tetrimino& tetrimino) const {
  * GameGrid
  **********/
 
+GameGrid::GameGrid() {
+    for (auto& row : this->spriteTypes) {
+        row.fill(none);
+    }
+}
+
+void GameGrid::setRow(int y, uint16_t row) {
+    uint16_t changed = this->rows[y] ^ row;
+    if (changed == 0) {
+        return;
+    }
+    this->hash ^= zobristRowHash(y, this->rows[y]) ^ zobristRowHash(y, row);
+    this->rows[y] = row;
+    for (uint16_t bits = changed; bits != 0; bits &= bits - 1) {
+        this->columns[std::countr_zero(bits)] ^= uint32_t(1) << y;
+    }
+
+    int transitions = countRowTransitions(row);
+    this->features.rowTransitions += transitions - this->rowTransitions[y];
+    this->rowTransitions[y] = transitions;
+    this->dirtyColumns |= (changed | (changed << 1) | (changed >> 1)) & FULL_ROW_MASK;
+}
+
+void GameGrid::updateColumn(int col) {
+    uint32_t column = this->columns[col];
+    uint32_t left = col == 0 ? WALL_COLUMN : this->columns[col - 1];
+    uint32_t right = col == GRID_WIDTH - 1 ? WALL_COLUMN : this->columns[col + 1];
+    int holes = countColumnHoles(column);
+    int transitions = countColumnTransitions(column);
+    int wellCells = countColumnWellCells(column, left, right);
+
+    this->features.columnHoles += holes - this->columnHoles[col];
+    this->features.columnTransitions += transitions - this->columnTransitions[col];
+    this->features.wellCells += wellCells - this->columnWellCells[col];
+    this->columnHeights[col] = GRID_HEIGHT - columnTop(column);
+    this->columnHoles[col] = holes;
+    this->columnTransitions[col] = transitions;
+    this->columnWellCells[col] = wellCells;
+}
+
+void GameGrid::updateDirtyColumns() {
+    while (this->dirtyColumns != 0) {
+        int col = std::countr_zero(this->dirtyColumns);
+        this->updateColumn(col);
+        this->dirtyColumns &= this->dirtyColumns - 1;
+    }
+}
+
+const BoardFeatures& GameGrid::getFeatures() {
+    this->updateDirtyColumns();
+    return this->features;
+}
+
+int GameGrid::getColumnHeight(int col) {
+    this->updateDirtyColumns();
+    return this->columnHeights[col];
+}
+
 bool GameGrid::isEmpty(Position p) {
-    return this->grid.at(p.y).at(p.x).isEmpty;
+    return not (this->rows[p.y] & (1 << p.x));
 }
 
 bool GameGrid::isEmpty(int x, int y) {
-    return this->grid.at(y).at(x).isEmpty;
+    return not (this->rows[y] & (1 << x));
 }
 
 SpriteType GameGrid::getSpriteType(Position p) {
-    return this->grid[p.y][p.x].spriteType;
+    return this->spriteTypes[p.y][p.x];
 }
 
 void GameGrid::setCells(Tetrimino tetrimino) {
+    SpriteType spriteType = tetrimino.getSpriteType();
     for (Position p : tetrimino.getPositions()) {
         if (p.x >= 0 and p.x < GRID_WIDTH and p.y >= 0 and p.y < GRID_HEIGHT) {
-            this->grid.at(p.y).at(p.x) = GridCell(tetrimino.getSpriteType(), false);
+            this->setRow(p.y, this->rows[p.y] | (1 << p.x));
+            this->spriteTypes[p.y][p.x] = spriteType;
         }
     }
 }
 
 void GameGrid::setCell(Position position, SpriteType spriteType) {
-    this->grid.at(position.y).at(position.x) = GridCell(spriteType, false);
+    this->setRow(position.y, this->rows.at(position.y) | (1 << position.x));
+    this->spriteTypes.at(position.y).at(position.x) = spriteType;
 }
 
 void GameGrid::clearCell(Position p) {
-    this->grid[p.y][p.x] = GridCell(none, true);
+    this->setRow(p.y, this->rows[p.y] & ~(1 << p.x));
+    this->spriteTypes[p.y][p.x] = none;
 }
 
 bool GameGrid::checkCollision(const Tetrimino& tetrimino) {
-    int x = 0;
-    int y = 0;
-
-    // TODO make an iterator
-    for (Position p : (*tetrimino.rotationList)[tetrimino.rotationStep]) {
-        x = p.x + tetrimino.xDelta;
-        y = p.y + tetrimino.yDelta;
+    SOLVER_STATS_COUNT(collisionChecksCounter, 1);
+    const PieceMask& mask = tetrimino.getMask();
+    int left = tetrimino.xDelta + mask.minX;
+    int top = tetrimino.yDelta + mask.minY;
 
-        if (x < 0 or x >= GRID_WIDTH) {
-            return true;
-        }
-        if (y >= GRID_HEIGHT) {
-            return true;
-        }
-        if (y >= 0 and !this->grid[y][x].isEmpty) {
+    if (left < 0 or tetrimino.xDelta + mask.maxX >= GRID_WIDTH) {
+        return true;
+    }
+    if (top + mask.height > GRID_HEIGHT) {
+        return true;
+    }
+    for (int i = 0; i < mask.height; i++) {
+        // rows above the grid are open so a tetrimino can spawn partially outside of it
+        if (top + i >= 0 and (this->rows[top + i] & (mask.rows[i] << left))) {
             return true;
         }
     }
@@ -141,31 +192,54 @@ bool GameGrid::checkCollision(const Tetrimino& tetrimino) {
 
 std::vector<int> GameGrid::getFullRows() {
     std::vector<int> fullRows;
-    int currentRow = 0;
-    for (auto row : this->grid) {
-        bool foundEmptyCell = false;
-        for (auto cell : row) {
-            foundEmptyCell = foundEmptyCell or cell.isEmpty;
-        }
-        if (not foundEmptyCell) {
-            fullRows.push_back(currentRow);
+    for (int row = 0; row < GRID_HEIGHT; row++) {
+        if (this->rows[row] == FULL_ROW_MASK) {
+            fullRows.push_back(row);
         }
-        currentRow++;
     }
     return fullRows;
 }
 
-void GameGrid::clearRows(std::vector<int> row_indices) {
+void GameGrid::clearRows(const std::vector<int>& row_indices) {
+    std::array<bool, GRID_HEIGHT> isCleared{};
     for (int i : row_indices) {
-        for (int r = i - 1; r >= 0; r--) { // shift each row above i down
-            this->grid[r+1] = this->grid[r];
+        isCleared[i] = true;
+    }
+
+    // compact the remaining rows towards the bottom of the grid then empty whatever is left at the top
+    int target = GRID_HEIGHT - 1;
+    for (int row = GRID_HEIGHT - 1; row >= 0; row--) {
+        if (not isCleared[row]) {
+            this->setRow(target, this->rows[row]);
+            this->spriteTypes[target] = this->spriteTypes[row];
+            target--;
         }
     }
-    this->grid[0] = std::array<GridCell, GRID_WIDTH>(); // at least one row has been cleared so the first row must contain nothing
+    for (; target >= 0; target--) {
+        this->setRow(target, 0);
+        this->spriteTypes[target].fill(none);
+    }
 }
 
-void GameGrid::clearFullRows() {
-    this->clearRows(this->getFullRows());
+int GameGrid::clearFullRows() {
+    // same compaction as clearRows but without building a list of row indices since the solver
+    // calls this for every board it evaluates
+    int target = GRID_HEIGHT - 1;
+    for (int row = GRID_HEIGHT - 1; row >= 0; row--) {
+        if (this->rows[row] != FULL_ROW_MASK) {
+            if (target != row) {
+                this->setRow(target, this->rows[row]);
+                this->spriteTypes[target] = this->spriteTypes[row];
+            }
+            target--;
+        }
+    }
+    int rowsCleared = target + 1;
+    for (; target >= 0; target--) {
+        this->setRow(target, 0);
+        this->spriteTypes[target].fill(none);
+    }
+    return rowsCleared;
 }
 
 void GameGrid::print() {
@@ -174,20 +248,20 @@ void GameGrid::print() {
     std::string green = "\033[32m";
     std::string yellow = "\033[33m";
 
-    for (const auto& row : this->grid) {
+    for (int row = 0; row < GRID_HEIGHT; row++) {
         std::cout << "|";
 
-        for (const auto& cell : row) {
+        for (int col = 0; col < GRID_WIDTH; col++) {
             std::string color = "";
-            if (cell.spriteType == first) {
+            if (this->spriteTypes[row][col] == first) {
                 color = red;
-            } else if (cell.spriteType == second) {
+            } else if (this->spriteTypes[row][col] == second) {
                 color = green;
             } else {
                 color = yellow;
             }
 
-            if (cell.isEmpty) {
+            if (this->isEmpty(col, row)) {
                 std::cout << " ";
             } 
             else {
@@ -207,24 +281,35 @@ void GameGrid::print() {
  * GameState
  ***********/
 
-GameState::GameState() {
-    this->currentTetrimino = Tetrimino(static_cast<TetriminoShape>(rand() % numTetriminoShapes)); 
-    this->currentTetrimino.xDelta = SPAWN_X_DELTA;
+GameState::GameState(int previewLength, uint64_t seed) : GameState(previewLength, Xoshiro256(seed)) {}
 
-    this->nextTetrimino = Tetrimino(static_cast<TetriminoShape>(rand() % numTetriminoShapes));
-    this->nextTetrimino.xDelta = SPAWN_X_DELTA;
+GameState::GameState(int previewLength, Xoshiro256 rng) : rng(rng) {
+    this->currentTetrimino = this->randomTetrimino();
+    for (int i = 0; i < std::max(previewLength, 1); i++) { // there is always a next tetrimino
+        this->previewTetriminos.push_back(this->randomTetrimino());
+    }
+}
+
+Tetrimino GameState::randomTetrimino() {
+    Tetrimino tetrimino(static_cast<TetriminoShape>(this->rng.below(numTetriminoShapes)));
+    tetrimino.xDelta = SPAWN_X_DELTA;
+    return tetrimino;
 }
 
 GameGrid GameState::getGrid() { return this->grid; }
 Tetrimino GameState::getCurrentTetrimino() { return this->currentTetrimino; }
-Tetrimino GameState::getNextTetrimino() { return this->nextTetrimino; }
+Tetrimino GameState::getNextTetrimino() { return this->previewTetriminos.front(); }
+std::vector<Tetrimino> GameState::getPreviewTetriminos() {
+    return std::vector<Tetrimino>(this->previewTetriminos.begin(), this->previewTetriminos.end());
+}
 bool GameState::isCurrentTetrominoPlaced() { return this->isCurrentTetriminoPlaced; }
 
 void GameState::initNewTetrimino() { 
-    this->currentTetrimino = this->nextTetrimino;
+    TRACE_SCOPE("initNewTetrimino");
+    this->currentTetrimino = this->previewTetriminos.front();
+    this->previewTetriminos.pop_front();
 
-    this->nextTetrimino = Tetrimino(static_cast<TetriminoShape>(rand() % numTetriminoShapes)); 
-    this->nextTetrimino.xDelta = SPAWN_X_DELTA;
+    this->previewTetriminos.push_back(this->randomTetrimino());
     this->isCurrentTetriminoPlaced = false;
 
     if (this->grid.checkCollision(this->currentTetrimino)) {
@@ -255,9 +340,7 @@ void GameState::moveTetrimino(Direction direction) {
     if (direction == down) {
         Tetrimino tmpTetrimino = this->currentTetrimino.move(down);
         if (this->grid.checkCollision(tmpTetrimino)) {
-            for (auto p : this->currentTetrimino.getPositions()) {
-                this->grid.setCells(this->currentTetrimino);
-            }
+            this->grid.setCells(this->currentTetrimino);
             this->isCurrentTetriminoPlaced = true;
             this->linesToClear = this->grid.getFullRows();
         }
@@ -307,180 +390,3 @@ void GameState::clearFullLines() {
     this->lineClearStep = 0;
     this->linesToClear.clear();
 }
-
-Sprites::Sprites() {
-    for (auto colors : levelColors) {
-        std::vector<Texture2D> spriteList;
-        spriteList.push_back(this->generateSprite(0, colors.at(0)));
-        spriteList.push_back(this->generateSprite(1, colors.at(0)));
-        spriteList.push_back(this->generateSprite(1, colors.at(1)));
-        this->sprites.push_back(spriteList);
-    }
-}
-
-Texture2D Sprites::generateSprite(int pixelLayoutIndex, Color color) {
-    std::vector<Color> imageData;
-    Texture2D sprite;
-    Image image;
-    for (int pixel : spritePixelLayouts.at(pixelLayoutIndex)) {
-            if (pixel) {
-                imageData.push_back(color);
-            }
-            else {
-                imageData.push_back(WHITE);
-            }
-        }
-    image = {
-        .data = imageData.data(),
-        .width = sprite_width,
-        .height = sprite_height,
-        .mipmaps = 1,
-        .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
-    };
-    sprite = LoadTextureFromImage(image);
-    return sprite;
-}
-
-Texture2D Sprites::getSprite(SpriteType spriteType, int level) {
-    return this->sprites.at((level) % this->sprites.size()).at(spriteType);
-}
-
-FrameDrawer::FrameDrawer() {
-    this->font = LoadFontEx("resources/CommitMonoNerdFont-Regular.otf", 16, NULL, 0);
-    SetTextureFilter(this->font.texture, TEXTURE_FILTER_BILINEAR);
-}
-
-int FrameDrawer::getHorizontalOffset(Tetrimino tetrimino) {
-    int ret = 10; // arbitrary large number
-    for (auto pos : tetrimino.rotationList->at(tetrimino.rotationStep)) {
-        if (pos.x < ret) {
-            ret = pos.x;
-        }
-    }
-    return -ret;
-}
-
-void FrameDrawer::drawCurrentTetrimino(GameState& state) {
-    if (not state.isCurrentTetrominoPlaced()) {
-        Tetrimino tetrimino = state.getCurrentTetrimino();
-        SpriteType spriteType = tetrimino.getSpriteType();
-        Texture2D sprite = this->sprites.getSprite(spriteType, state.level);
-        for (auto gridPos : tetrimino.getPositions()) {
-            float x = static_cast<float>((gridPos.x * BLOCK_SIZE) + (gridPos.x * GAP_SIZE) + GAP_SIZE);
-            float y = static_cast<float>((BLOCK_SIZE * gridPos.y) + (gridPos.y * GAP_SIZE) + GAP_SIZE);
-            DrawTexturePro(
-                sprite,
-                { 0.0f, 0.0f, (float)sprite.width, (float)sprite.height },
-                { x, y, (float)BLOCK_SIZE, (float)BLOCK_SIZE},
-                { 0.0f, 0.0f },
-                0.0f,
-                WHITE
-            );
-        }
-    }
-}
-
-void FrameDrawer::drawGridCells(GameState& state) {
-    GameGrid grid = state.getGrid();
-    for (int gridX = 0; gridX < GRID_WIDTH; gridX++) {
-        for (int gridY = 0; gridY < GRID_HEIGHT; gridY++) {
-            Position gridPos(gridX, gridY);
-
-            if (!grid.isEmpty(gridPos)) {
-                Texture2D sprite = this->sprites.getSprite(
-                    grid.getSpriteType(gridPos), state.level);
-                float x = static_cast<float>((gridPos.x * BLOCK_SIZE) + (gridPos.x * GAP_SIZE) + GAP_SIZE);
-                float y = static_cast<float>((BLOCK_SIZE * gridPos.y) + (gridPos.y * GAP_SIZE) + GAP_SIZE);
-
-                DrawTexturePro(
-                    sprite,
-                    { 0.0f, 0.0f, (float)sprite.width, (float)sprite.height },
-                    { x, y, (float)BLOCK_SIZE, (float)BLOCK_SIZE},
-                    { 0.0f, 0.0f },
-                    0.0f,
-                    WHITE
-                );
-            }
-        }
-    }
-}
-
-void FrameDrawer::drawSideBar(GameState& state) {
-    float yStart = 10;
-
-    DrawLine(GRID_FRAME_WIDTH, 0, GRID_FRAME_WIDTH, GRID_FRAME_HEIGHT, WHITE);
-
-    // draw level in side bar
-    DrawTextEx(this->font, "Level:", {GRID_FRAME_WIDTH + 10, yStart}, 16, 0, WHITE);
-    std::stringstream ss1;
-    ss1 << std::setfill('0') << std::setw(4) << state.level;
-    DrawTextEx(this->font, ss1.str().c_str(), {GRID_FRAME_WIDTH + 10, yStart + 16} , 16, 0, WHITE);
-
-    yStart += 44;
-
-    // draw number of line clears in side bar
-    DrawTextEx(this->font, "Lines:", {GRID_FRAME_WIDTH + 10, yStart}, 16, 0, WHITE);
-    std::stringstream ss2;
-    ss2 << std::setfill('0') << std::setw(4) << state.linesCleared;
-    DrawTextEx(this->font, ss2.str().c_str(), {GRID_FRAME_WIDTH + 10, yStart + 16} , 16, 0, WHITE);
-
-    yStart += 44;
-
-    // draw next tetrimino in side bar
-    DrawTextEx(this->font, "Next:", {GRID_FRAME_WIDTH + 10, yStart}, 16, 0, WHITE);
-    Tetrimino tetrimino = state.getNextTetrimino();
-    SpriteType spriteType = spriteTypeMap.at(tetrimino.shape);
-    Texture2D sprite = this->sprites.getSprite(spriteType, state.level);
-    auto positions = rotationListMap.at(tetrimino.shape)[0];
-    int xAdjust = this->getHorizontalOffset(tetrimino);
-    for (auto pos : positions) {
-        float x = static_cast<float>(GRID_FRAME_WIDTH + 10 + ((pos.x + xAdjust) * BLOCK_SIZE) + ((pos.x + xAdjust) * GAP_SIZE));
-        float y = static_cast<float>(yStart + 20 + (BLOCK_SIZE * pos.y) + (pos.y * GAP_SIZE));
-        DrawTexturePro(
-            sprite,
-            { 0.0f, 0.0f, (float)sprite.width, (float)sprite.height },
-            { x, y, (float)BLOCK_SIZE, (float)BLOCK_SIZE},
-            { 0.0f, 0.0f },
-            0.0f,
-            WHITE
-        );
-    }
-}
-
-void FrameDrawer::drawGameOver(int level) {
-    Color color1 = levelColors.at((level) % levelColors.size()).at(0);
-    Color color2 = levelColors.at((level) % levelColors.size()).at(1);
-
-    for (int i = 0; i < this->gameOverStep; i++) {
-        int y1 = (i * BLOCK_SIZE) + (i * GAP_SIZE);
-        int y2 = y1 + 3;
-        int y3 = y1 + BLOCK_SIZE - 3;
-        int y4 = y3 + GAP_SIZE;
-
-        DrawRectangle(0, y1, GRID_FRAME_WIDTH, 3, color1);
-        DrawRectangle(0, y2, GRID_FRAME_WIDTH, BLOCK_SIZE - 6, WHITE);
-        DrawRectangle(0, y3, GRID_FRAME_WIDTH, 3, color2);
-        DrawRectangle(0, y4, GRID_FRAME_WIDTH, 3, BLACK);
-    }
-}
-
-void FrameDrawer::drawFrame(GameState& state, bool drawCurrentTetrimino) {
-    BeginDrawing();
-        ClearBackground(BLACK);
-        if (drawCurrentTetrimino) {
-            this->drawCurrentTetrimino(state);
-        }
-        this->drawGridCells(state);
-        this->drawSideBar(state);
-
-        if (state.gameOver) {
-            this->drawGameOver(state.level);
-        }
-    EndDrawing();
-}
-
-void FrameDrawer::nextGameOverStep() {
-    if (this->gameOverStep < GRID_HEIGHT) {
-        this->gameOverStep++;
-    }
-}
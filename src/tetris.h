@@ -2,49 +2,62 @@
 #define TETRIS_H
 
 #include <array>
+#include <cstdint>
+#include <deque>
 #include <map>
+#include <type_traits>
 #include <vector>
+#include "board_features.h"
 #include "constants.h"
-#include "raylib.h"
+#include "xoshiro.h"
 
 class Position {
     public:
-    int x;
-    int y;
-    Position(int _x, int _y): x(_x), y(_y) {}
+    int x = 0;
+    int y = 0;
+    constexpr Position() = default;
+    constexpr Position(int _x, int _y): x(_x), y(_y) {}
 };
 
 enum Rotation { clockwise, counterClockwise };
 enum Direction { down, right, left };
 
-/// used as a key to map a tetromino shape to data that relates to it. N is used as a null shape
-enum TetriminoShape { I, J, L, O, S, T, Z, N };
+/// used as an index into the per-shape tables below. N is used as a null shape
+enum TetriminoShape : uint8_t { I, J, L, O, S, T, Z, N };
 const int numTetriminoShapes = 6; // exludes the N shape because it's null and not an actual shape
 
 /// There are three sprite variants for each level
-/// A GridCell instance stores a spriteType instead of the sprite itself.
+/// GameGrid stores a spriteType for each cell instead of the sprite itself.
 /// A Tetromino instance can return its associated SpriteType.
 /// The SpriteType value is used as an index when selecting a sprite for 
 /// a given level. 
-/// The none value is used for empty GridCells and is never passed to the 
+/// The none value is used for empty grid cells and is never passed to the 
 /// Sprites class for retrieving a sprite.
-enum SpriteType { first = 0, second = 1, third = 2, none = 4 };
+enum SpriteType : uint8_t { first = 0, second = 1, third = 2, none = 4 };
 
-/// Each tetrimino shape is associated with a SpriteType
+/// Each tetrimino shape is associated with a SpriteType, indexed by TetriminoShape
 /// the Tetromino class uses this when its getSpriteType() is called
-const std::map<TetriminoShape,SpriteType> spriteTypeMap = { 
-    {T, first}, 
-    {J, second}, 
-    {Z, third}, 
-    {O, first}, 
-    {S, second}, 
-    {L, third}, 
-    {I, first}
-}; 
+constexpr std::array<SpriteType, N> spriteTypeTable = {
+    first,  // I
+    second, // J
+    third,  // L
+    first,  // O
+    second, // S
+    first,  // T
+    third   // Z
+};
+
+/// Number of distinct orientations of each shape, indexed by TetriminoShape.
+/// Only the first rotationCounts[shape] entries of a shape's rotationTable are used. Orientations
+/// that only repeat another one's cells (all of O's, the second pair of I, S and Z) are left out, so
+/// no two placements the solver finds cover the same cells and none of them gets expanded twice.
+constexpr std::array<int, N> rotationCounts = { 2, 4, 4, 1, 2, 4, 2 };
+
+typedef std::array<Position, 4> TetriminoCells;
 
 /// The first item of each rotation list is the initial orientation for a newly spawned tetrimino of
 /// that shape. The next list of positions for a shape are the positions of the tetrimino if it were
-/// rotated clockwise.
+/// rotated clockwise. Indexed by [shape][rotationStep].
 ///
 /// For example:
 /// The first item in the rotation list for tetrimino shape T looks like
@@ -54,42 +67,83 @@ const std::map<TetriminoShape,SpriteType> spriteTypeMap = {
 ///   0
 ///  00
 ///   0
-inline std::map<TetriminoShape, std::vector<std::vector<Position>>> rotationListMap = {
-    { T, { 
-        {{-1,0}, {0,0}, {1,0}, {0,1}},
-        {{0,-1}, {-1,0}, {0,0}, {0,1}},
-        {{0,-1}, {-1,0}, {0,0}, {1,0}},
-        {{0,-1}, {0,0}, {1,0}, {0,1}}
-    }},
-    { I, {
-        {{-2,0}, {-1,0}, {0,0}, {1,0}},
-        {{0,-2}, {0,-1}, {0,0}, {0,1}}
-    }},
-    { O, {
-        {{-1,0}, {0,0}, {-1,1}, {0,1}}
-    }},
-    {J, {
-        {{-1,0}, {0,0}, {1,0}, {1,1}},
-        {{0,-1}, {0,0}, {-1,1}, {0,1}},
-        {{-1,-1}, {-1,0}, {0,0}, {1,0}},
-        {{0,-1}, {1,-1}, {0,0}, {0,1}}
-    }},
-    {L, {
-        {{-1,0}, {0,0}, {1,0}, {-1,1}},
-        {{-1,-1}, {0,-1}, {0,0}, {0,1}},
-        {{1,-1}, {-1,0}, {0,0}, {1,0}},
-        {{0,-1}, {0,0}, {0,1}, {1,1}}
-    }},
-    {S, {
-        {{0,0}, {1,0}, {-1,1}, {0,1}},
-        {{0,-1}, {0,0}, {1,0}, {1,1}}
-    }},
-    {Z, {
-        {{-1,0}, {0,0}, {0,1}, {1,1}},
-        {{1,-1}, {0,0}, {1,0}, {0,1}}
-    }}
+constexpr std::array<std::array<TetriminoCells, 4>, N> rotationTable = {{
+    { { // I
+        {{{-2,0}, {-1,0}, {0,0}, {1,0}}},
+        {{{0,-2}, {0,-1}, {0,0}, {0,1}}}
+    } },
+    { { // J
+        {{{-1,0}, {0,0}, {1,0}, {1,1}}},
+        {{{0,-1}, {0,0}, {-1,1}, {0,1}}},
+        {{{-1,-1}, {-1,0}, {0,0}, {1,0}}},
+        {{{0,-1}, {1,-1}, {0,0}, {0,1}}}
+    } },
+    { { // L
+        {{{-1,0}, {0,0}, {1,0}, {-1,1}}},
+        {{{-1,-1}, {0,-1}, {0,0}, {0,1}}},
+        {{{1,-1}, {-1,0}, {0,0}, {1,0}}},
+        {{{0,-1}, {0,0}, {0,1}, {1,1}}}
+    } },
+    { { // O
+        {{{-1,0}, {0,0}, {-1,1}, {0,1}}}
+    } },
+    { { // S
+        {{{0,0}, {1,0}, {-1,1}, {0,1}}},
+        {{{0,-1}, {0,0}, {1,0}, {1,1}}}
+    } },
+    { { // T
+        {{{-1,0}, {0,0}, {1,0}, {0,1}}},
+        {{{0,-1}, {-1,0}, {0,0}, {0,1}}},
+        {{{0,-1}, {-1,0}, {0,0}, {1,0}}},
+        {{{0,-1}, {0,0}, {1,0}, {0,1}}}
+    } },
+    { { // Z
+        {{{-1,0}, {0,0}, {0,1}, {1,1}}},
+        {{{1,-1}, {0,0}, {1,0}, {0,1}}}
+    } }
+}};
+
+/// The cells of one rotation of a tetrimino shape stored as row bitmasks so that collisions can
+/// be checked a whole row at a time.
+/// Bit i of rows[k] is set when the cell at (minX + i, minY + k), relative to the tetrimino's
+/// origin, is part of the tetrimino.
+struct PieceMask {
+    int minX = 0;
+    int maxX = 0;
+    int minY = 0;
+    int height = 0;
+    std::array<uint16_t, 4> rows{};
 };
 
+constexpr PieceMask makePieceMask(const TetriminoCells& cells) {
+    PieceMask mask;
+    mask.minX = mask.maxX = cells[0].x;
+    mask.minY = cells[0].y;
+    int maxY = mask.minY;
+    for (Position p : cells) {
+        mask.minX = p.x < mask.minX ? p.x : mask.minX;
+        mask.maxX = p.x > mask.maxX ? p.x : mask.maxX;
+        mask.minY = p.y < mask.minY ? p.y : mask.minY;
+        maxY = p.y > maxY ? p.y : maxY;
+    }
+    mask.height = maxY - mask.minY + 1;
+    for (Position p : cells) {
+        mask.rows[p.y - mask.minY] |= static_cast<uint16_t>(1 << (p.x - mask.minX));
+    }
+    return mask;
+}
+
+/// Row bitmasks for every entry of rotationTable, indexed by [shape][rotationStep].
+constexpr std::array<std::array<PieceMask, 4>, N> pieceMaskTable = [] {
+    std::array<std::array<PieceMask, 4>, N> masks{};
+    for (int shape = 0; shape < N; shape++) {
+        for (int rotation = 0; rotation < rotationCounts[shape]; rotation++) {
+            masks[shape][rotation] = makePieceMask(rotationTable[shape][rotation]);
+        }
+    }
+    return masks;
+}();
+
 const std::map<int, int> levelSpeedMap = {
     {0, 48},
     {1, 43},
@@ -109,81 +163,103 @@ const std::map<int, int> levelSpeedMap = {
     {19, 2}, {20, 2}, {21, 2}, {22, 2}, {23, 2}, {24, 2}, {25, 2}, {26, 2}, {27, 2}, {28, 2}, {29, 2}
 };
 
-/// used by the Sprites class when generating sprites.
-/// each level has two colors.
-const std::vector<std::vector<Color>> levelColors = {
-    { BLUE, SKYBLUE },
-    { LIME, GREEN },
-    { {216,0,204,255},  {248,120,248,255} },
-    { {0,88,248,255},   {0,184,0,255} },
-    { {228,0,88,255},   {88,248,152,255} },
-    { {88,248,152,255}, {104,136,252,255} },
-    { {248,56,0,255},   {124,124,124,255} },
-    { {104,68,252,255}, {168,0,32,255} },
-    { {0,88,248,255},   {248,56,0,255} },
-    { {248,56,0,255},   {252,160,68,255} },
-};
+/// Zobrist keys used by GameGrid to hash its occupancy. Every cell has a random 64 bit key and a
+/// board's hash is the XOR of the keys of its filled cells. To hash a whole row with two lookups the
+/// keys are pre-combined for each half of the row: zobristRowKeys[y][h][bits] is the XOR of the
+/// keys of the cells set in bits, where bits covers columns 0-4 when h is 0 and 5-9 when h is 1.
+constexpr uint64_t splitMix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
 
-/// The flat lists of integers are used by the Sprites class when generating sprites.
-/// 1 means to color the sprite using levelColors.
-/// 0 means to color the pixel white.
-const int sprite_width = 5;
-const int sprite_height = 5;
-const std::vector<int> spritePixelLayout1 = {
-    0, 1, 1, 1, 1,
-    1, 0, 0, 0, 1,
-    1, 0, 0, 0, 1,
-    1, 0, 0, 0, 1,
-    1, 1, 1, 1, 1
-};
-const std::vector<int> spritePixelLayout2 = {
-    0, 1, 1, 1, 1,
-    1, 0, 0, 1, 1, 
-    1, 0, 1, 1, 1,
-    1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1
-};
-const std::vector<std::vector<int>> spritePixelLayouts = { spritePixelLayout1, spritePixelLayout2 };
+const int ZOBRIST_HALF_WIDTH = GRID_WIDTH / 2;
 
-/// When a tetromino is locked into place it is stored as GridCells in the State class.
-/// The game starts with a board of empty GridCells.
-class GridCell {
-    public:
-    SpriteType spriteType;
-    bool isEmpty;
-    GridCell() : spriteType(none), isEmpty(true) {};
-    GridCell(SpriteType _spriteType, bool _isEmpty): spriteType(_spriteType), isEmpty(_isEmpty) {}
-};
+constexpr std::array<std::array<std::array<uint64_t, 1 << ZOBRIST_HALF_WIDTH>, 2>, GRID_HEIGHT> zobristRowKeys = [] {
+    std::array<std::array<std::array<uint64_t, 1 << ZOBRIST_HALF_WIDTH>, 2>, GRID_HEIGHT> keys{};
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        for (int half = 0; half < 2; half++) {
+            for (int bits = 0; bits < (1 << ZOBRIST_HALF_WIDTH); bits++) {
+                for (int i = 0; i < ZOBRIST_HALF_WIDTH; i++) {
+                    if (bits & (1 << i)) {
+                        int x = half * ZOBRIST_HALF_WIDTH + i;
+                        keys[y][half][bits] ^= splitMix64(static_cast<uint64_t>(y * GRID_WIDTH + x));
+                    }
+                }
+            }
+        }
+    }
+    return keys;
+}();
+
+constexpr uint64_t zobristRowHash(int y, uint16_t row) {
+    return zobristRowKeys[y][0][row & ((1 << ZOBRIST_HALF_WIDTH) - 1)] ^ zobristRowKeys[y][1][row >> ZOBRIST_HALF_WIDTH];
+}
 
 /// A collection of Positions that can be translated or rotated.
 /// When a Tetrimino is moved or rotated a new Tetrimino object is created
 /// instead of mutating the original. This makes it easier to test a change 
-/// for a collision before commiting to it
+/// for a collision before commiting to it.
+/// The solver copies tetriminos constantly so this is kept to a 4 byte value. The cells it covers
+/// are looked up in rotationTable instead of being stored.
 class Tetrimino {
     public:
-    std::vector<std::vector<Position>>* rotationList;
-    int xDelta;
-    int yDelta;
-    int rotationStep;
     TetriminoShape shape;
+    int8_t xDelta;
+    int8_t yDelta;
+    int8_t rotationStep;
 
     public:
-    Tetrimino() : rotationList(nullptr), xDelta(0), yDelta(0), rotationStep(0), shape(N) {};
-    Tetrimino(TetriminoShape shape);
-    Tetrimino(TetriminoShape shape, int xDelta, int yDelta, int rotationStep);
-    std::vector<Position> getPositions();
-    Tetrimino move(Direction direction);
-    Tetrimino rotate(Rotation rotation);
-    SpriteType getSpriteType();
-    int getHeight();
+    constexpr Tetrimino() : shape(N), xDelta(0), yDelta(0), rotationStep(0) {};
+    constexpr Tetrimino(TetriminoShape shape) : shape(shape), xDelta(0), yDelta(0), rotationStep(0) {};
+    constexpr Tetrimino(TetriminoShape shape, int xDelta, int yDelta, int rotationStep) :
+        shape(shape),
+        xDelta(static_cast<int8_t>(xDelta)),
+        yDelta(static_cast<int8_t>(yDelta)),
+        rotationStep(static_cast<int8_t>(rotationStep % rotationCounts[shape])) {};
+    TetriminoCells getPositions() const;
+    Tetrimino move(Direction direction) const;
+    Tetrimino rotate(Rotation rotation) const;
+    int getRotationCount() const;
+    SpriteType getSpriteType() const;
+    int getHeight() const;
+    const PieceMask& getMask() const;
     bool operator == (const Tetrimino& tetrimino) const;
 };
 
+static_assert(sizeof(Tetrimino) == 4);
+static_assert(std::is_trivially_copyable_v<Tetrimino>);
+
+/// When a tetromino is locked into place it is stored in the GameGrid.
+/// Occupancy is stored as one bitmask per row (bit x set means column x is filled) because that is
+/// all the solver needs. Sprite types are kept in a separate array that is only read when drawing.
 class GameGrid {
     private:
-    std::array<std::array<GridCell, GRID_WIDTH>, GRID_HEIGHT> grid{}; // first dimension is row, second dimension is column
+    std::array<uint16_t, GRID_HEIGHT> rows{};
+    std::array<uint32_t, GRID_WIDTH> columns{}; // rows transposed, bit y is row y, for the column feature kernels
+    std::array<std::array<SpriteType, GRID_WIDTH>, GRID_HEIGHT> spriteTypes{}; // first dimension is row, second dimension is column
+    uint64_t hash = 0; // zobrist hash of the occupied cells, kept up to date by every change to rows
+
+    // Board features kept up to date as rows change so evaluating a board doesn't rescan it.
+    // Row transitions are updated with the row. Columns that changed, and their neighbours since 
+    // wells depend on them, are marked in dirtyColumns and recomputed the next time features are read.
+    // Like computeEvaluationFactors, the column features ignore row 0.
+    std::array<int8_t, GRID_WIDTH> columnHeights{}; // counted from the floor to the highest filled cell below row 0
+    std::array<int8_t, GRID_WIDTH> columnHoles{};
+    std::array<int8_t, GRID_WIDTH> columnTransitions{};
+    std::array<int8_t, GRID_WIDTH> columnWellCells{};
+    std::array<int8_t, GRID_HEIGHT> rowTransitions{};
+    BoardFeatures features; // sums of the arrays above
+    uint16_t dirtyColumns = 0;
+
+    private:
+    void setRow(int y, uint16_t row);
+    void updateColumn(int col);
+    void updateDirtyColumns();
 
     public:
+    GameGrid();
     bool isEmpty(Position p);
     bool isEmpty(int x, int y);
     SpriteType getSpriteType(Position p); 
@@ -191,9 +267,13 @@ class GameGrid {
     void setCell(Position position, SpriteType spriteType);
     void clearCell(Position p);
     bool checkCollision(const Tetrimino& tetrimino);
+    uint16_t getRow(int y) const { return this->rows[y]; }; // occupancy bitmask, bit x is column x
+    uint64_t getHash() const { return this->hash; };
+    const BoardFeatures& getFeatures();
+    int getColumnHeight(int col);
     std::vector<int> getFullRows();
-    void clearRows(std::vector<int> row_indexes);
-    void clearFullRows();
+    void clearRows(const std::vector<int>& row_indexes);
+    int clearFullRows(); // returns the number of rows cleared
     void print();
 };
 
@@ -202,18 +282,25 @@ class GameState {
     * - grid: keeps track of the fallen tetrominos that can no longer be moved. This usually does not 
     * include the current tetromino.
     * - currentTetrimino: the falling tetrimino being controlled by the player
+    * - previewTetriminos: the tetriminos that will spawn after the current one, in order. The front is 
+    * the next tetrimino. Its length is set when the GameState is constructed and never changes.
     * - isCurrentTetriminoPlaced: Flag keeps track of if the current tetromino has been placed in the grid. 
     * The flag is set by moveTetrimino member function when the current tetrimino can no longer move
     * down and is placed in the grid.the flag is unset when initNewTetrimino is called.
     * - linesToClear: used for animating line clears. Grid indices of rows being cleared
     * - lineClearStep: current step in the row clear animation
+    * - rng: draws every tetrimino. Games built with the same seed get the same tetriminos
     */
     public:
     Tetrimino currentTetrimino = Tetrimino(T); // replaced with random tetrimino in constructor
-    Tetrimino nextTetrimino = Tetrimino(T); // replaced wtih random tetrimino in constructor
+    std::deque<Tetrimino> previewTetriminos; // filled with random tetriminos in constructor
     bool isCurrentTetriminoPlaced = false;
     std::vector<int> linesToClear;
     int lineClearStep = 0; 
+    Xoshiro256 rng;
+
+    private:
+    Tetrimino randomTetrimino(); // spawned from a uniformly chosen shape
 
     public:
     GameGrid grid;
@@ -224,10 +311,12 @@ class GameState {
     int AISpeed = 1;
 
     public:
-    GameState();
+    GameState(int previewLength = 1, uint64_t seed = 0);
+    GameState(int previewLength, Xoshiro256 rng); // e.g. a jumped generator for one of several parallel games
     GameGrid getGrid();
     Tetrimino getCurrentTetrimino();
     Tetrimino getNextTetrimino();
+    std::vector<Tetrimino> getPreviewTetriminos();
     bool isCurrentTetrominoPlaced();
     void initNewTetrimino();
     int fallSpeed();
@@ -261,35 +350,4 @@ class GameState {
 };
 
 
-class Sprites {
-    private:
-    std::vector<std::vector<Texture2D>> sprites;
-
-    private:
-    Texture2D generateSprite(int pixelLayoutIndex, Color colour);
-
-    public:
-    Sprites();
-    Texture2D getSprite(SpriteType spriteType, int level);
-};
-
-class FrameDrawer {
-    private:
-    Font font;
-    Sprites sprites;
-    int gameOverStep = 0;
-
-    private:
-    int getHorizontalOffset(Tetrimino tetrimino);
-    void drawCurrentTetrimino(GameState& state);
-    void drawGridCells(GameState& state);
-    void drawSideBar(GameState& state);
-    void drawGameOver(int level);
-
-    public:
-    FrameDrawer(); 
-    void drawFrame(GameState& state, bool drawCurrentTetrimino = true);
-    void nextGameOverStep();
-};
-
 #endif
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "engine_switch.h"
+#include "replay.h"
+#include "simulation.h"
+
+// Usage: tetris_replay FILE [--seek N] [--verify] [--rerun]
+// Opens a replay saved by tetris_sim --replays and prints a JSON report of it to stdout.
+// --seek rebuilds the board after N pieces from the nearest keyframe. --verify replays every
+// placement and checks the boards against the keyframes' rolling hashes. --rerun plays the game
+// again from its seed with the current solver and reports how many placements still match, which
+// is the first piece a solver change plays differently. MCTS games are only rerun when their solves
+// were limited by iterations, a time limited search not playing the same twice; one limited by both
+// reruns alike as long as no solve ran out of time. Exits with 1 when a check fails or the game
+// can't be rerun.
+static void printUsage() {
+    std::cerr << "usage: tetris_replay FILE [--seek N] [--verify] [--rerun]" << std::endl;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    std::string path = argv[1];
+    long long seekPiece = -1;
+    bool verify = false;
+    bool rerun = false;
+    for (int i = 2; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--verify") {
+            verify = true;
+        }
+        else if (option == "--rerun") {
+            rerun = true;
+        }
+        else if (option == "--seek" and i + 1 < argc) {
+            seekPiece = std::max(0LL, std::atoll(argv[++i]));
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Replay replay;
+    if (not replay.open(path)) {
+        std::cerr << "couldn't open " << path << " as a replay" << std::endl;
+        return 1;
+    }
+    double openMilliseconds = millisecondsSince(start);
+    const ReplayHeader& header = replay.getHeader();
+    bool failed = false;
+
+    std::cout << "{\n"
+        << "  \"seed\": " << header.seed << ",\n"
+        << "  \"stream\": " << header.stream << ",\n"
+        << "  \"engine\": \"" << solverEngineName(static_cast<SolverEngine>(header.engine)) << "\",\n"
+        << "  \"pieces\": " << header.pieces << ",\n"
+        << "  \"linesCleared\": " << header.linesCleared << ",\n"
+        << "  \"toppedOut\": " << (header.toppedOut ? "true" : "false") << ",\n"
+        << "  \"bytes\": " << replay.getSize() << ",\n"
+        << "  \"placementBytesPerPiece\": " << (header.pieces > 0 ? static_cast<double>(header.placementsBytes) / header.pieces : 0.0) << ",\n"
+        << "  \"keyframes\": " << header.keyframeCount << ",\n"
+        << "  \"openMilliseconds\": " << openMilliseconds;
+
+    if (seekPiece >= 0) {
+        start = std::chrono::steady_clock::now();
+        ReplayPosition position;
+        bool found = replay.seek(static_cast<uint64_t>(seekPiece), position);
+        double seekMilliseconds = millisecondsSince(start);
+        std::cout << ",\n  \"seek\": ";
+        if (found) {
+            std::cout << "{\"piece\": " << position.piece << ", \"milliseconds\": " << seekMilliseconds
+                << ", \"linesCleared\": " << position.linesCleared << ", \"rollingHash\": " << position.rollingHash << "}";
+        }
+        else {
+            std::cout << "{\"piece\": " << seekPiece << ", \"error\": \"past the end or unreadable\"}";
+            failed = true;
+        }
+    }
+
+    if (verify) {
+        start = std::chrono::steady_clock::now();
+        uint64_t divergence = 0;
+        bool verified = replay.verify(divergence);
+        std::cout << ",\n  \"verify\": {\"ok\": " << (verified ? "true" : "false");
+        if (not verified) {
+            std::cout << ", \"divergence\": " << divergence;
+        }
+        std::cout << ", \"milliseconds\": " << millisecondsSince(start) << "}";
+        failed = failed or not verified;
+    }
+
+    bool timeLimited = static_cast<SolverEngine>(header.engine) == mctsEngine and header.mctsSettings.maxIterations == 0;
+    if (rerun and timeLimited) {
+        std::cout << ",\n  \"rerun\": {\"error\": \"MCTS limited by time doesn't play the same twice\"}";
+        failed = true;
+    }
+    else if (rerun) {
+        SimulationSettings settings;
+        settings.seed = header.seed;
+        settings.pieceCap = static_cast<int>(header.pieceCap);
+        settings.threadCount = 1;
+        settings.engine = static_cast<SolverEngine>(header.engine);
+        settings.mctsSettings = header.mctsSettings;
+        settings.weights = header.weights;
+        EngineSwitch solver;
+        solver.engine = settings.engine;
+        solver.mctsSettings = settings.mctsSettings;
+        solver.threadCount = 1;
+        solver.transpositionTableBytes = settings.transpositionTableBytes;
+
+        start = std::chrono::steady_clock::now();
+        ReplayWriter writer(settings, static_cast<int>(header.stream), static_cast<int>(header.keyframeInterval));
+        std::vector<double> solveMicroseconds;
+        int stream = static_cast<int>(header.stream);
+        playGame(solver, settings, stream, streamGenerator(settings.seed, stream), solveMicroseconds, &writer);
+        Replay replayed;
+        replayed.load(writer.toBytes());
+        uint64_t matching = matchingPlacements(replay, replayed);
+        bool diverged = matching != header.pieces or replayed.getHeader().pieces != header.pieces;
+        std::cout << ",\n  \"rerun\": {\"pieces\": " << replayed.getHeader().pieces << ", \"matchingPlacements\": " << matching
+            << ", \"diverged\": " << (diverged ? "true" : "false") << ", \"seconds\": " << millisecondsSince(start) / 1e3 << "}";
+        failed = failed or diverged;
+    }
+    std::cout << "\n}" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+#include "engine_switch.h"
+#include "parse_number.h"
+#include "perf_counters.h"
+#include "simulation.h"
+#include "solver_stats.h"
+#include "trace.h"
+
+// Usage: tetris_sim [--games N] [--seed S] [--pieces P] [--threads T] [--engine two-ply|expectimax|mcts]
+//                   [--weights linesCleared,lockHeight,wellCells,columnHoles,columnTransitions,rowTransitions]
+//                   [--mcts-budget ms] [--mcts-iterations N] [--garbage N] [--per-game] [--perf]
+//                   [--replays DIR]
+// Plays N games without a window, game i drawing its tetriminos from the generator seeded with S and
+// jumped i times, and prints a JSON report to stdout.
+// pieces is the piece cap per game, 0 for no cap. solvesPerSecond is every thread's solves divided by
+// the wall clock time, solvesPerSecondPerThread is solves divided by the time spent solving.
+// --per-game adds every game's result to the report. --perf adds hardware counters per piece and
+// per solver phase, or why there are none, when built with -DPERF_COUNTERS=ON.
+// --garbage raises a garbage row with one hole after every N pieces, to compare how engines survive
+// a board that keeps climbing. --replays saves every game to DIR/game<stream>.replay for
+// tetris_replay, and can't be combined with --garbage.
+static void printUsage() {
+    std::cerr << "usage: tetris_sim [--games N] [--seed S] [--pieces P] [--threads T] [--engine two-ply|expectimax|mcts] "
+        << "[--weights w1,w2,w3,w4,w5,w6] [--mcts-budget ms] [--mcts-iterations N] [--garbage N] [--per-game] [--perf] [--replays DIR]" << std::endl;
+}
+
+static bool parseWeights(const std::string& text, EvaluationWeights& weights) {
+    std::vector<double> values;
+    std::stringstream stream(text);
+    std::string value;
+    while (std::getline(stream, value, ',')) {
+        char* end = nullptr;
+        values.push_back(std::strtod(value.c_str(), &end));
+        if (end == value.c_str() or *end != '\0') {
+            return false;
+        }
+    }
+    if (values.size() != 6) {
+        return false;
+    }
+    weights = {
+        .totalLinesCleared = values[0],
+        .totalLockHeight = values[1],
+        .totalWellCells = values[2],
+        .totalColumnHoles = values[3],
+        .totalColumnTransitions = values[4],
+        .totalRowTransitions = values[5]
+    };
+    return true;
+}
+
+
+int main(int argc, char** argv) {
+    SimulationSettings settings;
+    settings.weights = {
+        .totalLinesCleared = 1.0,
+        .totalLockHeight = 12.885008263218383,
+        .totalWellCells = 15.842707182438396,
+        .totalColumnHoles = 26.894496507795950,
+        .totalColumnTransitions = 27.616914062397015,
+        .totalRowTransitions = 30.185110719279040
+    };
+    bool perGame = false;
+    bool perf = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--per-game") {
+            perGame = true;
+            continue;
+        }
+        if (option == "--perf") {
+            perf = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 1;
+        }
+        std::string value = argv[++i];
+        int milliseconds = 0;
+        if (option == "--games" and parseNumber(value, 0, settings.games)) {
+            continue;
+        }
+        else if (option == "--seed" and parseNumber(value, uint64_t(0), settings.seed)) {
+            continue;
+        }
+        else if (option == "--pieces" and parseNumber(value, 0, settings.pieceCap)) {
+            continue;
+        }
+        else if (option == "--threads" and parseNumber(value, 1, settings.threadCount)) {
+            continue;
+        }
+        else if (option == "--mcts-budget" and parseNumber(value, 1, milliseconds)) {
+            settings.mctsSettings.moveBudget = std::chrono::milliseconds(milliseconds);
+        }
+        else if (option == "--replays") {
+            settings.replayDirectory = value;
+        }
+        else if (option == "--garbage" and parseNumber(value, 0, settings.garbageInterval)) {
+            continue;
+        }
+        else if (option == "--mcts-iterations" and parseNumber(value, 0, settings.mctsSettings.maxIterations)) {
+            continue;
+        }
+        else if (option == "--engine" and parseSolverEngine(value, settings.engine)) {
+            continue;
+        }
+        else if (option == "--weights" and parseWeights(value, settings.weights)) {
+            continue;
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (settings.garbageInterval > 0 and not settings.replayDirectory.empty()) {
+        std::cerr << "replays can't record garbage rows, use --replays or --garbage" << std::endl;
+        return 1;
+    }
+
+    if (perf) {
+        startPerfPhases();
+    }
+    bool tracing = startTracingFromEnvironment(); // TETRIS_TRACE=trace.json to see every thread's solves
+    SimulationReport report = runSimulation(settings);
+    if (tracing and not writeTrace()) {
+        std::cerr << "couldn't write the trace" << std::endl;
+    }
+
+    long pieces = report.totalPieces();
+    int solves = static_cast<int>(report.solveMicroseconds.size());
+    double meanSolve = solves > 0 ? report.solveSeconds() * 1e6 / solves : 0.0;
+    double meanLines = 0.0;
+    int minLines = report.games.empty() ? 0 : report.games[0].linesCleared;
+    int maxLines = minLines;
+    int topOuts = 0;
+    for (const GameResult& game : report.games) {
+        meanLines += game.linesCleared;
+        minLines = std::min(minLines, game.linesCleared);
+        maxLines = std::max(maxLines, game.linesCleared);
+        topOuts += game.toppedOut ? 1 : 0;
+    }
+    meanLines = report.games.empty() ? 0.0 : meanLines / report.games.size();
+
+    const EvaluationWeights& weights = settings.weights;
+    std::cout.precision(17);
+    std::cout << "{\n"
+        << "  \"engine\": \"" << solverEngineName(settings.engine) << "\",\n"
+        << "  \"games\": " << report.games.size() << ",\n"
+        << "  \"seed\": " << settings.seed << ",\n"
+        << "  \"pieceCap\": " << settings.pieceCap << ",\n"
+        << "  \"garbageInterval\": " << settings.garbageInterval << ",\n"
+        << "  \"threads\": " << settings.threadCount << ",\n"
+        << "  \"weights\": [" << weights.totalLinesCleared << ", " << weights.totalLockHeight << ", "
+            << weights.totalWellCells << ", " << weights.totalColumnHoles << ", "
+            << weights.totalColumnTransitions << ", " << weights.totalRowTransitions << "],\n";
+    std::cout.precision(6);
+    std::cout
+        << "  \"seconds\": " << report.seconds << ",\n"
+        << "  \"pieces\": " << pieces << ",\n"
+        << "  \"piecesPerSecond\": " << (report.seconds > 0 ? pieces / report.seconds : 0.0) << ",\n"
+        << "  \"solves\": " << solves << ",\n"
+        << "  \"solvesPerSecond\": " << (report.seconds > 0 ? solves / report.seconds : 0.0) << ",\n"
+        << "  \"solvesPerSecondPerThread\": " << (meanSolve > 0 ? 1e6 / meanSolve : 0.0) << ",\n"
+        << "  \"solveMicroseconds\": {"
+            << "\"mean\": " << meanSolve << ", "
+            << "\"p50\": " << percentile(report.solveMicroseconds, 50) << ", "
+            << "\"p90\": " << percentile(report.solveMicroseconds, 90) << ", "
+            << "\"p99\": " << percentile(report.solveMicroseconds, 99) << ", "
+            << "\"p999\": " << percentile(report.solveMicroseconds, 99.9) << ", "
+            << "\"max\": " << percentile(report.solveMicroseconds, 100) << "},\n"
+        << "  \"linesCleared\": {\"mean\": " << meanLines << ", \"min\": " << minLines << ", \"max\": " << maxLines << "},\n"
+        << "  \"linesClearedPerGame\": [";
+    for (std::size_t i = 0; i < report.games.size(); i++) {
+        std::cout << (i == 0 ? "" : ", ") << report.games[i].linesCleared;
+    }
+    std::cout << "],\n"
+        << "  \"topOuts\": " << topOuts;
+    if (solverStatsEnabled()) { // built with -DSOLVER_STATS=ON
+        std::cout << ",\n  \"solverStats\": ";
+        printSolverStats(std::cout, getSolverStats());
+    }
+    if (perf) {
+        std::cout << ",\n  \"perfCounters\": ";
+        if (perfCountersCompiledIn()) {
+            printPerfReport(std::cout, getPerfReport(), pieces);
+        }
+        else {
+            std::cout << "{\"available\": false, \"error\": \"configure with -DPERF_COUNTERS=ON\"}";
+        }
+    }
+    if (perGame) {
+        std::cout << ",\n  \"perGame\": [";
+        for (std::size_t i = 0; i < report.games.size(); i++) {
+            const GameResult& game = report.games[i];
+            std::cout << (i == 0 ? "\n" : ",\n")
+                << "    {\"stream\": " << game.stream << ", \"pieces\": " << game.pieces
+                << ", \"linesCleared\": " << game.linesCleared
+                << ", \"toppedOut\": " << (game.toppedOut ? "true" : "false") << "}";
+        }
+        std::cout << "\n  ]";
+    }
+    std::cout << "\n}" << std::endl;
+
+    int unsaved = 0;
+    for (const GameResult& game : report.games) {
+        unsaved += settings.replayDirectory.empty() or game.replaySaved ? 0 : 1;
+    }
+    if (unsaved > 0) {
+        std::cerr << "couldn't save " << unsaved << " replays to " << settings.replayDirectory << std::endl;
+        return 1;
+    }
+    return 0;
+}
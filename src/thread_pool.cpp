@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <thread>
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int threadCount) {
+    for (int worker = 1; worker < threadCount; worker++) {
+        this->threads.emplace_back(&ThreadPool::workerLoop, this, worker);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wakeWorkers.notify_all();
+    for (std::thread& thread : this->threads) {
+        thread.join();
+    }
+}
+
+int ThreadPool::defaultThreadCount() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void ThreadPool::dispatch(int taskCount, TaskCall taskCall, void* func) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->taskCall = taskCall;
+        this->func = func;
+        this->taskCount = taskCount;
+        this->nextTask = 0;
+        this->busyWorkers = static_cast<int>(this->threads.size());
+        this->jobGeneration++;
+    }
+    this->wakeWorkers.notify_all();
+
+    this->runTasks(0);
+
+    // func lives on the caller's stack so every worker has to be done with it before returning
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->jobFinished.wait(lock, [this] { return this->busyWorkers == 0; });
+}
+
+void ThreadPool::workerLoop(int worker) {
+    uint64_t lastJobGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wakeWorkers.wait(lock, [this, lastJobGeneration] { 
+                return this->stopping or this->jobGeneration != lastJobGeneration; 
+            });
+            if (this->stopping) {
+                return;
+            }
+            lastJobGeneration = this->jobGeneration;
+        }
+
+        this->runTasks(worker);
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->busyWorkers--;
+        if (this->busyWorkers == 0) {
+            this->jobFinished.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runTasks(int worker) {
+    for (int task = this->nextTask++; task < this->taskCount; task = this->nextTask++) {
+        this->taskCall(this->func, task, worker);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A fixed set of threads that stay alive between jobs so that a job can be handed out every solve
+ * without paying for thread creation.
+ * A job is a number of tasks and a function called as func(task, worker) once per task. Workers
+ * take the next unclaimed task until there are none left. The calling thread takes part as worker 0,
+ * so a pool of size 1 runs everything on the caller and worker is always less than size().
+ * Callers can keep per-worker scratch space indexed by worker since a worker runs one task at a time.
+ */
+class ThreadPool {
+    private:
+    typedef void (*TaskCall)(void* func, int task, int worker);
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable jobFinished;
+    uint64_t jobGeneration = 0; // bumped for every job so sleeping workers can tell a new one started
+    int busyWorkers = 0;
+    bool stopping = false;
+
+    TaskCall taskCall = nullptr;
+    void* func = nullptr;
+    int taskCount = 0;
+    std::atomic<int> nextTask{0};
+
+    private:
+    void workerLoop(int worker);
+    void runTasks(int worker);
+    void dispatch(int taskCount, TaskCall taskCall, void* func);
+
+    public:
+    explicit ThreadPool(int threadCount = defaultThreadCount());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(this->threads.size()) + 1; };
+    static int defaultThreadCount();
+
+    // Blocks until func has been called for every task in [0, taskCount)
+    template <typename Func>
+    void run(int taskCount, Func& func) {
+        auto taskCall = [](void* func, int task, int worker) { (*static_cast<Func*>(func))(task, worker); };
+        this->dispatch(taskCount, taskCall, &func);
+    };
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "trace.h"
+
+std::atomic<bool> tracingEnabled{false};
+
+// Buffers of every thread that traced since tracing started, including threads that have exited
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static std::atomic<uint64_t> traceEpoch{0}; // bumped on start so threads know their buffer is stale
+static std::chrono::steady_clock::time_point traceStart;
+static std::string tracePath;
+
+struct ThreadTraceBuffer {
+    TraceBuffer* buffer = nullptr;
+    uint64_t epoch = 0;
+};
+static thread_local ThreadTraceBuffer threadBuffer;
+
+void startTracing(const std::string& path) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    tracingEnabled.store(false);
+    buffers.clear();
+    tracePath = path;
+    traceStart = std::chrono::steady_clock::now();
+    traceEpoch.fetch_add(1);
+    tracingEnabled.store(true);
+}
+
+bool startTracingFromEnvironment() {
+#ifdef TETRIS_TRACE
+    const char* path = std::getenv("TETRIS_TRACE");
+    if (path == nullptr or *path == '\0') {
+        return false;
+    }
+    startTracing(path);
+    return true;
+#else
+    return false; // nothing would be recorded
+#endif
+}
+
+void stopTracing() {
+    tracingEnabled.store(false);
+}
+
+uint64_t traceClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+}
+
+TraceBuffer& threadTraceBuffer() {
+    uint64_t epoch = traceEpoch.load(std::memory_order_acquire);
+    if (threadBuffer.buffer == nullptr or threadBuffer.epoch != epoch) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers.push_back(std::make_unique<TraceBuffer>());
+        buffers.back()->threadId = static_cast<int>(buffers.size()) - 1;
+        threadBuffer.buffer = buffers.back().get();
+        threadBuffer.epoch = epoch;
+    }
+    return *threadBuffer.buffer;
+}
+
+bool writeTrace() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (tracePath.empty()) {
+        return false;
+    }
+    std::ofstream out(tracePath);
+    char timestamps[64];
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    uint64_t dropped = 0;
+    for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+        out << (first ? "\n" : ",\n")
+            << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->threadId
+            << ", \"args\": {\"name\": \"thread " << buffer->threadId << "\"}}";
+        first = false;
+
+        uint64_t pushed = buffer->pushed.load(std::memory_order_acquire);
+        for (uint64_t i = buffer->dropped(); i < pushed; i++) { // oldest first
+            const TraceEvent& event = buffer->events[i % TraceBuffer::capacity];
+            // microseconds with nanosecond decimals, as the format expects
+            std::snprintf(timestamps, sizeof(timestamps), "\"ts\": %.3f, \"dur\": %.3f", event.start / 1e3, event.duration / 1e3);
+            out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->threadId
+                << ", " << timestamps << "}";
+        }
+        dropped += buffer->dropped();
+    }
+    out << "\n], \"otherData\": {\"droppedEvents\": " << dropped << "}}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,85 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/*
+ * Scoped timeline markers written out as Chrome trace event JSON, which chrome://tracing and
+ * ui.perfetto.dev open directly.
+ * Configure with -DTRACE=ON to define TETRIS_TRACE; without it TRACE_SCOPE expands to nothing. When
+ * compiled in, markers cost one relaxed load until tracing is started, e.g. by running a main with
+ * TETRIS_TRACE=trace.json in the environment.
+ * Every thread appends its events to its own buffer, so recording takes no lock: the thread is the
+ * only writer and publishes each event by bumping the buffer's count with a release store. Buffers
+ * are rings, so once one is full each event overwrites its oldest and the trace of a long run ends
+ * with its last capacity events per thread, the overwritten ones counted as dropped. Buffers
+ * outlive their threads so writeTrace gets pool workers that have already finished.
+ */
+struct TraceEvent {
+    const char* name; // a string literal, only the pointer is kept
+    uint64_t start; // nanoseconds since tracing started
+    uint64_t duration;
+};
+
+struct TraceBuffer {
+    static constexpr uint32_t capacity = 1 << 16;
+
+    int threadId = 0; // in the order threads first traced something
+    std::unique_ptr<TraceEvent[]> events = std::make_unique<TraceEvent[]>(capacity);
+    std::atomic<uint64_t> pushed{0}; // event i is at events[i % capacity] until overwritten
+
+    void push(const TraceEvent& event) {
+        uint64_t index = this->pushed.load(std::memory_order_relaxed);
+        this->events[index % capacity] = event;
+        this->pushed.store(index + 1, std::memory_order_release);
+    };
+    uint64_t size() const { return std::min<uint64_t>(this->pushed.load(std::memory_order_acquire), capacity); };
+    uint64_t dropped() const { return this->pushed.load(std::memory_order_acquire) - this->size(); };
+};
+
+extern std::atomic<bool> tracingEnabled;
+
+// Clears earlier events, the trace goes to path. Call when no traced code is running.
+void startTracing(const std::string& path);
+bool startTracingFromEnvironment(); // starts if built with TETRIS_TRACE and TETRIS_TRACE names a file
+// Writes everything recorded since tracing started as {"traceEvents": [...]}. Call when no traced
+// code is running. False if there was no trace or the file couldn't be written.
+bool writeTrace();
+void stopTracing();
+uint64_t traceClock(); // nanoseconds since tracing started
+TraceBuffer& threadTraceBuffer();
+
+class TraceScope {
+    private:
+    const char* name;
+    uint64_t start = 0;
+    bool active;
+
+    public:
+    explicit TraceScope(const char* name) : name(name), active(tracingEnabled.load(std::memory_order_relaxed)) {
+        if (this->active) {
+            this->start = traceClock();
+        }
+    };
+    ~TraceScope() {
+        if (this->active) {
+            threadTraceBuffer().push({ this->name, this->start, traceClock() - this->start });
+        }
+    };
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator = (const TraceScope&) = delete;
+};
+
+#ifdef TETRIS_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include "solver.h"
+#include "transposition_table.h"
+
+// each factor gets 15 bits which is far more than a 10x20 board can produce
+static const int FACTOR_BITS = 15;
+static const uint64_t FACTOR_MASK = (uint64_t(1) << FACTOR_BITS) - 1;
+static const uint64_t VALID_BIT = uint64_t(1) << 63; // set in every stored entry so empty entries never match
+
+static uint64_t packFactors(const EvaluationFactors& factors) {
+    return (
+        VALID_BIT |
+        (static_cast<uint64_t>(factors.totalWellCells) & FACTOR_MASK) |
+        (static_cast<uint64_t>(factors.totalColumnHoles) & FACTOR_MASK) << FACTOR_BITS |
+        (static_cast<uint64_t>(factors.totalColumnTransistions) & FACTOR_MASK) << (FACTOR_BITS * 2) |
+        (static_cast<uint64_t>(factors.totalRowTransitions) & FACTOR_MASK) << (FACTOR_BITS * 3)
+    );
+}
+
+static void unpackFactors(uint64_t data, EvaluationFactors& factors) {
+    factors.totalWellCells = static_cast<int>(data & FACTOR_MASK);
+    factors.totalColumnHoles = static_cast<int>((data >> FACTOR_BITS) & FACTOR_MASK);
+    factors.totalColumnTransistions = static_cast<int>((data >> (FACTOR_BITS * 2)) & FACTOR_MASK);
+    factors.totalRowTransitions = static_cast<int>((data >> (FACTOR_BITS * 3)) & FACTOR_MASK);
+}
+
+TranspositionTable::TranspositionTable(std::size_t bytes) {
+    this->entryCount = std::bit_floor(std::max<std::size_t>(bytes / sizeof(Entry), 1));
+    this->entries = std::make_unique<Entry[]>(this->entryCount);
+}
+
+bool TranspositionTable::probe(uint64_t key, EvaluationFactors& factors, TranspositionCounters& counters) const {
+    const Entry& entry = this->entries[key & (this->entryCount - 1)];
+    uint64_t data = entry.data.load(std::memory_order_relaxed);
+    uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+    if (data != 0 and (check ^ data) == key) {
+        unpackFactors(data, factors);
+        counters.hits++;
+        return true;
+    }
+    counters.misses++;
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, const EvaluationFactors& factors, TranspositionCounters& counters) {
+    Entry& entry = this->entries[key & (this->entryCount - 1)];
+    uint64_t oldData = entry.data.load(std::memory_order_relaxed);
+    if (oldData != 0 and (entry.check.load(std::memory_order_relaxed) ^ oldData) != key) {
+        counters.replacements++;
+    }
+
+    uint64_t data = packFactors(factors);
+    entry.data.store(data, std::memory_order_relaxed);
+    entry.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear() {
+    for (std::size_t i = 0; i < this->entryCount; i++) {
+        this->entries[i].data.store(0, std::memory_order_relaxed);
+        this->entries[i].check.store(0, std::memory_order_relaxed);
+    }
+    this->hits = 0;
+    this->misses = 0;
+    this->replacements = 0;
+}
+
+void TranspositionTable::addCounters(const TranspositionCounters& counters) {
+    this->hits.fetch_add(counters.hits, std::memory_order_relaxed);
+    this->misses.fetch_add(counters.misses, std::memory_order_relaxed);
+    this->replacements.fetch_add(counters.replacements, std::memory_order_relaxed);
+}
+
+TranspositionCounters TranspositionTable::getCounters() const {
+    return {
+        .hits = this->hits.load(std::memory_order_relaxed),
+        .misses = this->misses.load(std::memory_order_relaxed),
+        .replacements = this->replacements.load(std::memory_order_relaxed),
+    };
+}
@@ -0,0 +1,56 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+struct EvaluationFactors;
+
+struct TranspositionCounters {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t replacements = 0; // stores that overwrote a different board
+};
+
+/*
+ * Fixed size cache of the board dependent EvaluationFactors (wells, holes and transitions) keyed by 
+ * GameGrid::getHash(). Lines cleared and lock height depend on how a board was reached, not on 
+ * the board, so they aren't stored.
+ *
+ * Safe to share between threads without locks. Each entry is two 64 bit words, the packed factors
+ * and the key XORed with them. A probe only trusts an entry when XORing the words gives back its key,
+ * so an entry torn by two threads writing at once reads as a miss instead of wrong factors.
+ * New entries always replace old ones.
+ *
+ * Counters are gathered by callers in a TranspositionCounters of their own and added with 
+ * addCounters now and then so threads don't fight over shared counters on every probe.
+ */
+class TranspositionTable {
+    private:
+    struct Entry {
+        std::atomic<uint64_t> check{0}; // key ^ data
+        std::atomic<uint64_t> data{0}; // packed factors, 0 when empty
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    std::size_t entryCount;
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> replacements{0};
+
+    public:
+    // bytes is rounded down to a power of two number of entries, with at least one entry
+    explicit TranspositionTable(std::size_t bytes = 16 << 20);
+
+    bool probe(uint64_t key, EvaluationFactors& factors, TranspositionCounters& counters) const;
+    void store(uint64_t key, const EvaluationFactors& factors, TranspositionCounters& counters);
+    void clear();
+
+    std::size_t sizeInBytes() const { return this->entryCount * sizeof(Entry); };
+    void addCounters(const TranspositionCounters& counters);
+    TranspositionCounters getCounters() const;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef XOSHIRO_H
+#define XOSHIRO_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/*
+ * xoshiro256** generator (Blackman and Vigna). Each GameState owns one, so games don't share the
+ * global rand() state and replay exactly from their seed.
+ * The seed is expanded into the 256 bit state with splitmix64, as recommended by the authors.
+ * jump() advances the generator by 2^128 outputs and longJump() by 2^192, so generators made from
+ * one seed by jumping a different number of times give streams that never overlap, one per
+ * parallel game.
+ * Satisfies UniformRandomBitGenerator so it also works with the <random> distributions.
+ */
+class Xoshiro256 {
+    private:
+    std::array<uint64_t, 4> state;
+
+    private:
+    static constexpr uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    constexpr void jumpBy(const std::array<uint64_t, 4>& polynomial) {
+        std::array<uint64_t, 4> jumped{};
+        for (uint64_t word : polynomial) {
+            for (int bit = 0; bit < 64; bit++) {
+                if (word & (uint64_t(1) << bit)) {
+                    for (int i = 0; i < 4; i++) {
+                        jumped[i] ^= this->state[i];
+                    }
+                }
+                (*this)();
+            }
+        }
+        this->state = jumped;
+    }
+
+    public:
+    typedef uint64_t result_type;
+
+    explicit constexpr Xoshiro256(uint64_t seed = 0) : state{} {
+        for (uint64_t& word : this->state) { // splitmix64
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    // Uses the state as given, which must not be all zeros
+    explicit constexpr Xoshiro256(const std::array<uint64_t, 4>& state) : state(state) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+
+    constexpr result_type operator()() {
+        uint64_t result = rotl(this->state[1] * 5, 7) * 9;
+        uint64_t t = this->state[1] << 17;
+        this->state[2] ^= this->state[0];
+        this->state[3] ^= this->state[1];
+        this->state[1] ^= this->state[2];
+        this->state[0] ^= this->state[3];
+        this->state[2] ^= t;
+        this->state[3] = rotl(this->state[3], 45);
+        return result;
+    }
+
+    // A number in [0, bound) from the top 32 bits by multiply and shift, which is cheaper than %
+    // and biased by less than bound / 2^32
+    constexpr uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>(((*this)() >> 32) * bound >> 32);
+    }
+
+    constexpr void jump() {
+        this->jumpBy({ 0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull });
+    }
+
+    constexpr void longJump() {
+        this->jumpBy({ 0x76e15d3efefdcbbfull, 0xc5004e441c522fb3ull, 0x77710069854ee241ull, 0x39109bb02acbe635ull });
+    }
+
+    const std::array<uint64_t, 4>& getState() const { return this->state; };
+    bool operator == (const Xoshiro256& other) const { return this->state == other.state; };
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include <random>
+#include <gtest/gtest.h>
+#include "batch_evaluator.h"
+#include "solver.h"
+#include "test_helpers.h"
+
+TEST(BatchEvaluatorTest, EveryInstructionSetMatchesComputeFitness) {
+    std::mt19937 rng(3);
+    // small ranges so many leaves tie and the tie breaking gets checked too
+    std::uniform_int_distribution<int> randomFactor(0, 3);
+    LeafBatch leaves;
+
+    for (int size = 0; size < 300; size++) {
+        leaves.clear();
+        int expectedIndex = -1;
+        double expectedFitness = -1.0;
+        for (int i = 0; i < size; i++) {
+            EvaluationFactors factors;
+            factors.totalLinesCleared = randomFactor(rng);
+            factors.totalLockHeight = randomFactor(rng);
+            factors.totalWellCells = randomFactor(rng);
+            factors.totalColumnHoles = randomFactor(rng);
+            factors.totalColumnTransistions = randomFactor(rng);
+            factors.totalRowTransitions = randomFactor(rng);
+            leaves.push(factors, static_cast<uint16_t>(i));
+
+            double fitness = computeFitness(factors, weights);
+            if (expectedIndex < 0 or fitness < expectedFitness) {
+                expectedIndex = i;
+                expectedFitness = fitness;
+            }
+        }
+
+        for (BatchInstructionSet instructionSet : { scalarInstructions, sse2Instructions, avx2Instructions }) {
+            LeafScore best = findBestLeaf(leaves, weights, instructionSet);
+            ASSERT_EQ(best.index, expectedIndex) << "size " << size << " instruction set " << instructionSet;
+            ASSERT_EQ(best.fitness, expectedFitness);
+        }
+    }
+}
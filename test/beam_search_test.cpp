@@ -0,0 +1,84 @@
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "tetris.h"
+#include "solver.h"
+#include "beam_search.h"
+#include "test_helpers.h"
+
+TEST(GameStateTest, PreviewQueueAdvancesOnNewTetrimino) {
+    GameState state(3);
+    ASSERT_EQ(state.getPreviewTetriminos().size(), 3);
+    std::vector<Tetrimino> preview = state.getPreviewTetriminos();
+    EXPECT_EQ(state.getNextTetrimino(), preview[0]);
+
+    state.initNewTetrimino();
+    EXPECT_EQ(state.getCurrentTetrimino(), preview[0]);
+    EXPECT_EQ(state.getPreviewTetriminos()[0], preview[1]);
+    EXPECT_EQ(state.getPreviewTetriminos()[1], preview[2]);
+    EXPECT_EQ(state.getPreviewTetriminos().size(), 3);
+}
+
+// With a beam wide enough to keep every board, beam search is an exhaustive search using the same
+// scoring, so it has to agree with trying every pair of placements
+TEST(BeamSearchTest, WideBeamMatchesExhaustiveSearch) {
+    std::mt19937 rng(7);
+    BeamSearchSolver solver({ .depth = 2, .beamWidth = 100000 });
+
+    for (int i = 0; i < 20; i++) {
+        GameGrid grid = makeRaggedGrid(rng);
+        std::vector<Tetrimino> tetriminos = {
+            Tetrimino(static_cast<TetriminoShape>(i % N), SPAWN_X_DELTA, 0, 0),
+            Tetrimino(static_cast<TetriminoShape>((i * 3 + 1) % N), SPAWN_X_DELTA, 0, 0)
+        };
+        int totalLockHeight = tetriminos[0].getHeight() + tetriminos[1].getHeight();
+
+        auto graph = makeGraph(tetriminos[0], grid);
+        std::vector<NodeIndex> firstResults = search(graph.get(), tetriminos[0], grid);
+        double bestFitness = -1.0;
+        Tetrimino expected;
+        for (NodeIndex firstResult : firstResults) {
+            GameGrid firstGrid = grid;
+            firstGrid.setCells(graph->getTetrimino(firstResult));
+            int firstLines = firstGrid.clearFullRows();
+
+            PlacementBoard board;
+            std::vector<Tetrimino> secondResults;
+            findPlacements(tetriminos[1], firstGrid, board, secondResults);
+            for (Tetrimino secondPlacement : secondResults) {
+                GameGrid secondGrid = firstGrid;
+                secondGrid.setCells(secondPlacement);
+                int lines = firstLines + secondGrid.clearFullRows();
+                double fitness = computeBoardFitness(secondGrid, totalLockHeight, lines, weights);
+                if (bestFitness < 0 or fitness < bestFitness) {
+                    bestFitness = fitness;
+                    expected = graph->getTetrimino(firstResult);
+                }
+            }
+        }
+
+        EXPECT_EQ(solver.solveForOptimalTetrimino(grid, tetriminos, weights), expected);
+    }
+}
+
+TEST(BeamSearchTest, DepthIsLimitedByPreviewAndMovesReachPlacement) {
+    std::mt19937 rng(11);
+    BeamSearchSolver solver({ .depth = 5, .beamWidth = 8 });
+    GameGrid grid = makeRaggedGrid(rng);
+    std::vector<Tetrimino> tetriminos = { Tetrimino(T, SPAWN_X_DELTA, 0, 0), Tetrimino(I, SPAWN_X_DELTA, 0, 0) };
+
+    Tetrimino placement = solver.solveForOptimalTetrimino(grid, tetriminos, weights);
+    Moves moves = solver.solveForMovesToOptimalTetrimino(grid, tetriminos, weights);
+
+    Tetrimino current = tetriminos[0];
+    for (Move move : moves) {
+        if (std::holds_alternative<Direction>(move) and not grid.checkCollision(current.move(std::get<Direction>(move)))) {
+            current = current.move(std::get<Direction>(move));
+        }
+        else if (std::holds_alternative<Rotation>(move)) {
+            current = current.rotate(std::get<Rotation>(move));
+        }
+    }
+    EXPECT_EQ(current, placement);
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "tetris.h"
+#include "solver.h"
+#include "expectimax.h"
+#include "test_helpers.h"
+
+// Straightforward version of the value ExpectimaxSolver gives a first placement
+static double expectedValue(GameGrid grid, Tetrimino firstPlacement, Tetrimino firstTetrimino, Tetrimino secondTetrimino) {
+    std::array<double, N> probabilities = nextShapeProbabilities();
+    grid.setCells(firstPlacement);
+    int firstLinesCleared = grid.clearFullRows();
+    PlacementBoard board;
+    std::vector<Tetrimino> secondPlacements;
+    std::vector<Tetrimino> thirdPlacements;
+    findPlacements(secondTetrimino, grid, board, secondPlacements);
+
+    double value = 0.0;
+    for (int shape = 0; shape < N; shape++) {
+        if (probabilities[shape] == 0.0) {
+            continue;
+        }
+        Tetrimino thirdTetrimino(static_cast<TetriminoShape>(shape), SPAWN_X_DELTA, 0, 0);
+        double best = std::numeric_limits<double>::infinity();
+        for (Tetrimino secondPlacement : secondPlacements) {
+            GameGrid secondGrid = grid;
+            secondGrid.setCells(secondPlacement);
+            int secondLinesCleared = firstLinesCleared + secondGrid.clearFullRows();
+            if (secondGrid.checkCollision(thirdTetrimino)) {
+                best = std::min(best, TOP_OUT_FITNESS);
+                continue;
+            }
+            findPlacements(thirdTetrimino, secondGrid, board, thirdPlacements);
+            for (Tetrimino thirdPlacement : thirdPlacements) {
+                GameGrid thirdGrid = secondGrid;
+                thirdGrid.setCells(thirdPlacement);
+                int linesCleared = secondLinesCleared + thirdGrid.clearFullRows();
+                int totalLockHeight = firstTetrimino.getHeight() + secondTetrimino.getHeight() + thirdTetrimino.getHeight();
+                best = std::min(best, computeBoardFitness(thirdGrid, totalLockHeight, linesCleared, weights));
+            }
+        }
+        value += probabilities[shape] * (best == std::numeric_limits<double>::infinity() ? TOP_OUT_FITNESS : best);
+    }
+    return value;
+}
+
+TEST(ExpectimaxTest, ShapeProbabilitiesFollowTheRandomizer) {
+    std::array<double, N> probabilities = nextShapeProbabilities();
+    double total = 0.0;
+    for (int shape = 0; shape < N; shape++) {
+        total += probabilities[shape];
+        EXPECT_EQ(probabilities[shape] > 0.0, shape < numTetriminoShapes);
+    }
+    EXPECT_DOUBLE_EQ(total, 1.0);
+}
+
+TEST(ExpectimaxTest, ValuesMatchStraightforwardExpectation) {
+    std::mt19937 rng(17);
+    ExpectimaxSolver solver(2);
+    for (int i = 0; i < 2; i++) {
+        GameGrid grid = makeRaggedGrid(rng, 10);
+        Tetrimino current(static_cast<TetriminoShape>(i * 2), SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(static_cast<TetriminoShape>(i * 2 + 1), SPAWN_X_DELTA, 0, 0);
+
+        solver.pruning = false; // values of pruned subtrees are only bounds so compare without pruning
+        solver.solve(grid, current, next, weights);
+        std::vector<NodeIndex> firstResults = search(solver.getFirstGraph(), current, grid);
+        for (std::size_t r = 0; r < firstResults.size(); r++) {
+            Tetrimino firstPlacement = solver.getFirstGraph()->getTetrimino(firstResults[r]);
+            std::optional<double> value = solver.getValue(r);
+            ASSERT_TRUE(value.has_value());
+            EXPECT_DOUBLE_EQ(*value, expectedValue(grid, firstPlacement, current, next));
+        }
+    }
+}
+
+TEST(ExpectimaxTest, PruningAndThreadCountDontChangeTheMove) {
+    std::mt19937 rng(23);
+    std::uniform_int_distribution<int> randomShape(0, numTetriminoShapes - 1);
+    ExpectimaxSolver singleThreaded(1);
+    singleThreaded.pruning = false;
+    ExpectimaxSolver multiThreaded(4);
+
+    long prunedChanceNodes = 0;
+    for (int i = 0; i < 6; i++) {
+        GameGrid grid = makeRaggedGrid(rng, 10);
+        Tetrimino current(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+        if (grid.checkCollision(current)) {
+            continue;
+        }
+
+        EXPECT_EQ(
+            multiThreaded.solveForMovesToOptimalTetrimino(grid, current, next, weights),
+            singleThreaded.solveForMovesToOptimalTetrimino(grid, current, next, weights));
+        EXPECT_EQ(singleThreaded.stats.prunedChanceNodes, 0);
+        prunedChanceNodes += multiThreaded.stats.prunedChanceNodes;
+    }
+    EXPECT_GT(prunedChanceNodes, 0);
+}
+
+// Negative weights, as tetris_sim --weights and the swarm can give, make negative values, which
+// must still be picked over higher ones
+TEST(ExpectimaxTest, NegativeValuesAreChosen) {
+    EvaluationWeights negativeWeights = {
+        .totalLinesCleared = -10.0,
+        .totalLockHeight = -10.0,
+        .totalWellCells = 1.0,
+        .totalColumnHoles = 5.0,
+        .totalColumnTransitions = 1.0,
+        .totalRowTransitions = 1.0
+    };
+    std::mt19937 rng(29);
+    ExpectimaxSolver solver(2);
+    int negativeSolves = 0;
+    for (int i = 0; i < 4; i++) {
+        GameGrid grid = makeRaggedGrid(rng, 10);
+        Tetrimino current(static_cast<TetriminoShape>(i), SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(static_cast<TetriminoShape>(i + 1), SPAWN_X_DELTA, 0, 0);
+
+        NodeIndex chosen = solver.solve(grid, current, next, negativeWeights);
+        std::vector<NodeIndex> firstResults = search(solver.getFirstGraph(), current, grid);
+        std::size_t best = firstResults.size();
+        for (std::size_t r = 0; r < firstResults.size(); r++) {
+            std::optional<double> value = solver.getValue(r);
+            if (value and (best == firstResults.size() or *value < *solver.getValue(best))) {
+                best = r;
+            }
+        }
+        ASSERT_LT(best, firstResults.size());
+        EXPECT_EQ(chosen, firstResults[best]);
+        negativeSolves += *solver.getValue(best) < 0.0 ? 1 : 0;
+    }
+    EXPECT_GT(negativeSolves, 0);
+}
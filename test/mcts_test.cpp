@@ -0,0 +1,124 @@
+#include <chrono>
+#include <random>
+#include <variant>
+#include <vector>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "tetris.h"
+#include "solver.h"
+#include "mcts.h"
+#include "engine_switch.h"
+#include "test_helpers.h"
+
+// a budget that is never reached so that solves stop at maxIterations
+static const std::chrono::milliseconds unlimitedBudget{60000};
+
+TEST(MctsTest, SingleThreadedSolvesOnlyDependOnTheSeed) {
+    std::mt19937 rng(5);
+    MctsSettings settings = { .moveBudget = unlimitedBudget, .maxIterations = 3000, .seed = 9 };
+    MctsSolver solver(settings, 1);
+    MctsSolver otherSolver(settings, 1);
+
+    for (int i = 0; i < 3; i++) {
+        GameGrid grid = makeRaggedGrid(rng, 10);
+        Tetrimino current(static_cast<TetriminoShape>(i), SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(static_cast<TetriminoShape>(i + 3), SPAWN_X_DELTA, 0, 0);
+
+        solver.solve(grid, current, next, weights);
+        std::vector<int> visits;
+        for (int r = 0; r < static_cast<int>(search(solver.getFirstGraph(), current, grid).size()); r++) {
+            visits.push_back(solver.getVisits(r));
+        }
+        otherSolver.solve(grid, current, next, weights);
+        for (int r = 0; r < static_cast<int>(visits.size()); r++) {
+            EXPECT_EQ(otherSolver.getVisits(r), visits[r]);
+        }
+    }
+}
+
+TEST(MctsTest, EveryIterationIsBackedUpWithAnyThreadCount) {
+    std::mt19937 rng(6);
+    for (int threadCount : { 1, 4 }) {
+        MctsSolver solver({ .moveBudget = unlimitedBudget, .maxIterations = 2000 }, threadCount);
+        GameGrid grid = makeRaggedGrid(rng, 10);
+        Tetrimino current(T, SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(L, SPAWN_X_DELTA, 0, 0);
+
+        solver.solve(grid, current, next, weights);
+        int firstPlacements = static_cast<int>(search(solver.getFirstGraph(), current, grid).size());
+        int visits = 0;
+        for (int r = 0; r < firstPlacements; r++) {
+            visits += solver.getVisits(r);
+        }
+        EXPECT_EQ(solver.stats.iterations, 2000);
+        EXPECT_EQ(visits, 2000);
+        EXPECT_GT(solver.stats.expandedNodes, 1 + firstPlacements);
+    }
+}
+
+TEST(MctsTest, StopsWhenTheMoveBudgetIsSpent) {
+    MctsSolver solver({ .moveBudget = std::chrono::milliseconds(20) }, 2);
+    GameGrid grid;
+    auto start = std::chrono::steady_clock::now();
+    solver.solve(grid, Tetrimino(I, SPAWN_X_DELTA, 0, 0), Tetrimino(O, SPAWN_X_DELTA, 0, 0), weights);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    EXPECT_GT(solver.stats.iterations, 0);
+    EXPECT_LT(seconds, 1.0); // the budget plus the last rollout of each worker
+}
+
+TEST(MctsTest, WithoutRolloutsAgreesWithSolve) {
+    // with no random tetriminos and little exploration the visits concentrate on the first placement
+    // holding the best leaf, which is the one solve() picks
+    std::mt19937 rng(8);
+    MctsSolver solver({ .moveBudget = unlimitedBudget, .maxIterations = 20000, .rolloutDepth = 0, .exploration = 0.05 }, 1);
+    SolverContext context;
+    context.pruning = false;
+
+    for (int i = 0; i < 3; i++) {
+        GameGrid grid = makeRaggedGrid(rng, 10);
+        Tetrimino current(static_cast<TetriminoShape>(i * 2), SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(static_cast<TetriminoShape>(i * 2 + 1), SPAWN_X_DELTA, 0, 0);
+        NodeIndex expected = solve(context, grid, current, next, weights);
+
+        EXPECT_EQ(solver.solveForOptimalTetrimino(grid, current, next, weights), context.firstGraph.getTetrimino(expected));
+    }
+}
+
+TEST(MctsTest, MovesReachTheChosenPlacement) {
+    std::mt19937 rng(12);
+    MctsSolver solver({ .moveBudget = unlimitedBudget, .maxIterations = 1000 }, 1);
+    GameGrid grid = makeRaggedGrid(rng, 10);
+    Tetrimino current(J, SPAWN_X_DELTA, 0, 0);
+    Tetrimino next(S, SPAWN_X_DELTA, 0, 0);
+
+    Tetrimino placement = solver.solveForOptimalTetrimino(grid, current, next, weights);
+    Moves moves = solver.solveForMovesToOptimalTetrimino(grid, current, next, weights);
+
+    for (Move move : moves) {
+        if (std::holds_alternative<Direction>(move) and not grid.checkCollision(current.move(std::get<Direction>(move)))) {
+            current = current.move(std::get<Direction>(move));
+        }
+        else if (std::holds_alternative<Rotation>(move)) {
+            current = current.rotate(std::get<Rotation>(move));
+        }
+    }
+    EXPECT_EQ(current, placement);
+}
+
+TEST(EngineSwitchTest, NamesRoundTripAndSwitchingCycles) {
+    EngineSwitch engines;
+    for (int i = 0; i < numSolverEngines; i++) {
+        SolverEngine engine = twoPlyEngine;
+        EXPECT_TRUE(parseSolverEngine(solverEngineName(static_cast<SolverEngine>(i)), engine));
+        EXPECT_EQ(engine, static_cast<SolverEngine>(i));
+
+        EXPECT_EQ(engines.engine, static_cast<SolverEngine>(i));
+        engines.nextEngine();
+    }
+    EXPECT_EQ(engines.engine, twoPlyEngine);
+
+    SolverEngine engine = mctsEngine;
+    EXPECT_FALSE(parseSolverEngine("3", engine));
+    EXPECT_EQ(engine, mctsEngine);
+}
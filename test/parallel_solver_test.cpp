@@ -0,0 +1,72 @@
+#include <atomic>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "tetris.h"
+#include "solver.h"
+#include "parallel_solver.h"
+#include "thread_pool.h"
+#include "test_helpers.h"
+
+TEST(ThreadPoolTest, RunsEveryTaskOnceAcrossJobs) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    for (int job = 0; job < 50; job++) {
+        std::vector<std::atomic<int>> calls(job);
+        std::atomic<bool> workerInRange = true;
+        auto task = [&](int task, int worker) {
+            calls[task]++;
+            workerInRange = workerInRange and worker >= 0 and worker < pool.size();
+        };
+        pool.run(job, task);
+
+        for (int i = 0; i < job; i++) {
+            EXPECT_EQ(calls[i], 1);
+        }
+        EXPECT_TRUE(workerInRange);
+    }
+}
+
+// Plays a game with solve and checks that ParallelSolver picks the same placement for every piece
+static void expectMatchesSolveDuringAGame(const EvaluationWeights& weights) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> randomShape(0, N - 1);
+    SolverContext context;
+    ParallelSolver parallelSolver(4);
+
+    GameGrid grid;
+    Tetrimino current(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+    Tetrimino next(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+
+    for (int piece = 0; piece < 150 and not grid.checkCollision(current); piece++) {
+        Tetrimino expected = solveForOptimalTetrimino(context, grid, current, next, weights);
+        Moves expectedMoves = movesToReachSearchResult(&context.firstGraph, solve(context, grid, current, next, weights));
+
+        EXPECT_EQ(parallelSolver.solveForOptimalTetrimino(grid, current, next, weights), expected);
+        EXPECT_EQ(parallelSolver.solveForMovesToOptimalTetrimino(grid, current, next, weights), expectedMoves);
+
+        grid.setCells(expected);
+        grid.clearFullRows();
+        current = next;
+        next = Tetrimino(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+    }
+}
+
+TEST(ParallelSolverTest, MatchesSolveDuringAGame) {
+    expectMatchesSolveDuringAGame(weights);
+}
+
+// Negative weights, as tetris_sim --weights and the swarm can give, make negative fitnesses
+TEST(ParallelSolverTest, MatchesSolveWithNegativeFitnesses) {
+    EvaluationWeights negativeWeights = {
+        .totalLinesCleared = -10.0,
+        .totalLockHeight = -10.0,
+        .totalWellCells = 1.0,
+        .totalColumnHoles = 5.0,
+        .totalColumnTransitions = 1.0,
+        .totalRowTransitions = 1.0
+    };
+    expectMatchesSolveDuringAGame(negativeWeights);
+}
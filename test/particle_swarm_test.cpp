@@ -0,0 +1,194 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "solver.h"
+#include "particle_swarm.h"
+#include "xoshiro.h"
+
+static double distance(const SwarmPosition& a, const SwarmPosition& b) {
+    double squared = 0.0;
+    for (int i = 0; i < WEIGHT_COUNT; i++) {
+        squared += (a[i] - b[i]) * (a[i] - b[i]);
+    }
+    return std::sqrt(squared);
+}
+
+TEST(ParticleSwarmTest, WeightsRoundTripThroughPositions) {
+    EvaluationWeights weights = {
+        .totalLinesCleared = 1.0,
+        .totalLockHeight = 2.0,
+        .totalWellCells = 3.0,
+        .totalColumnHoles = 4.0,
+        .totalColumnTransitions = 5.0,
+        .totalRowTransitions = 6.0
+    };
+    SwarmPosition position = positionFromWeights(weights);
+    EXPECT_EQ(position, (SwarmPosition{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 }));
+    EXPECT_EQ(positionFromWeights(weightsFromPosition(position)), position);
+}
+
+TEST(ParticleSwarmTest, UpdateConvergesOnASyntheticFitness) {
+    SwarmSettings settings = { .particles = 16, .seed = 3, .threadCount = 1 };
+    ParticleSwarm swarm(settings);
+    SwarmPosition target = { 1.0, 12.0, 15.0, 26.0, 27.0, 30.0 };
+
+    double firstDiversity = 0.0;
+    double lastDiversity = 0.0;
+    for (int generation = 0; generation < 200; generation++) {
+        std::vector<double> fitnesses;
+        for (const Particle& particle : swarm.getParticles()) {
+            fitnesses.push_back(-distance(particle.position, target));
+        }
+        GenerationStats stats = swarm.update(fitnesses);
+        EXPECT_EQ(stats.generation, generation);
+        firstDiversity = generation == 0 ? stats.diversity : firstDiversity;
+        lastDiversity = stats.diversity;
+    }
+
+    EXPECT_LT(distance(swarm.getBestPosition(), target), 0.5);
+    EXPECT_LT(lastDiversity, firstDiversity);
+    EXPECT_EQ(swarm.getGeneration(), 200);
+}
+
+TEST(ParticleSwarmTest, PositionsStayWithinBounds) {
+    SwarmSettings settings = { .particles = 8, .seed = 5, .minWeight = 0.0, .maxWeight = 10.0, .maxVelocity = 0.5, .threadCount = 1 };
+    ParticleSwarm swarm(settings);
+    SwarmPosition outside = { -100.0, 100.0, -100.0, 100.0, -100.0, 100.0 };
+
+    for (int generation = 0; generation < 30; generation++) {
+        std::vector<double> fitnesses;
+        for (const Particle& particle : swarm.getParticles()) {
+            fitnesses.push_back(-distance(particle.position, outside));
+        }
+        swarm.update(fitnesses);
+        for (const Particle& particle : swarm.getParticles()) {
+            for (double weight : particle.position) {
+                EXPECT_GE(weight, 0.0);
+                EXPECT_LE(weight, 10.0);
+            }
+        }
+    }
+}
+
+TEST(ParticleSwarmTest, SwarmNumbersAreApartFromTheGames) {
+    SwarmSettings settings;
+    settings.particles = 4;
+    settings.seed = 5;
+    settings.minWeight = 0.0;
+    settings.maxWeight = 1.0;
+    settings.threadCount = 1;
+    ParticleSwarm swarm(settings);
+
+    // game 0 draws from Xoshiro256(seed) itself, so none of its first numbers may seed a position
+    Xoshiro256 game(settings.seed);
+    for (int i = 0; i < 64; i++) {
+        double gameUniform = (game() >> 11) * 0x1.0p-53;
+        for (const Particle& particle : swarm.getParticles()) {
+            for (double weight : particle.position) {
+                EXPECT_NE(weight, gameUniform);
+            }
+        }
+    }
+}
+
+TEST(ParticleSwarmTest, EvaluationDoesNotDependOnThreadCount) {
+    SwarmSettings settings = { .particles = 3, .gamesPerParticle = 2, .pieceCap = 40, .seed = 11, .threadCount = 1 };
+    ParticleSwarm singleThreaded(settings);
+    settings.threadCount = 3;
+    ParticleSwarm multiThreaded(settings);
+
+    // same seed, same swarm
+    std::vector<EvaluationWeights> weights = singleThreaded.getParticleWeights();
+    ASSERT_EQ(weights.size(), 3);
+    EXPECT_EQ(positionFromWeights(multiThreaded.getParticleWeights()[2]), positionFromWeights(weights[2]));
+
+    std::vector<double> expected = singleThreaded.evaluate(weights);
+    EXPECT_EQ(multiThreaded.evaluate(weights), expected);
+
+    // common random numbers: the same weights score the same in any slot
+    std::vector<EvaluationWeights> repeated = { weights[1], weights[1], weights[0] };
+    std::vector<double> fitnesses = multiThreaded.evaluate(repeated);
+    EXPECT_EQ(fitnesses[0], expected[1]);
+    EXPECT_EQ(fitnesses[1], expected[1]);
+    EXPECT_EQ(fitnesses[2], expected[0]);
+}
+
+TEST(ParticleSwarmTest, StepRecordsTheBestFitnessSeen) {
+    ParticleSwarm swarm({ .particles = 4, .gamesPerParticle = 1, .pieceCap = 30, .seed = 2, .threadCount = 2 });
+    double best = 0.0;
+    for (int generation = 0; generation < 3; generation++) {
+        GenerationStats stats = swarm.step();
+        EXPECT_GE(stats.bestFitness, stats.generationBestFitness);
+        EXPECT_GE(stats.bestFitness, best);
+        EXPECT_GE(stats.generationBestFitness, stats.meanFitness);
+        best = stats.bestFitness;
+    }
+    EXPECT_EQ(swarm.getBestFitness(), best);
+}
+
+static void updateTowards(ParticleSwarm& swarm, const SwarmPosition& target, int generations) {
+    for (int generation = 0; generation < generations; generation++) {
+        std::vector<double> fitnesses;
+        for (const Particle& particle : swarm.getParticles()) {
+            fitnesses.push_back(-distance(particle.position, target));
+        }
+        swarm.update(fitnesses);
+    }
+}
+
+TEST(ParticleSwarmTest, CheckpointResumesExactly) {
+    std::string path = ::testing::TempDir() + "particle_swarm_test.checkpoint";
+    SwarmSettings settings = { .particles = 6, .gamesPerParticle = 3, .seed = 9, .threadCount = 1 };
+    SwarmPosition target = { 2.0, 4.0, 8.0, 16.0, 32.0, 40.0 };
+    ParticleSwarm uninterrupted(settings);
+    updateTowards(uninterrupted, target, 8);
+
+    ParticleSwarm interrupted(settings);
+    updateTowards(interrupted, target, 3);
+    ASSERT_TRUE(interrupted.saveCheckpoint(path));
+    ParticleSwarm resumed({ .particles = 2, .seed = 1234, .threadCount = 1 });
+    ASSERT_TRUE(resumed.loadCheckpoint(path));
+    EXPECT_EQ(resumed.getGeneration(), 3);
+    EXPECT_EQ(resumed.getSettings().particles, 6);
+    EXPECT_EQ(resumed.getSettings().gamesPerParticle, 3);
+    EXPECT_EQ(resumed.getSettings().seed, 9);
+    updateTowards(resumed, target, 5);
+
+    ASSERT_EQ(resumed.getParticles().size(), uninterrupted.getParticles().size());
+    for (std::size_t i = 0; i < resumed.getParticles().size(); i++) {
+        EXPECT_EQ(resumed.getParticles()[i].position, uninterrupted.getParticles()[i].position);
+        EXPECT_EQ(resumed.getParticles()[i].velocity, uninterrupted.getParticles()[i].velocity);
+    }
+    EXPECT_EQ(resumed.getBestPosition(), uninterrupted.getBestPosition());
+    EXPECT_EQ(resumed.getBestFitness(), uninterrupted.getBestFitness());
+    std::remove(path.c_str());
+}
+
+TEST(ParticleSwarmTest, LoadingSomethingElseLeavesTheSwarmAlone) {
+    std::string path = ::testing::TempDir() + "particle_swarm_test.not_a_checkpoint";
+    ParticleSwarm swarm({ .particles = 4, .seed = 8, .threadCount = 1 });
+    std::vector<Particle> particles = swarm.getParticles();
+
+    EXPECT_FALSE(swarm.loadCheckpoint(path + ".missing"));
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "TSWARM01 but cut short";
+    }
+    EXPECT_FALSE(swarm.loadCheckpoint(path));
+    ASSERT_TRUE(swarm.saveCheckpoint(path));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "trailing";
+    }
+    EXPECT_FALSE(swarm.loadCheckpoint(path));
+
+    EXPECT_EQ(swarm.getGeneration(), 0);
+    ASSERT_EQ(swarm.getParticles().size(), particles.size());
+    for (std::size_t i = 0; i < particles.size(); i++) {
+        EXPECT_EQ(swarm.getParticles()[i].position, particles[i].position);
+    }
+    std::remove(path.c_str());
+}
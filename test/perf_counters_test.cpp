@@ -0,0 +1,106 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+// Keeps the thread busy for a while without the compiler folding the loop away
+static uint64_t spin(int rounds) {
+    volatile uint64_t sum = 0;
+    for (int i = 0; i < rounds; i++) {
+        sum = sum + i;
+    }
+    return sum;
+}
+
+TEST(PerfCountersTest, HardwareEventsOpenOrSayWhy) {
+    PerfCounterGroup group;
+    PerfReading reading;
+    if (group.open(PerfCounterGroup::hardwareEvents())) {
+        EXPECT_TRUE(group.read(reading));
+        EXPECT_GE(reading.enabled, reading.running);
+    }
+    else {
+        EXPECT_FALSE(group.getError().empty());
+        EXPECT_FALSE(group.read(reading));
+    }
+}
+
+TEST(PerfCountersTest, MultiplexedCountsScaleTheirDifference) {
+    PerfReading start;
+    start.enabled = 100;
+    start.running = 50;
+    start.values[cyclesEvent] = 100;
+
+    // a quiet stretch that ran the whole time after a multiplexed one: scaling the running totals
+    // would read 200 then 115 and wrap around
+    PerfReading quiet = start;
+    quiet.enabled = 1100;
+    quiet.running = 1050;
+    quiet.values[cyclesEvent] = 110;
+    EXPECT_EQ(perfCountBetween(start, quiet, cyclesEvent), 10u);
+
+    // on the PMU for half of the stretch, so the count is doubled
+    PerfReading multiplexed = start;
+    multiplexed.enabled = 300;
+    multiplexed.running = 150;
+    multiplexed.values[cyclesEvent] = 150;
+    EXPECT_EQ(perfCountBetween(start, multiplexed, cyclesEvent), 100u);
+
+    // never scheduled in between
+    PerfReading idle = start;
+    idle.enabled = 200;
+    EXPECT_EQ(perfCountBetween(start, idle, cyclesEvent), 0u);
+    EXPECT_EQ(perfCountBetween(start, start, instructionsEvent), 0u);
+}
+
+#ifdef __linux__
+TEST(PerfCountersTest, SoftwareEventsCountUpwards) {
+    PerfCounterGroup group;
+    if (not group.open({ { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK } })) {
+        GTEST_SKIP() << "perf_event_open unavailable: " << group.getError();
+    }
+    PerfReading before;
+    PerfReading after;
+    ASSERT_TRUE(group.read(before));
+    spin(1000000);
+    ASSERT_TRUE(group.read(after));
+    EXPECT_TRUE(group.isCounting(0));
+    EXPECT_GT(after.values[0], before.values[0]);
+    EXPECT_GT(perfCountBetween(before, after, 0), 0u);
+}
+#endif
+
+TEST(PerfCountersTest, PhasesAreCountedOrReportedMissing) {
+    startPerfPhases();
+    {
+        PerfPhaseScope solve(solvePhase);
+        PerfPhaseScope makeGraph(makeGraphPhase);
+        spin(100000);
+    }
+    {
+        PerfPhaseScope solve(solvePhase);
+    }
+    PerfReport report = getPerfReport();
+    perfPhasesEnabled.store(false);
+
+    std::stringstream json;
+    printPerfReport(json, report, 2);
+    if (report.available) {
+        EXPECT_EQ(report.phases[solvePhase].calls, 2u);
+        EXPECT_EQ(report.phases[makeGraphPhase].calls, 1u);
+        EXPECT_EQ(report.phases[searchPhase].calls, 0u);
+        EXPECT_NE(json.str().find("\"perPiece\""), std::string::npos);
+        EXPECT_NE(json.str().find("\"makeGraph\": {\"calls\": 1"), std::string::npos);
+    }
+    else {
+        EXPECT_FALSE(report.error.empty());
+        EXPECT_EQ(report.phases[solvePhase].calls, 0u);
+        EXPECT_NE(json.str().find("\"available\": false, \"error\": "), std::string::npos);
+    }
+}
@@ -0,0 +1,52 @@
+#include <chrono>
+#include <signal.h>
+#include <vector>
+#include <gtest/gtest.h>
+#include "solver.h"
+#include "particle_swarm.h"
+#include "process_evaluator.h"
+
+static const SwarmSettings settings = { .particles = 3, .gamesPerParticle = 2, .pieceCap = 40, .seed = 11, .threadCount = 1 };
+
+TEST(ProcessEvaluatorTest, MatchesThreadedEvaluation) {
+    ParticleSwarm swarm(settings);
+    std::vector<EvaluationWeights> weights = swarm.getParticleWeights();
+    ProcessEvaluator evaluator(2, settings);
+    ASSERT_TRUE(evaluator.start());
+
+    std::vector<double> fitnesses;
+    ASSERT_TRUE(evaluator.evaluate(weights, fitnesses));
+    EXPECT_EQ(fitnesses, swarm.evaluate(weights));
+    // and again on the same workers
+    ASSERT_TRUE(evaluator.evaluate({ weights[2] }, fitnesses));
+    ASSERT_EQ(fitnesses.size(), 1);
+    EXPECT_EQ(fitnesses[0], swarm.evaluate({ weights[2] })[0]);
+}
+
+TEST(ProcessEvaluatorTest, ReplacesAWorkerThatDied) {
+    ParticleSwarm swarm(settings);
+    std::vector<EvaluationWeights> weights = swarm.getParticleWeights();
+    ProcessEvaluator evaluator(1, settings);
+    ASSERT_TRUE(evaluator.start());
+    pid_t worker = evaluator.getWorkerPid(0);
+    kill(worker, SIGKILL);
+
+    std::vector<double> fitnesses;
+    ASSERT_TRUE(evaluator.evaluate(weights, fitnesses));
+    EXPECT_NE(evaluator.getWorkerPid(0), worker);
+    EXPECT_EQ(fitnesses, swarm.evaluate(weights));
+}
+
+TEST(ProcessEvaluatorTest, GivesUpOnGamesThatHang) {
+    SwarmSettings longGames = settings;
+    longGames.pieceCap = 0; // the games run until they top out, far longer than the timeout
+    ParticleSwarm swarm(longGames);
+    ProcessEvaluator evaluator(1, longGames);
+    evaluator.gameTimeout = std::chrono::milliseconds(20);
+    ASSERT_TRUE(evaluator.start());
+    pid_t worker = evaluator.getWorkerPid(0);
+
+    std::vector<double> fitnesses;
+    EXPECT_FALSE(evaluator.evaluate(swarm.getParticleWeights(), fitnesses));
+    EXPECT_EQ(kill(worker, 0), -1); // killed rather than left running
+}
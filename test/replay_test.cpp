@@ -0,0 +1,247 @@
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "engine_switch.h"
+#include "replay.h"
+#include "simulation.h"
+#include "solver.h"
+#include "tetris.h"
+#include "xoshiro.h"
+#include "test_helpers.h"
+
+// Hard drops every tetrimino where the board scores best, without looking at the next one or at
+// tucks, so tests can record long games far quicker than the solver plays them
+static std::vector<Tetrimino> greedyGame(int pieces, uint64_t seed) {
+    Xoshiro256 rng(seed);
+    GameGrid grid;
+    std::vector<Tetrimino> placements;
+    for (int piece = 0; piece < pieces; piece++) {
+        Tetrimino tetrimino(static_cast<TetriminoShape>(rng.below(numTetriminoShapes)));
+        Tetrimino best;
+        double bestFitness = std::numeric_limits<double>::max();
+        for (int rotation = 0; rotation < tetrimino.getRotationCount(); rotation++) {
+            for (int x = 0; x < GRID_WIDTH; x++) {
+                Tetrimino candidate(tetrimino.shape, x, 0, rotation);
+                if (grid.checkCollision(candidate)) {
+                    continue;
+                }
+                while (not grid.checkCollision(candidate.move(down))) {
+                    candidate = candidate.move(down);
+                }
+                GameGrid after = grid;
+                int linesCleared = applyPlacement(after, candidate);
+                double fitness = computeBoardFitness(after, GRID_HEIGHT - candidate.yDelta, linesCleared, weights);
+                if (fitness < bestFitness) {
+                    bestFitness = fitness;
+                    best = candidate;
+                }
+            }
+        }
+        if (best.shape == N) { // topped out
+            break;
+        }
+        applyPlacement(grid, best);
+        placements.push_back(best);
+    }
+    return placements;
+}
+
+// Records placement the way playGame does, grid standing in for the game's board
+static void addPlacement(ReplayWriter& writer, GameGrid& grid, const Tetrimino& placement) {
+    applyPlacement(grid, placement);
+    writer.addPlacement(placement, grid.getHash());
+}
+
+static Replay& loadReplay(Replay& replay, const ReplayWriter& writer) {
+    EXPECT_TRUE(replay.load(writer.toBytes()));
+    return replay;
+}
+
+TEST(ReplayTest, ReplaysPlayBackTheGame) {
+    SimulationSettings settings;
+    settings.seed = 7;
+    settings.pieceCap = 150;
+    settings.threadCount = 1;
+    settings.weights = weights;
+    settings.mctsSettings.maxIterations = 200;
+    EngineSwitch solver;
+    solver.threadCount = 1;
+    ReplayWriter writer(settings, 3, 16);
+    std::vector<double> solveMicroseconds;
+    GameResult result = playGame(solver, settings, 3, streamGenerator(7, 3), solveMicroseconds, &writer);
+    Replay replay;
+    loadReplay(replay, writer);
+
+    const ReplayHeader& header = replay.getHeader();
+    EXPECT_EQ(header.seed, 7u);
+    EXPECT_EQ(header.stream, 3u);
+    EXPECT_EQ(header.mctsSettings.maxIterations, 200);
+    EXPECT_EQ(header.pieces, static_cast<uint64_t>(result.pieces));
+    EXPECT_EQ(header.linesCleared, static_cast<uint64_t>(result.linesCleared));
+    EXPECT_EQ(header.keyframeCount, header.pieces / 16 + 1);
+    EXPECT_LT(header.placementsBytes, header.pieces * 3 / 2); // tucks are the exception
+    // the rolling hash is made of the game's boards, so this checks every board played back
+    // against the one the game had
+    uint64_t divergence = 0;
+    EXPECT_TRUE(replay.verify(divergence));
+
+    ReplayPosition end;
+    ASSERT_TRUE(replay.seek(header.pieces, end));
+    EXPECT_EQ(end.rollingHash, header.rollingHash);
+    EXPECT_FALSE(replay.seek(header.pieces + 1, end));
+}
+
+TEST(ReplayTest, SeekingMatchesReplayingFromTheStart) {
+    std::vector<Tetrimino> placements = greedyGame(5000, 11);
+    uint64_t pieces = placements.size();
+    ASSERT_GT(pieces, 200u);
+    SimulationSettings settings;
+    settings.seed = 11;
+    ReplayWriter writer(settings, 0, 16);
+    GameGrid grid;
+    for (const Tetrimino& placement : placements) {
+        addPlacement(writer, grid, placement);
+    }
+    writer.finish(false);
+    Replay replay;
+    loadReplay(replay, writer);
+
+    ReplayPosition position;
+    ASSERT_TRUE(replay.seek(0, position));
+    for (uint64_t piece : { uint64_t(0), uint64_t(1), uint64_t(15), uint64_t(16), uint64_t(17), pieces / 2, pieces - 1, pieces }) {
+        Tetrimino placement;
+        while (position.piece < piece) {
+            ASSERT_TRUE(replay.step(position, &placement));
+            ASSERT_TRUE(placement == placements[position.piece - 1]);
+        }
+        ReplayPosition sought;
+        ASSERT_TRUE(replay.seek(piece, sought));
+        EXPECT_EQ(sought.piece, piece);
+        EXPECT_EQ(sought.offset, position.offset);
+        EXPECT_EQ(sought.linesCleared, position.linesCleared);
+        EXPECT_EQ(sought.rollingHash, position.rollingHash);
+        EXPECT_EQ(sought.grid.getHash(), position.grid.getHash());
+    }
+    EXPECT_FALSE(replay.step(position));
+}
+
+TEST(ReplayTest, TuckedPlacementsTakeThreeBytes) {
+    ReplayWriter writer({}, 0);
+    GameGrid grid;
+    addPlacement(writer, grid, Tetrimino(O, 1, 18, 0)); // columns 0 and 1 of the bottom two rows
+    addPlacement(writer, grid, Tetrimino(I, 2, 17, 0)); // on top of it, over columns 2 and 3
+    addPlacement(writer, grid, Tetrimino(O, 3, 18, 0)); // slid in under the I
+    writer.finish(false);
+    Replay replay;
+    loadReplay(replay, writer);
+
+    EXPECT_EQ(replay.getHeader().placementsBytes, 5u);
+    ReplayPosition position;
+    ASSERT_TRUE(replay.seek(3, position));
+    EXPECT_EQ(position.grid.getRow(17), 0b1111);
+    EXPECT_EQ(position.grid.getRow(18), 0b1111);
+    EXPECT_EQ(position.grid.getRow(19), 0b1111);
+    uint64_t divergence = 0;
+    EXPECT_TRUE(replay.verify(divergence));
+}
+
+TEST(ReplayTest, DamagedReplaysAreCaught) {
+    std::vector<Tetrimino> placements = greedyGame(300, 5);
+    ReplayWriter writer({}, 0, 32);
+    GameGrid grid;
+    for (const Tetrimino& placement : placements) {
+        addPlacement(writer, grid, placement);
+    }
+    std::vector<uint8_t> bytes = writer.toBytes();
+    Replay replay;
+
+    ReplayHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    std::vector<uint8_t> damaged = bytes;
+    uint8_t& placement = damaged[header.placementsOffset + 100];
+    placement = placement == 0 ? 1 : placement - 1;
+    ASSERT_TRUE(replay.load(damaged));
+    uint64_t divergence = 0;
+    EXPECT_FALSE(replay.verify(divergence));
+    EXPECT_GT(divergence, 64u);
+    EXPECT_LE(divergence, 128u);
+
+    std::vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+    EXPECT_FALSE(replay.load(truncated));
+    std::vector<uint8_t> badMagic = bytes;
+    badMagic[0] = 'X';
+    EXPECT_FALSE(replay.load(badMagic));
+    EXPECT_TRUE(replay.load(bytes));
+    EXPECT_TRUE(replay.verify(divergence));
+}
+
+TEST(ReplayTest, BoardsTheGameDidntHaveAreCaught) {
+    std::vector<Tetrimino> placements = greedyGame(100, 5);
+    ASSERT_EQ(placements.size(), 100u);
+    ReplayWriter writer({}, 0, 32);
+    GameGrid grid;
+    for (int i = 0; i < 100; i++) {
+        if (i == 40) { // the game's board had a cell the placements don't account for
+            grid.setCell(Position(0, 0), first);
+        }
+        addPlacement(writer, grid, placements[i]);
+    }
+    Replay replay;
+    loadReplay(replay, writer);
+
+    uint64_t divergence = 0;
+    EXPECT_FALSE(replay.verify(divergence));
+    EXPECT_EQ(divergence, 64u);
+}
+
+TEST(ReplayTest, MatchingPlacementsFindsTheFirstDifference) {
+    std::vector<Tetrimino> placements = greedyGame(200, 9);
+    ReplayWriter expectedWriter({}, 0);
+    ReplayWriter actualWriter({}, 0);
+    GameGrid expectedGrid;
+    GameGrid actualGrid;
+    Tetrimino moved = placements[120];
+    moved.xDelta += moved.xDelta + moved.getMask().maxX + 1 < GRID_WIDTH ? 1 : -1;
+    for (int i = 0; i < 200; i++) {
+        addPlacement(expectedWriter, expectedGrid, placements[i]);
+        addPlacement(actualWriter, actualGrid, i == 120 ? moved : placements[i]);
+    }
+    Replay expected;
+    Replay actual;
+    loadReplay(expected, expectedWriter);
+    loadReplay(actual, actualWriter);
+
+    EXPECT_EQ(matchingPlacements(expected, expected), 200u);
+    EXPECT_EQ(matchingPlacements(expected, actual), 120u);
+}
+
+TEST(ReplayTest, SimulationsSaveAReplayPerGame) {
+    std::string directory = ::testing::TempDir() + "replay_test_simulations";
+    std::filesystem::remove_all(directory);
+    ASSERT_TRUE(std::filesystem::create_directory(directory));
+    SimulationSettings settings;
+    settings.games = 2;
+    settings.seed = 3;
+    settings.pieceCap = 40;
+    settings.threadCount = 2;
+    settings.weights = weights;
+    settings.replayDirectory = directory;
+    SimulationReport report = runSimulation(settings);
+
+    for (const GameResult& game : report.games) {
+        EXPECT_TRUE(game.replaySaved);
+        Replay replay;
+        ASSERT_TRUE(replay.open(directory + "/game" + std::to_string(game.stream) + ".replay"));
+        EXPECT_EQ(replay.getHeader().stream, static_cast<uint32_t>(game.stream));
+        EXPECT_EQ(replay.getHeader().pieces, 40u);
+        EXPECT_EQ(replay.getHeader().linesCleared, static_cast<uint64_t>(game.linesCleared));
+        uint64_t divergence = 0;
+        EXPECT_TRUE(replay.verify(divergence));
+    }
+    Replay missing;
+    EXPECT_FALSE(missing.open(directory + "/no_such.replay"));
+    std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <vector>
+#include <gtest/gtest.h>
+#include "solver.h"
+#include "simulation.h"
+#include "xoshiro.h"
+#include "test_helpers.h"
+
+TEST(SimulationTest, GamesOnlyDependOnTheirStream) {
+    SimulationSettings settings;
+    settings.games = 4;
+    settings.seed = 100;
+    settings.pieceCap = 60;
+    settings.threadCount = 1;
+    settings.weights = weights;
+    SimulationReport singleThreaded = runSimulation(settings);
+    settings.threadCount = 3;
+    SimulationReport multiThreaded = runSimulation(settings);
+
+    ASSERT_EQ(singleThreaded.games.size(), 4);
+    ASSERT_EQ(multiThreaded.games.size(), 4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_EQ(singleThreaded.games[i].stream, i);
+        EXPECT_EQ(multiThreaded.games[i].stream, i);
+        EXPECT_EQ(multiThreaded.games[i].pieces, singleThreaded.games[i].pieces);
+        EXPECT_EQ(multiThreaded.games[i].linesCleared, singleThreaded.games[i].linesCleared);
+    }
+}
+
+TEST(SimulationTest, GamesStopAtThePieceCap) {
+    SimulationSettings settings;
+    settings.games = 3;
+    settings.pieceCap = 25;
+    settings.threadCount = 2;
+    settings.weights = weights;
+    SimulationReport report = runSimulation(settings);
+
+    for (const GameResult& game : report.games) {
+        EXPECT_EQ(game.pieces, 25);
+        EXPECT_FALSE(game.toppedOut);
+    }
+    EXPECT_EQ(report.totalPieces(), 75);
+    EXPECT_EQ(report.solveMicroseconds.size(), 75);
+    EXPECT_TRUE(std::is_sorted(report.solveMicroseconds.begin(), report.solveMicroseconds.end()));
+}
+
+TEST(SimulationTest, GarbageRowsTopGamesOut) {
+    SimulationSettings settings;
+    settings.games = 2;
+    settings.seed = 5;
+    settings.pieceCap = 500;
+    settings.threadCount = 1;
+    settings.weights = weights;
+    settings.garbageInterval = 1; // 9 cells a piece against the tetrimino's 4
+    SimulationReport singleThreaded = runSimulation(settings);
+    settings.threadCount = 2;
+    SimulationReport multiThreaded = runSimulation(settings);
+
+    for (int i = 0; i < 2; i++) {
+        EXPECT_TRUE(singleThreaded.games[i].toppedOut);
+        EXPECT_LT(singleThreaded.games[i].pieces, 500);
+        EXPECT_EQ(multiThreaded.games[i].pieces, singleThreaded.games[i].pieces);
+        EXPECT_EQ(multiThreaded.games[i].linesCleared, singleThreaded.games[i].linesCleared);
+    }
+}
+
+TEST(SimulationTest, StreamGeneratorsAreOneJumpApart) {
+    std::vector<Xoshiro256> generators = streamGenerators(12, 5);
+    ASSERT_EQ(generators.size(), 5u);
+    for (int stream = 0; stream < 5; stream++) {
+        EXPECT_TRUE(generators[stream] == streamGenerator(12, stream));
+    }
+    EXPECT_TRUE(streamGenerators(12, 0).empty());
+}
+
+TEST(SimulationTest, PercentileUsesNearestRank) {
+    std::vector<double> values = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    EXPECT_EQ(percentile(values, 0), 1);
+    EXPECT_EQ(percentile(values, 50), 5);
+    EXPECT_EQ(percentile(values, 90), 9);
+    EXPECT_EQ(percentile(values, 99), 10);
+    EXPECT_EQ(percentile(values, 100), 10);
+    EXPECT_EQ(percentile({}, 50), 0);
+}
@@ -0,0 +1,84 @@
+#include <cstdlib>
+#include <new>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "tetris.h"
+#include "solver.h"
+
+// Global allocation counter. Replacing operator new affects the whole binary which is why these
+// tests live in their own executable.
+static long allocationCount = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static GameGrid makeMidGameGrid() {
+    GameGrid grid;
+    std::vector<std::vector<int>> gridFillData = {
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, // starting at row 15 (0 indexed)
+        { 1, 0, 1, 0, 0, 0, 1, 0, 1, 0},
+        { 1, 0, 0, 1, 1, 1, 1, 1, 1, 1},
+        { 1, 0, 1, 1, 1, 1, 1, 0, 1, 1},
+        { 0, 1, 0, 1, 1, 0, 1, 0, 1, 0}
+    };
+    for (int i = 0; i < static_cast<int>(gridFillData.size()); i++) {
+        for (int j = 0; j < GRID_WIDTH; j++) {
+            if (gridFillData[i][j]) {
+                grid.setCell(Position(j, i + 15), first);
+            }
+        }
+    }
+    return grid;
+}
+
+TEST(SolverAllocationTest, SolveMakesNoAllocationsAfterWarmUp) {
+    EvaluationWeights weights = {1.0, 12.9, 15.8, 26.9, 27.6, 30.2};
+    GameGrid grid = makeMidGameGrid();
+    SolverContext context;
+
+    // warm up with every shape so the context's buffers reach their final size
+    for (int shape = 0; shape < N; shape++) {
+        Tetrimino tetrimino(static_cast<TetriminoShape>(shape), SPAWN_X_DELTA, 0, 0);
+        solve(context, grid, tetrimino, tetrimino, weights);
+    }
+
+    long allocationsBefore = allocationCount;
+    for (int first = 0; first < N; first++) {
+        for (int second = 0; second < N; second++) {
+            Tetrimino firstTetrimino(static_cast<TetriminoShape>(first), SPAWN_X_DELTA, 0, 0);
+            Tetrimino secondTetrimino(static_cast<TetriminoShape>(second), SPAWN_X_DELTA, 0, 0);
+            NodeIndex result = solve(context, grid, firstTetrimino, secondTetrimino, weights);
+            EXPECT_NE(result, NO_NODE);
+        }
+    }
+    EXPECT_EQ(allocationCount - allocationsBefore, 0);
+}
+
+TEST(SolverAllocationTest, ReusedContextMatchesFreshContext) {
+    EvaluationWeights weights = {1.0, 12.9, 15.8, 26.9, 27.6, 30.2};
+    GameGrid grid = makeMidGameGrid();
+    SolverContext reusedContext;
+
+    for (int first = 0; first < N; first++) {
+        for (int second = 0; second < N; second++) {
+            Tetrimino firstTetrimino(static_cast<TetriminoShape>(first), SPAWN_X_DELTA, 0, 0);
+            Tetrimino secondTetrimino(static_cast<TetriminoShape>(second), SPAWN_X_DELTA, 0, 0);
+            SolverContext freshContext;
+            NodeIndex expected = solve(freshContext, grid, firstTetrimino, secondTetrimino, weights);
+            NodeIndex actual = solve(reusedContext, grid, firstTetrimino, secondTetrimino, weights);
+            EXPECT_EQ(freshContext.firstGraph.getTetrimino(expected), reusedContext.firstGraph.getTetrimino(actual));
+            EXPECT_EQ(
+                movesToReachSearchResult(&freshContext.firstGraph, expected), 
+                movesToReachSearchResult(&reusedContext.firstGraph, actual));
+        }
+    }
+}
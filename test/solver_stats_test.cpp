@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <thread>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "solver.h"
+#include "solver_stats.h"
+#include "engine_switch.h"
+#include "tetris.h"
+
+TEST(LatencyHistogramTest, BucketsAreContiguousAndWithinASixteenth) {
+    EXPECT_EQ(LatencyHistogram::bucketIndex(0), 0);
+    EXPECT_EQ(LatencyHistogram::bucketIndex(31), 31);
+    EXPECT_EQ(LatencyHistogram::bucketIndex(32), 32);
+    EXPECT_EQ(LatencyHistogram::bucketIndex(UINT64_MAX), LatencyHistogram::bucketCount - 1);
+    EXPECT_EQ(LatencyHistogram::bucketHighest(LatencyHistogram::bucketCount - 1), UINT64_MAX);
+
+    for (int i = 0; i + 1 < LatencyHistogram::bucketCount; i++) {
+        uint64_t highest = LatencyHistogram::bucketHighest(i);
+        ASSERT_EQ(LatencyHistogram::bucketIndex(highest), i);
+        ASSERT_EQ(LatencyHistogram::bucketIndex(highest + 1), i + 1);
+    }
+    for (uint64_t value : { 100ull, 12345ull, 987654321ull, 1ull << 40 }) {
+        EXPECT_LE(LatencyHistogram::bucketHighest(LatencyHistogram::bucketIndex(value)) - value, value / 16);
+    }
+}
+
+TEST(LatencyHistogramTest, PercentilesUseNearestRank) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(50), 0);
+    for (uint64_t value = 1; value <= 10; value++) {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.getCount(), 10);
+    EXPECT_EQ(histogram.percentile(50), 5);
+    EXPECT_EQ(histogram.percentile(90), 9);
+    EXPECT_EQ(histogram.percentile(100), 10);
+    EXPECT_DOUBLE_EQ(histogram.mean(), 5.5);
+
+    LatencyHistogram spike;
+    spike.record(1000000);
+    histogram.merge(spike);
+    EXPECT_EQ(histogram.percentile(50), 6);
+    EXPECT_EQ(histogram.percentile(100), 1000000); // capped at the max rather than the bucket's top
+    EXPECT_EQ(histogram.getMax(), 1000000);
+}
+
+TEST(SolverStatsTest, CountsSolverWorkOnEveryThread) {
+    if (not solverStatsEnabled()) {
+        GTEST_SKIP() << "configure with -DSOLVER_STATS=ON";
+    }
+    resetSolverStats();
+    std::thread solving([]() {
+        EngineSwitch solver;
+        solver.threadCount = 1;
+        GameGrid grid;
+        EvaluationWeights weights = { 1.0, 12.0, 15.0, 26.0, 27.0, 30.0 };
+        solver.solveForOptimalTetrimino(grid, Tetrimino(T, SPAWN_X_DELTA, 0, 0), Tetrimino(I, SPAWN_X_DELTA, 0, 0), weights);
+    });
+    solving.join();
+
+    SolverStatsReport report = getSolverStats();
+    EXPECT_EQ(report.solves(), 1);
+    EXPECT_GT(report.solveNanoseconds.getMax(), 0);
+    EXPECT_EQ(report.counters[neighbourTestsCounter], 4 * report.counters[graphNodesCounter]);
+    EXPECT_EQ(report.counters[graphNodesCounter], GRID_WIDTH * GRID_HEIGHT * 4); // a T has 4 rotations
+    EXPECT_GT(report.counters[bfsVisitsCounter], report.counters[searchedPlacementsCounter]);
+    EXPECT_EQ(report.counters[searchedPlacementsCounter], 34); // T on an empty board
+    EXPECT_GT(report.counters[foundPlacementsCounter], 0);
+    EXPECT_GT(report.counters[leavesEvaluatedCounter], 0);
+    EXPECT_GT(report.counters[collisionChecksCounter], report.counters[neighbourTestsCounter]);
+    ASSERT_EQ(report.slowestSolves.size(), 1u);
+    EXPECT_EQ(report.slowestSolves[0].nanoseconds, report.solveNanoseconds.getMax());
+    EXPECT_EQ(report.slowestSolves[0].counters, report.counters); // a single threaded solve counts on the solving thread
+
+    resetSolverStats();
+    EXPECT_EQ(getSolverStats().counters[graphNodesCounter], 0);
+    EXPECT_EQ(getSolverStats().solves(), 0);
+}
+
+TEST(SolverStatsTest, KeepsTheSlowestSolvesCounters) {
+    resetSolverStats();
+    for (uint64_t nanoseconds : { 5, 12, 3, 9, 1, 11, 7, 2, 10, 4, 8, 6 }) {
+        SolverCounts counts{};
+        counts[graphNodesCounter] = nanoseconds * 100;
+        recordSolve(nanoseconds, counts);
+    }
+    SolverStatsReport report = getSolverStats();
+    EXPECT_EQ(report.solves(), 12);
+    ASSERT_EQ(report.slowestSolves.size(), static_cast<std::size_t>(SolverStatsReport::slowSolveCount));
+    for (int i = 0; i < SolverStatsReport::slowSolveCount; i++) {
+        EXPECT_EQ(report.slowestSolves[i].nanoseconds, static_cast<uint64_t>(12 - i));
+        EXPECT_EQ(report.slowestSolves[i].counters[graphNodesCounter], static_cast<uint64_t>(12 - i) * 100);
+    }
+    resetSolverStats();
+    EXPECT_TRUE(getSolverStats().slowestSolves.empty());
+}
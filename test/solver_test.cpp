@@ -1,35 +1,28 @@
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <gtest/gtest.h>
 #include "constants.h"
 #include "tetris.h"
 #include "solver.h"
+#include "test_helpers.h"
 
-TEST(SolverTest, IterateNodeNeighbours) {
-    Tetrimino expectedShapes[] = {T, T, L, I, J};
-    int i = 0;
-
-    GraphNode g1 = {.tetrimino = Tetrimino(T)};
-    GraphNode g2 = {.tetrimino = Tetrimino(L)};
-    GraphNode g3 = {.tetrimino = Tetrimino(I)};
-    GraphNode g4 = {.tetrimino = Tetrimino(J)};
-
-    // node neighbours will be iterated with between 1 and 4 items so test both extremes
-    NodeNeighbours neighbours;
-    neighbours.push_back(&g1);
-
-    for (GraphNode* n : neighbours) {
-        EXPECT_EQ(expectedShapes[i], n->tetrimino.shape);
-        i++;
-    }
-
-    neighbours.push_back(&g2);
-    neighbours.push_back(&g3);
-    neighbours.push_back(&g4);
+TEST(SolverTest, NodeNeighboursOfOpenAndBlockedNodes) {
+    GameGrid grid;
+    Tetrimino tetrimino(T);
+    auto graph = makeGraph(tetrimino, grid);
 
-    for (GraphNode* n : neighbours) {
-        EXPECT_EQ(expectedShapes[i], n->tetrimino.shape);
-        i++;
-    }
+    // in the open every move is possible and neighbours are found from their flags
+    NodeIndex node = nodeIndex(5, 5, 0);
+    EXPECT_EQ(graph->neighbours[node], leftNeighbour | rightNeighbour | rotatedNeighbour | belowNeighbour);
+    EXPECT_EQ(graph->getTetrimino(neighbourIndex(node, leftNeighbour, 4)), Tetrimino(T, 4, 5, 0));
+    EXPECT_EQ(graph->getTetrimino(neighbourIndex(node, rightNeighbour, 4)), Tetrimino(T, 6, 5, 0));
+    EXPECT_EQ(graph->getTetrimino(neighbourIndex(node, rotatedNeighbour, 4)), Tetrimino(T, 5, 5, 1));
+    EXPECT_EQ(graph->getTetrimino(neighbourIndex(node, belowNeighbour, 4)), Tetrimino(T, 5, 6, 0));
+    EXPECT_EQ(neighbourIndex(nodeIndex(5, 5, 3), rotatedNeighbour, 4), nodeIndex(5, 5, 0));
+
+    // against the left wall and resting on the floor only moving right or rotating is possible
+    EXPECT_EQ(graph->neighbours[nodeIndex(1, 18, 0)], rightNeighbour | rotatedNeighbour);
 }
 
 TEST(SolverTest, SearchEmptyGridWithOTetrimino) {
@@ -38,28 +31,28 @@ TEST(SolverTest, SearchEmptyGridWithOTetrimino) {
     tetrimino.xDelta = SPAWN_X_DELTA;
     auto graph = makeGraph(tetrimino, grid);
 
-    std::vector<GraphNode*> results = search(graph.get(), tetrimino, grid);
+    std::vector<NodeIndex> results = search(graph.get(), tetrimino, grid);
 
     std::cout << "Initial grid:" << std::endl;
     grid.print();
 
     // print all the search results
-    for (GraphNode* node : results) {
+    for (NodeIndex node : results) {
         std::cout << "\n" << std::endl;
         GameGrid newGrid = grid;
-        newGrid.setCells(node->tetrimino);
+        newGrid.setCells(graph->getTetrimino(node));
         newGrid.print();
     }
 
-    // follow a node's prev pointers all the way to the root node
-    GraphNode* node = results.at(0);
-    while (node->prev != nullptr) {
-        node = node->prev;
+    // follow a node's prev links all the way to the root node
+    NodeIndex node = results.at(0);
+    while (graph->prev[node] != NO_NODE) {
+        node = graph->prev[node];
     }
     
     //make sure it's actually the root
-    EXPECT_EQ(node->tetrimino.yDelta, 0);
-    EXPECT_EQ(node->tetrimino.xDelta, 5);
+    EXPECT_EQ(graph->getTetrimino(node).yDelta, 0);
+    EXPECT_EQ(graph->getTetrimino(node).xDelta, 5);
 }
 
 TEST(SolverTest, SearchEmptyGridWithITetrimino) {
@@ -68,28 +61,28 @@ TEST(SolverTest, SearchEmptyGridWithITetrimino) {
     tetrimino.xDelta = SPAWN_X_DELTA;
     auto graph = makeGraph(tetrimino, grid);
 
-    std::vector<GraphNode*> results = search(graph.get(), tetrimino, grid);
+    std::vector<NodeIndex> results = search(graph.get(), tetrimino, grid);
 
     std::cout << "Initial grid:" << std::endl;
     grid.print();
 
     // print all the search results
-    for (GraphNode* node : results) {
+    for (NodeIndex node : results) {
         std::cout << "\n" << std::endl;
         GameGrid newGrid = grid;
-        newGrid.setCells(node->tetrimino);
+        newGrid.setCells(graph->getTetrimino(node));
         newGrid.print();
     }
 
-    // follow a node's prev pointers all the way to the root node
-    GraphNode* node = results.at(0);
-    while (node->prev != nullptr) {
-        node = node->prev;
+    // follow a node's prev links all the way to the root node
+    NodeIndex node = results.at(0);
+    while (graph->prev[node] != NO_NODE) {
+        node = graph->prev[node];
     }
     
     // make sure it's actually the root
-    EXPECT_EQ(node->tetrimino.yDelta, 0);
-    EXPECT_EQ(node->tetrimino.xDelta, 5);
+    EXPECT_EQ(graph->getTetrimino(node).yDelta, 0);
+    EXPECT_EQ(graph->getTetrimino(node).xDelta, 5);
 
     // make sure enough results were generated
     EXPECT_EQ(results.size(), 17);
@@ -105,19 +98,19 @@ TEST(SolverTest, SearchNonEmptyGridSlideIntoPlace) {
     tetrimino.xDelta = SPAWN_X_DELTA;
     auto graph = makeGraph(tetrimino, grid);
 
-    std::vector<GraphNode*> results = search(graph.get(), tetrimino, grid);
+    std::vector<NodeIndex> results = search(graph.get(), tetrimino, grid);
 
     std::cout << "Initial grid:" << std::endl;
     grid.print();
 
     // print all the search results, look for one that slid into place
     bool found = false;
-    for (GraphNode* node : results) {
+    for (NodeIndex node : results) {
         std::cout << "\n" << std::endl;
         GameGrid newGrid = grid;
-        newGrid.setCells(node->tetrimino);
+        newGrid.setCells(graph->getTetrimino(node));
         newGrid.print();
-        if (node->tetrimino.xDelta == 4 and node->tetrimino.yDelta == 19){
+        if (graph->getTetrimino(node).xDelta == 4 and graph->getTetrimino(node).yDelta == 19){
             found = true;
             std::cout << "Found it!" << std::endl;
         }
@@ -132,10 +125,11 @@ TEST(SolverTest, FollowMovesOfVerticalITetrimino) {
     tetrimino.xDelta = SPAWN_X_DELTA;
     auto graph = makeGraph(tetrimino, grid);
 
-    std::vector<GraphNode*> results = search(graph.get(), tetrimino, grid);
-    EXPECT_EQ(results.at(1)->tetrimino.rotationStep, 0);
+    std::vector<NodeIndex> results = search(graph.get(), tetrimino, grid);
+    Tetrimino result = graph->getTetrimino(results.at(1));
+    EXPECT_EQ(result.rotationStep, 0);
 
-    Moves moves = movesToReachSearchResult(results.at(1));
+    Moves moves = movesToReachSearchResult(graph.get(), results.at(1));
 
     for (Move move : moves) {
         if (std::holds_alternative<Direction>(move) and not grid.checkCollision(tetrimino.move(std::get<Direction>(move)))) {
@@ -150,9 +144,9 @@ TEST(SolverTest, FollowMovesOfVerticalITetrimino) {
         gridCopy.print();
     }
 
-    EXPECT_EQ(results.at(1)->tetrimino.xDelta, tetrimino.xDelta);
-    EXPECT_EQ(results.at(1)->tetrimino.yDelta, tetrimino.yDelta);
-    EXPECT_EQ(results.at(1)->tetrimino, tetrimino);
+    EXPECT_EQ(result.xDelta, tetrimino.xDelta);
+    EXPECT_EQ(result.yDelta, tetrimino.yDelta);
+    EXPECT_EQ(result, tetrimino);
 }
 
 TEST(SolverTest, AnalyzeAllCombinations) {
@@ -162,9 +156,9 @@ TEST(SolverTest, AnalyzeAllCombinations) {
     Tetrimino secondTetrimino = Tetrimino(L);
     secondTetrimino.xDelta = SPAWN_X_DELTA;
 
-    auto firstGraph = makeGraph(firstTetrimino, grid);
+    SolverContext context;
 
-    auto analyze = [](GameGrid& grid, int totalLockHeight, int linesCleared, GraphNode* result) {
+    auto analyze = [&context](GameGrid& grid, int totalLockHeight, int linesCleared, NodeIndex result) {
         EvaluationFactors factors;
         computeEvaluationFactors(grid, factors);
         factors.totalLinesCleared = linesCleared;
@@ -177,10 +171,10 @@ TEST(SolverTest, AnalyzeAllCombinations) {
         std::cout << "total column holes: " << factors.totalColumnHoles << std::endl;
         std::cout << "total column transisionts: " << factors.totalColumnTransistions << std::endl;
         std::cout << "total row transistions: " << factors.totalRowTransitions << std::endl << std::endl;
-        std::cout << "x: " << result->tetrimino.xDelta << std::endl;
+        std::cout << "x: " << static_cast<int>(context.firstGraph.getTetrimino(result).xDelta) << std::endl;
     };
 
-    analyzeAllCombinations(analyze, firstGraph.get(), grid, firstTetrimino, secondTetrimino);
+    analyzeAllCombinations(analyze, context, grid, firstTetrimino, secondTetrimino);
 }
 
 TEST(SolverTest, EvaluateAllFactors) {
@@ -236,4 +230,275 @@ TEST(SolverTest, EmptyColumnHasNoTransitions) {
     computeEvaluationFactors(grid, factors);
 
     EXPECT_EQ(factors.totalColumnTransistions, 2);
-}
\ No newline at end of file
+}
+
+TEST(GameGridTest, ClearFullRowsKeepsRowsAboveInOrder) {
+    GameGrid grid;
+    for (int col = 0; col < GRID_WIDTH; col++) {
+        grid.setCell(Position(col, 19), first);
+        grid.setCell(Position(col, 17), first);
+    }
+    grid.setCell(Position(3, 18), second);
+    grid.setCell(Position(7, 16), third);
+
+    int rowsCleared = grid.clearFullRows();
+    grid.print();
+
+    EXPECT_EQ(rowsCleared, 2);
+    EXPECT_FALSE(grid.isEmpty(3, 19));
+    EXPECT_EQ(grid.getSpriteType(Position(3, 19)), second);
+    EXPECT_FALSE(grid.isEmpty(7, 18));
+    EXPECT_EQ(grid.getSpriteType(Position(7, 18)), third);
+    EXPECT_TRUE(grid.getFullRows().empty());
+    EXPECT_TRUE(grid.isEmpty(3, 17));
+}
+
+TEST(GameGridTest, CheckCollisionAgainstWallsFloorAndCells) {
+    GameGrid grid;
+    grid.setCell(Position(5, 19), first);
+
+    EXPECT_FALSE(grid.checkCollision(Tetrimino(I, 2, 0, 0)));
+    EXPECT_TRUE(grid.checkCollision(Tetrimino(I, 1, 0, 0))); // leftmost cell is at x = -1
+    EXPECT_TRUE(grid.checkCollision(Tetrimino(I, 9, 0, 0))); // rightmost cell is at x = 10
+    EXPECT_FALSE(grid.checkCollision(Tetrimino(I, 0, 1, 1))); // vertical and partially above the grid
+    EXPECT_TRUE(grid.checkCollision(Tetrimino(I, 0, 19, 1))); // bottom cell is below the floor
+    EXPECT_FALSE(grid.checkCollision(Tetrimino(O, 5, 17, 0)));
+    EXPECT_TRUE(grid.checkCollision(Tetrimino(O, 5, 18, 0)));
+    EXPECT_TRUE(grid.checkCollision(Tetrimino(O, 6, 18, 0)));
+    EXPECT_FALSE(grid.checkCollision(Tetrimino(O, 7, 18, 0)));
+}
+
+TEST(TetriminoTest, RotationsWrapAroundAndPositionsAreTranslated) {
+    Tetrimino t(T, 4, 10, 0);
+    EXPECT_EQ(t.rotate(counterClockwise).rotationStep, 3);
+    EXPECT_EQ(t.rotate(clockwise).rotate(counterClockwise), t);
+    EXPECT_EQ(Tetrimino(I, 4, 10, 1).rotate(clockwise).rotationStep, 0);
+    EXPECT_EQ(Tetrimino(O, 4, 10, 0).rotate(counterClockwise).rotationStep, 0);
+
+    TetriminoCells positions = t.getPositions();
+    EXPECT_EQ(positions[0].x, 3);
+    EXPECT_EQ(positions[0].y, 10);
+    EXPECT_EQ(positions[3].x, 4);
+    EXPECT_EQ(positions[3].y, 11);
+    EXPECT_EQ(t.getHeight(), GRID_HEIGHT - 1 - 11);
+}
+
+TEST(SolverTest, FindPlacementsMatchesSearch) {
+    std::mt19937 rng(1234);
+    for (int i = 0; i < 200; i++) {
+        GameGrid grid = makeRandomGrid(rng);
+        for (int shape = 0; shape < N; shape++) {
+            Tetrimino tetrimino(static_cast<TetriminoShape>(shape), SPAWN_X_DELTA, 0, 0);
+            auto graph = makeGraph(tetrimino, grid);
+            std::vector<NodeIndex> searchResults = search(graph.get(), tetrimino, grid);
+
+            PlacementBoard board;
+            std::vector<Tetrimino> placements;
+            findPlacements(tetrimino, grid, board, placements);
+
+            ASSERT_EQ(placements.size(), searchResults.size());
+            for (NodeIndex result : searchResults) {
+                Tetrimino expected = graph->getTetrimino(result);
+                ASSERT_NE(std::find(placements.begin(), placements.end(), expected), placements.end());
+
+                // the rebuilt path is as short as the one found by search and ends at the placement
+                Moves moves = movesToReachPlacement(board, tetrimino, expected);
+                EXPECT_EQ(moves.size(), movesToReachSearchResult(graph.get(), result).size());
+                Tetrimino current = tetrimino;
+                for (std::size_t m = 0; m + 1 < moves.size(); m++) {
+                    current = std::holds_alternative<Direction>(moves[m]) 
+                        ? current.move(std::get<Direction>(moves[m])) 
+                        : current.rotate(std::get<Rotation>(moves[m]));
+                    ASSERT_FALSE(grid.checkCollision(current));
+                }
+                EXPECT_EQ(current, expected);
+            }
+        }
+    }
+}
+
+static void expectFeaturesMatchScan(GameGrid& grid) {
+    EvaluationFactors expected;
+    computeEvaluationFactors(grid, expected);
+    EvaluationFactors factors;
+    getEvaluationFactors(grid, factors);
+    ASSERT_EQ(factors.totalWellCells, expected.totalWellCells);
+    ASSERT_EQ(factors.totalColumnHoles, expected.totalColumnHoles);
+    ASSERT_EQ(factors.totalColumnTransistions, expected.totalColumnTransistions);
+    ASSERT_EQ(factors.totalRowTransitions, expected.totalRowTransitions);
+}
+
+TEST(GameGridTest, IncrementalFeaturesMatchScanOverRandomGames) {
+    std::mt19937 rng(99);
+    std::uniform_int_distribution<int> randomShape(0, N - 1);
+    PlacementBoard board;
+    std::vector<Tetrimino> placements;
+    GameGrid grid;
+    long leaves = 0;
+
+    // every placement of a random tetrimino is checked as a leaf, then a random one is kept to move 
+    // the game along. Games restart when the stack reaches the top.
+    while (leaves < 1000000) {
+        Tetrimino tetrimino(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+        findPlacements(tetrimino, grid, board, placements);
+        if (grid.checkCollision(tetrimino) or placements.empty()) {
+            grid = GameGrid();
+            continue;
+        }
+
+        for (Tetrimino placement : placements) {
+            GameGrid leaf = grid;
+            leaf.setCells(placement);
+            leaf.clearFullRows();
+            expectFeaturesMatchScan(leaf);
+            if (HasFatalFailure()) {
+                return;
+            }
+            leaves++;
+        }
+
+        Tetrimino kept = placements[std::uniform_int_distribution<int>(0, placements.size() - 1)(rng)];
+        grid.setCells(kept);
+        grid.clearFullRows();
+    }
+}
+
+TEST(GameGridTest, IncrementalFeaturesMatchScanAfterEdits) {
+    std::mt19937 rng(5);
+    for (int i = 0; i < 2000; i++) {
+        GameGrid grid = makeRandomGrid(rng);
+        expectFeaturesMatchScan(grid);
+        for (int edit = 0; edit < 10; edit++) {
+            int col = std::uniform_int_distribution<int>(0, GRID_WIDTH - 1)(rng);
+            int row = std::uniform_int_distribution<int>(0, GRID_HEIGHT - 1)(rng);
+            if (edit % 3 == 0) {
+                grid.clearCell(Position(col, row));
+            } else if (edit % 3 == 1) {
+                grid.setCell(Position(col, row), second);
+            } else {
+                grid.clearRows({ row });
+            }
+            expectFeaturesMatchScan(grid);
+            ASSERT_FALSE(HasFatalFailure());
+        }
+    }
+}
+
+TEST(GameGridTest, FeatureKernelsMatchScanOnRandomBoards) {
+    std::mt19937 rng(11);
+    for (int i = 0; i < 20000; i++) {
+        GameGrid grid = makeRandomGrid(rng);
+        // scatter a few cells anywhere, including row 0, so floating cells and the spawn row are covered
+        for (int cell = 0; cell < i % 8; cell++) {
+            int col = std::uniform_int_distribution<int>(0, GRID_WIDTH - 1)(rng);
+            int row = std::uniform_int_distribution<int>(0, GRID_HEIGHT - 1)(rng);
+            grid.setCell(Position(col, row), second);
+        }
+
+        std::array<uint16_t, GRID_HEIGHT> rows;
+        for (int y = 0; y < GRID_HEIGHT; y++) {
+            rows[y] = grid.getRow(y);
+        }
+        BoardFeatures features = computeBoardFeatures(rows);
+        EvaluationFactors expected;
+        computeEvaluationFactors(grid, expected);
+        ASSERT_EQ(features.wellCells, expected.totalWellCells);
+        ASSERT_EQ(features.columnHoles, expected.totalColumnHoles);
+        ASSERT_EQ(features.columnTransitions, expected.totalColumnTransistions);
+        ASSERT_EQ(features.rowTransitions, expected.totalRowTransitions);
+    }
+}
+
+TEST(SolverTest, NextPlacementBoundNeverExceedsALeaf) {
+    std::mt19937 rng(21);
+    PlacementBoard board;
+    std::vector<Tetrimino> placements;
+    for (int i = 0; i < 3000; i++) {
+        GameGrid grid = makeRandomGrid(rng);
+        grid.clearFullRows();
+        int linesCleared = i % 3;
+        int totalLockHeight = i % 17;
+        double bound = computeNextPlacementBound(grid, totalLockHeight, linesCleared, weights);
+
+        for (int shape = 0; shape < N; shape++) {
+            Tetrimino tetrimino(static_cast<TetriminoShape>(shape), SPAWN_X_DELTA, 0, 0);
+            findPlacements(tetrimino, grid, board, placements);
+            for (Tetrimino placement : placements) {
+                GameGrid leaf = grid;
+                leaf.setCells(placement);
+                leaf.clearFullRows();
+                ASSERT_LE(bound, computeBoardFitness(leaf, totalLockHeight, linesCleared, weights));
+            }
+        }
+    }
+}
+
+TEST(SolverTest, PruningKeepsTheChosenMove) {
+    std::mt19937 rng(8);
+    std::uniform_int_distribution<int> randomShape(0, N - 1);
+    SolverContext prunedContext;
+    SolverContext fullContext;
+    fullContext.pruning = false;
+    long prunedFirstPlacements = 0;
+
+    for (int game = 0; game < 3; game++) {
+        GameGrid grid;
+        Tetrimino current(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+        Tetrimino next(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+
+        for (int piece = 0; piece < 150 and not grid.checkCollision(current); piece++) {
+            NodeIndex expected = solve(fullContext, grid, current, next, weights);
+            NodeIndex actual = solve(prunedContext, grid, current, next, weights);
+            ASSERT_EQ(prunedContext.firstGraph.getTetrimino(actual), fullContext.firstGraph.getTetrimino(expected));
+            ASSERT_EQ(
+                movesToReachSearchResult(&prunedContext.firstGraph, actual),
+                movesToReachSearchResult(&fullContext.firstGraph, expected));
+
+            EXPECT_EQ(fullContext.stats.prunedFirstPlacements, 0);
+            EXPECT_LE(prunedContext.stats.evaluatedLeaves, fullContext.stats.evaluatedLeaves);
+            prunedFirstPlacements += prunedContext.stats.prunedFirstPlacements;
+
+            Tetrimino placement = prunedContext.firstGraph.getTetrimino(actual);
+            grid.setCells(placement);
+            grid.clearFullRows();
+            current = next;
+            next = Tetrimino(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+        }
+    }
+    EXPECT_GT(prunedFirstPlacements, 0);
+}
+
+// rotationCounts leaves out orientations that repeat another one's cells, so the solver never
+// expands the same board twice
+TEST(SolverTest, PlacementsNeverShareAFootprint) {
+    std::mt19937 rng(13);
+    PlacementBoard board;
+    std::vector<Tetrimino> placements;
+    for (int i = 0; i < 300; i++) {
+        GameGrid grid = makeRandomGrid(rng);
+        for (int shape = 0; shape < N; shape++) {
+            Tetrimino tetrimino(static_cast<TetriminoShape>(shape), SPAWN_X_DELTA, 0, 0);
+            auto graph = makeGraph(tetrimino, grid);
+            std::vector<Tetrimino> searchPlacements;
+            for (NodeIndex result : search(graph.get(), tetrimino, grid)) {
+                searchPlacements.push_back(graph->getTetrimino(result));
+            }
+            findPlacements(tetrimino, grid, board, placements);
+
+            for (const std::vector<Tetrimino>* found : { &searchPlacements, &placements }) {
+                std::vector<std::array<int, 4>> footprints;
+                for (const Tetrimino& placement : *found) {
+                    std::array<int, 4> cells;
+                    TetriminoCells positions = placement.getPositions();
+                    for (int c = 0; c < 4; c++) {
+                        cells[c] = positions[c].y * GRID_WIDTH + positions[c].x;
+                    }
+                    std::sort(cells.begin(), cells.end());
+                    footprints.push_back(cells);
+                }
+                std::sort(footprints.begin(), footprints.end());
+                ASSERT_EQ(std::adjacent_find(footprints.begin(), footprints.end()), footprints.end());
+            }
+        }
+    }
+}
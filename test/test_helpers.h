@@ -0,0 +1,51 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <random>
+#include "constants.h"
+#include "solver.h"
+#include "tetris.h"
+
+// Fixtures shared by the tests in solver_test, and by solver_bench
+
+// The weights lazy and tetris_sim play with
+inline const EvaluationWeights weights = {
+    .totalLinesCleared = 1.0,
+    .totalLockHeight = 12.885008263218383,
+    .totalWellCells = 15.842707182438396,
+    .totalColumnHoles = 26.894496507795950,
+    .totalColumnTransitions = 27.616914062397015,
+    .totalRowTransitions = 30.185110719279040
+};
+
+// Columns of up to maxHeight cells with about one in five missing, full rows cleared like in a game
+inline GameGrid makeRaggedGrid(std::mt19937& rng, int maxHeight = 8) {
+    GameGrid grid;
+    for (int col = 0; col < GRID_WIDTH; col++) {
+        int height = std::uniform_int_distribution<int>(0, maxHeight)(rng);
+        for (int row = GRID_HEIGHT - 1; row >= GRID_HEIGHT - height; row--) {
+            if (std::uniform_int_distribution<int>(0, 9)(rng) < 8) {
+                grid.setCell(Position(col, row), first);
+            }
+        }
+    }
+    grid.clearFullRows();
+    return grid;
+}
+
+// Ragged boards with holes, overhangs and the occasional tall column for checking that different
+// implementations of the same thing agree
+inline GameGrid makeRandomGrid(std::mt19937& rng) {
+    GameGrid grid;
+    int height = std::uniform_int_distribution<int>(0, GRID_HEIGHT - 4)(rng);
+    for (int row = GRID_HEIGHT - 1; row >= GRID_HEIGHT - height; row--) {
+        for (int col = 0; col < GRID_WIDTH; col++) {
+            if (std::uniform_int_distribution<int>(0, 99)(rng) < 60) {
+                grid.setCell(Position(col, row), first);
+            }
+        }
+    }
+    return grid;
+}
+
+#endif
@@ -0,0 +1,82 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+#include "trace.h"
+
+static std::string readFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+static int countOf(const std::string& text, const std::string& part) {
+    int count = 0;
+    for (std::size_t at = text.find(part); at != std::string::npos; at = text.find(part, at + 1)) {
+        count++;
+    }
+    return count;
+}
+
+TEST(TraceTest, ScopesOnEveryThreadEndUpInTheTrace) {
+    std::string path = ::testing::TempDir() + "trace_test.json";
+    startTracing(path);
+    {
+        TraceScope outer("outer");
+        TraceScope inner("inner");
+    }
+    std::thread worker([]() {
+        for (int i = 0; i < 3; i++) {
+            TraceScope scope("worker");
+        }
+    });
+    worker.join(); // its events outlive it
+    stopTracing();
+    {
+        TraceScope ignored("afterStop");
+    }
+    ASSERT_TRUE(writeTrace());
+
+    std::string trace = readFile(path);
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [", 0), 0);
+    EXPECT_EQ(countOf(trace, "\"ph\": \"M\""), 2); // a name for each thread
+    EXPECT_EQ(countOf(trace, "{\"name\": \"outer\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0"), 1);
+    EXPECT_EQ(countOf(trace, "{\"name\": \"inner\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0"), 1);
+    EXPECT_EQ(countOf(trace, "{\"name\": \"worker\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1"), 3);
+    EXPECT_EQ(countOf(trace, "afterStop"), 0);
+    EXPECT_NE(trace.find("\"droppedEvents\": 0"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, FullBuffersKeepTheNewestEvents) {
+    std::string path = ::testing::TempDir() + "trace_test_full.json";
+    startTracing(path);
+    for (int i = 0; i < 5; i++) {
+        TraceScope scope("oldest");
+    }
+    for (uint32_t i = 0; i < TraceBuffer::capacity - 1; i++) {
+        TraceScope scope("spin");
+    }
+    {
+        TraceScope scope("newest");
+    }
+    stopTracing();
+    EXPECT_EQ(threadTraceBuffer().size(), TraceBuffer::capacity);
+    EXPECT_EQ(threadTraceBuffer().dropped(), 5);
+    ASSERT_TRUE(writeTrace());
+    std::string trace = readFile(path);
+    EXPECT_EQ(countOf(trace, "\"oldest\""), 0);
+    EXPECT_EQ(countOf(trace, "\"spin\""), static_cast<int>(TraceBuffer::capacity) - 1);
+    EXPECT_EQ(countOf(trace, "\"newest\""), 1);
+    EXPECT_LT(trace.find("\"spin\""), trace.find("\"newest\"")); // still oldest first
+    EXPECT_NE(trace.find("\"droppedEvents\": 5"), std::string::npos);
+
+    // starting again begins with empty buffers
+    startTracing(path);
+    stopTracing();
+    EXPECT_EQ(threadTraceBuffer().size(), 0);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,170 @@
+#include <random>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "constants.h"
+#include "tetris.h"
+#include "solver.h"
+#include "parallel_solver.h"
+#include "transposition_table.h"
+#include "test_helpers.h"
+
+static uint64_t hashFromScratch(const GameGrid& grid) {
+    uint64_t hash = 0;
+    for (int y = 0; y < GRID_HEIGHT; y++) {
+        hash ^= zobristRowHash(y, grid.getRow(y));
+    }
+    return hash;
+}
+
+static EvaluationFactors makeFactors(int wells, int holes, int columnTransitions, int rowTransitions) {
+    EvaluationFactors factors;
+    factors.totalWellCells = wells;
+    factors.totalColumnHoles = holes;
+    factors.totalColumnTransistions = columnTransitions;
+    factors.totalRowTransitions = rowTransitions;
+    return factors;
+}
+
+TEST(ZobristTest, IncrementalHashMatchesHashFromScratch) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> randomX(0, GRID_WIDTH - 1);
+    std::uniform_int_distribution<int> randomY(0, GRID_HEIGHT - 1);
+    std::uniform_int_distribution<int> randomOperation(0, 9);
+
+    GameGrid grid;
+    EXPECT_EQ(grid.getHash(), 0u);
+    for (int i = 0; i < 20000; i++) {
+        int operation = randomOperation(rng);
+        if (operation < 6) {
+            grid.setCell(Position(randomX(rng), randomY(rng)), first);
+        } else if (operation < 8) {
+            grid.clearCell(Position(randomX(rng), randomY(rng)));
+        } else if (operation < 9) {
+            // fill a row so clearFullRows has something to shift
+            int y = randomY(rng);
+            for (int x = 0; x < GRID_WIDTH; x++) {
+                grid.setCell(Position(x, y), second);
+            }
+            grid.clearFullRows();
+        } else {
+            grid.clearRows({ randomY(rng) });
+        }
+        ASSERT_EQ(grid.getHash(), hashFromScratch(grid));
+    }
+}
+
+TEST(ZobristTest, SameBoardReachedDifferentWaysHashesEqually) {
+    GameGrid a;
+    a.setCells(Tetrimino(O, 0, 0, 0));
+    a.setCells(Tetrimino(I, 4, 0, 0));
+
+    GameGrid b;
+    b.setCells(Tetrimino(I, 4, 0, 0));
+    b.setCells(Tetrimino(O, 0, 0, 0));
+    EXPECT_EQ(a.getHash(), b.getHash());
+
+    b.clearCell(Position(0, 0));
+    EXPECT_NE(a.getHash(), b.getHash());
+}
+
+TEST(TranspositionTableTest, StoresAndProbesFactors) {
+    TranspositionTable table(1 << 12);
+    TranspositionCounters counters;
+    EvaluationFactors factors;
+
+    EXPECT_FALSE(table.probe(1234, factors, counters));
+    table.store(1234, makeFactors(3, 7, 20, 31), counters);
+    ASSERT_TRUE(table.probe(1234, factors, counters));
+    EXPECT_EQ(factors.totalWellCells, 3);
+    EXPECT_EQ(factors.totalColumnHoles, 7);
+    EXPECT_EQ(factors.totalColumnTransistions, 20);
+    EXPECT_EQ(factors.totalRowTransitions, 31);
+
+    // a board with no wells, holes or transitions still has to be told apart from an empty entry
+    table.store(99, makeFactors(0, 0, 0, 0), counters);
+    ASSERT_TRUE(table.probe(99, factors, counters));
+    EXPECT_EQ(factors.totalColumnHoles, 0);
+
+    EXPECT_EQ(counters.hits, 2u);
+    EXPECT_EQ(counters.misses, 1u);
+    table.addCounters(counters);
+    EXPECT_EQ(table.getCounters().hits, 2u);
+
+    table.clear();
+    EXPECT_FALSE(table.probe(1234, factors, counters));
+}
+
+TEST(TranspositionTableTest, ConcurrentStoresNeverProbeWrongFactors) {
+    TranspositionTable table(1 << 10); // small so threads keep overwriting each other's entries
+    const int threadCount = 4;
+
+    // the factors are derived from the key so every hit can be checked
+    auto factorsForKey = [](uint64_t key) {
+        return makeFactors(key % 97, key % 89, key % 1009, key % 1013);
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<int> wrong(threadCount, 0);
+    for (int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 rng(t);
+            TranspositionCounters counters;
+            EvaluationFactors factors;
+            for (int i = 0; i < 200000; i++) {
+                uint64_t key = rng() % 4096 * 0x9E3779B97F4A7C15ull;
+                if (table.probe(key, factors, counters)) {
+                    EvaluationFactors expected = factorsForKey(key);
+                    if (factors.totalWellCells != expected.totalWellCells
+                        or factors.totalColumnHoles != expected.totalColumnHoles
+                        or factors.totalColumnTransistions != expected.totalColumnTransistions
+                        or factors.totalRowTransitions != expected.totalRowTransitions) {
+                        wrong[t]++;
+                    }
+                } else {
+                    table.store(key, factorsForKey(key), counters);
+                }
+            }
+            table.addCounters(counters);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int t = 0; t < threadCount; t++) {
+        EXPECT_EQ(wrong[t], 0);
+    }
+    TranspositionCounters counters = table.getCounters();
+    EXPECT_EQ(counters.hits + counters.misses, 200000u * threadCount);
+    EXPECT_GT(counters.hits, 0u);
+}
+
+TEST(TranspositionTableTest, SolveWithTableMatchesSolveWithout) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> randomShape(0, N - 1);
+    TranspositionTable table(1 << 20);
+    SolverContext context;
+    SolverContext cachedContext;
+    cachedContext.transpositionTable = &table;
+    ParallelSolver parallelSolver(4);
+
+    GameGrid grid;
+    Tetrimino current(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+    Tetrimino next(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+
+    for (int piece = 0; piece < 100 and not grid.checkCollision(current); piece++) {
+        Tetrimino expected = solveForOptimalTetrimino(context, grid, current, next, weights);
+        EXPECT_EQ(solveForOptimalTetrimino(cachedContext, grid, current, next, weights), expected);
+        EXPECT_EQ(parallelSolver.solveForOptimalTetrimino(grid, current, next, weights), expected);
+
+        grid.setCells(expected);
+        grid.clearFullRows();
+        current = next;
+        next = Tetrimino(static_cast<TetriminoShape>(randomShape(rng)), SPAWN_X_DELTA, 0, 0);
+    }
+
+    // boards repeat between solves and between the two placements of one solve
+    EXPECT_GT(table.getCounters().hits, 0u);
+    EXPECT_GT(parallelSolver.getTranspositionTable()->getCounters().hits, 0u);
+}